@@ -111,6 +111,10 @@ files_widget::files_widget(QWidget *parent)
     m_reloadDirectory->setIcon(QIcon(":/emule/common/folder_reload.ico"));
     m_reloadDirectory->setText(tr("Reload directory"));
 
+    m_cancelSharing = new QAction(this);
+    m_cancelSharing->setObjectName(QString::fromUtf8("cancelSharing"));
+    m_cancelSharing->setText(tr("Stop exchanging subdirs"));
+
     m_openFile = new QAction(this);
     m_openFile->setShortcut(QKeySequence(QString::fromUtf8("Return")));
     tableView->addAction(m_openFile);
@@ -128,6 +132,7 @@ files_widget::files_widget(QWidget *parent)
     m_filesMenu->addAction(m_filesUnexchSubdir);
     m_filesMenu->addSeparator();
     m_filesMenu->addAction(m_reloadDirectory);
+    m_filesMenu->addAction(m_cancelSharing);
 
 
     m_filesMenu2->addAction(m_openFolder);
@@ -158,6 +163,9 @@ files_widget::files_widget(QWidget *parent)
     connect(m_filesUnexchDir,     SIGNAL(triggered()), this, SLOT(unexchangeDir()));
     connect(m_filesUnexchSubdir,  SIGNAL(triggered()), this, SLOT(unxchangeSubdir()));
     connect(m_reloadDirectory,    SIGNAL(triggered()), this, SLOT(reloadDir()));
+    connect(m_cancelSharing,      SIGNAL(triggered()), this, SLOT(cancelSharing()));
+    connect(Session::instance(),  SIGNAL(shareProgress(int, int, int)), this, SLOT(sharingProgress(int, int, int)));
+    connect(Session::instance(),  SIGNAL(shareFinished()), this, SLOT(sharingFinished()));
     connect(m_openFile,           SIGNAL(triggered()), this, SLOT(openSelectedFile()));
     connect(m_openSumFile,        SIGNAL(triggered()), this, SLOT(openSelectedSumFile()));
 
@@ -294,10 +302,8 @@ void files_widget::exchangeSubdir()
 
     if (indx.isValid())
     {
-       QApplication::setOverrideCursor(Qt::WaitCursor);
        qDebug() << "call shareDirectoryR";
-       static_cast<FileNode*>(indx.internalPointer())->share(true);
-       QApplication::restoreOverrideCursor();
+       Session::instance()->shareTree(static_cast<const DirNode*>(indx.internalPointer()), true);
     }
 }
 
@@ -320,13 +326,26 @@ void files_widget::unxchangeSubdir()
 
     if (indx.isValid())
     {
-       QApplication::setOverrideCursor(Qt::WaitCursor);
        qDebug() << "call unshareDirectoryR";
-       static_cast<FileNode*>(indx.internalPointer())->unshare(true);
-       QApplication::restoreOverrideCursor();
+       Session::instance()->shareTree(static_cast<const DirNode*>(indx.internalPointer()), false);
     }
 }
 
+void files_widget::cancelSharing()
+{
+    Session::instance()->cancelShareTree();
+}
+
+void files_widget::sharingProgress(int dirs, int files, int pending)
+{
+    m_cancelSharing->setText(tr("Stop exchanging subdirs (scanned %1 dirs, %2 files to hash, %3 dirs left)").arg(dirs).arg(files).arg(pending));
+}
+
+void files_widget::sharingFinished()
+{
+    m_cancelSharing->setText(tr("Stop exchanging subdirs"));
+}
+
 void files_widget::reloadDir()
 {
     QModelIndex indx = sort2dir(treeView->selectionModel()->currentIndex());
@@ -511,6 +530,8 @@ void files_widget::on_treeView_customContextMenuRequested(const QPoint &pos)
             m_filesUnexchDir->setEnabled(false);
         }
 
+        m_cancelSharing->setEnabled(Session::instance()->isSharingTree());
+
         m_filesMenu->exec(QCursor::pos());
     }
 }
@@ -35,6 +35,7 @@ private:
     QAction* m_filesUnexchDir;
     QAction* m_filesUnexchSubdir;
     QAction* m_reloadDirectory;
+    QAction* m_cancelSharing;
     QAction* m_openFile;
     QAction* m_openSumFile;
 
@@ -73,6 +74,9 @@ private slots:
     void unexchangeDir();
     void unxchangeSubdir();
     void reloadDir();
+    void cancelSharing();
+    void sharingProgress(int dirs, int files, int pending);
+    void sharingFinished();
     void on_treeView_customContextMenuRequested(const QPoint &pos);
     void displayFileMenu(const QPoint &pos);
     void displayFileMenuSum(const QPoint &pos);
@@ -3,9 +3,11 @@ INCLUDEPATH += $$PWD
 HEADERS +=  $$PWD/httpserver.h \
             $$PWD/httpconnection.h \
             $$PWD/httprequestparser.h \
-            $$PWD/httpresponsegenerator.h
+            $$PWD/httpresponsegenerator.h \
+            $$PWD/share_listing.h
 
 SOURCES +=  $$PWD/httpserver.cpp \
             $$PWD/httpconnection.cpp \
             $$PWD/httprequestparser.cpp \
-            $$PWD/httpresponsegenerator.cpp
+            $$PWD/httpresponsegenerator.cpp \
+            $$PWD/share_listing.cpp
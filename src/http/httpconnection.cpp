@@ -39,29 +39,97 @@
 #include <QHttpRequestHeader>
 #include <QHttpResponseHeader>
 #include <QFile>
+#include <QFileInfo>
+#include <QLocale>
 #include <QDebug>
 #include <QRegExp>
 #include <QTemporaryFile>
+#include <QSocketNotifier>
+#include <QTimer>
 #include <queue>
 #include <vector>
 
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/sendfile.h>
+#endif
+
+const qint64 UPLOAD_CHUNK_SIZE = 64 * 1024;
+const qint64 UPLOAD_HIGH_WATER = 256 * 1024;   // socket buffer size when file reading stops
+const qint64 SENDFILE_CHUNK_SIZE = 1024 * 1024;
+const int MAX_RANGES = 16;               // more ranges in one request are ignored
+const int STREAM_WINDOW = 4;             // pieces requested ahead of reading position
+const int STREAM_DEADLINE_STEP = 1000;   // milliseconds between deadlines of successive pieces
+const int STREAM_POLL_INTERVAL = 500;
+const int HTTP_IDLE_TIMEOUT = 15000;      // milliseconds to wait for complete next request
+const qint64 HTTP_READ_BUFFER = 64 * 1024;  // pipelined requests beyond it stay in kernel
+
 HttpConnection::HttpConnection(HttpServer* httpserver, int socketDescriptor):
-    m_httpserver(httpserver), m_socketDescriptor(socketDescriptor), m_interrupted(false)
+    m_httpserver(httpserver), m_socketDescriptor(socketDescriptor), m_state(Reading),
+    m_admitted(false), m_keep_alive(false), m_idle(NULL), m_zero_copy(false), m_offset(0), m_left(0),
+    m_sent(0), m_streaming(false), m_stream_offset(0), m_piece_length(0), m_ready_begin(0), m_ready_end(0),
+    m_deadline_piece(-1), m_stream_index(0), m_stream_registered(false), m_notifier(NULL), m_socket(NULL)
 {
 }
 
+HttpConnection::~HttpConnection()
+{
+    endStream();
+    if (m_admitted) m_httpserver->release();
+}
+
+void HttpConnection::endStream()
+{
+    if (!m_stream_registered) return;
+    m_httpserver->endStream(m_stream, m_stream_index);
+    m_stream_registered = false;
+}
+
 void HttpConnection::interrupt()
 {
-    m_interrupted = true;
+    if (!m_socket) return;
+
+    if (m_state == Reading)
+    {
+        close();
+        return;
+    }
+
+    if (m_state != Sending) return;
+
+    qDebug() << "Interrupted uploading file: " << m_file.fileName() << " sent " << m_sent << " bytes";
+    if (m_notifier) m_notifier->setEnabled(false);
+    m_file.close();
+    m_socket->abort();
+}
+
+// Blocking call from server destructor - connection must not outlive server
+void HttpConnection::terminate()
+{
+    delete this;
 }
 
 void HttpConnection::start()
 {
     m_socket = new QTcpSocket(this);
-    m_socket->setSocketDescriptor(m_socketDescriptor);
+
+    if (!m_socket->setSocketDescriptor(m_socketDescriptor))
+    {
+        qDebug() << "unable to accept connection: " << m_socket->errorString();
+        emit finished();
+        return;
+    }
+
+    m_socket->setReadBufferSize(HTTP_READ_BUFFER);
     connect(m_socket, SIGNAL(readyRead()), SLOT(read()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), SLOT(fill()));
     connect(m_socket, SIGNAL(disconnected()), this, SIGNAL(finished()));
 
+    m_idle = new QTimer(this);
+    m_idle->setSingleShot(true);
+    m_idle->setInterval(HTTP_IDLE_TIMEOUT);
+    connect(m_idle, SIGNAL(timeout()), SLOT(idle()));
+    m_idle->start();
 
     qDebug() << "Incoming connection from: " << m_socket->peerAddress().toString();
     // check ip fof non-local ips only
@@ -74,7 +142,7 @@ void HttpConnection::start()
         if (ec || (Session::instance()->get_ed2k_session()->session_filter().access(addr) != 0))
         {
             qDebug() << "address parse status: " << misc::toQStringU(libed2k::libed2k_exception(ec).what()) << " or blocked";
-            m_socket->disconnectFromHost();
+            close();
             return;
         }
     }
@@ -82,73 +150,110 @@ void HttpConnection::start()
     qDebug() << "continue working with socket";
 }
 
-void HttpConnection::read()
+void HttpConnection::close()
 {
-    m_receivedData.append(m_socket->readAll());
+    m_state = Closing;
+    m_socket->disconnectFromHost();
+}
 
-    // Parse HTTP request header
-    const int header_end = m_receivedData.indexOf("\r\n\r\n");
+void HttpConnection::done()
+{
+    endStream();
 
-    if (header_end < 0)
+    if (m_admitted)
     {
-      qDebug() << "Partial request: \n" << m_receivedData;
-      return;
+        m_httpserver->release();
+        m_admitted = false;
     }
 
-    const QByteArray header = m_receivedData.left(header_end);
-    m_parser.writeHeader(header);
-
-    if (m_parser.isError())
+    if (!m_keep_alive)
     {
-        qWarning() << Q_FUNC_INFO << "header parsing error";
-        m_receivedData.clear();
-        m_generator.setStatusLine(400, "Bad Request");
-        finish();
+        close();
+        return;
     }
-    else if (m_parser.header().hasContentLength())  // Parse HTTP request message
-    {
-        const int expected_length = m_parser.header().contentLength();
-        QByteArray message = m_receivedData.mid(header_end + 4, expected_length);
 
-        if (expected_length > 10000000 /* ~10MB */)
-        {
-            qWarning() << "Bad request: message too long";
-            m_generator.setStatusLine(400, "Bad Request");
-            m_receivedData.clear();
-            finish();
-        }
-        else if (message.length() < expected_length)
-        {
-            // Message too short, waiting for the rest
-            qDebug() << "Partial message:\n" << message;
-        }
-        else
-        {
-            m_parser.writeMessage(message);
-            m_receivedData = m_receivedData.mid(header_end + 4 + expected_length);
-        }
-    }
-    else
+    m_state = Reading;
+    m_parser.reset();
+    m_generator = HttpResponseGenerator();
+    m_idle->start();
+
+    // pipelined request could be received already
+    QMetaObject::invokeMethod(this, "read", Qt::QueuedConnection);
+}
+
+void HttpConnection::idle()
+{
+    if (m_state != Reading) return;
+    qDebug() << "Close idle connection from: " << m_socket->peerAddress().toString();
+    close();
+}
+
+bool HttpConnection::keepAlive() const
+{
+    const QHttpRequestHeader& request = m_parser.header();
+    const QString connection = request.value("Connection").toLower();
+
+    if (request.majorVersion() > 1 || (request.majorVersion() == 1 && request.minorVersion() >= 1))
+        return !connection.contains("close");
+
+    return connection.contains("keep-alive");
+}
+
+bool HttpConnection::headRequest() const
+{
+    return m_parser.header().method() == "HEAD";
+}
+
+QByteArray HttpConnection::connectionHeader() const
+{
+    return m_keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
+void HttpConnection::read()
+{
+    // next request waits in socket buffer until current response is sent
+    if (m_state != Reading || m_socket->bytesToWrite() >= UPLOAD_HIGH_WATER)
     {
-        m_receivedData.clear();
+        if (m_state == Closing) m_socket->readAll();
+        return;
     }
 
-    if (m_parser.isError())
+    m_receivedData.append(m_socket->readAll());
+    if (m_receivedData.isEmpty()) return;
+
+    switch (m_parser.feed(m_receivedData))
     {
-        qWarning() << Q_FUNC_INFO << "message parsing error";
-        m_generator.setStatusLine(400, "Bad Request");
-        finish();
+        case HttpRequestParser::Incomplete:
+            return;
+        case HttpRequestParser::Error:
+            qWarning() << Q_FUNC_INFO << "request parsing error";
+            m_receivedData.clear();
+            m_keep_alive = false;
+            m_idle->stop();
+            m_generator.setStatusLine(400, "Bad Request");
+            finish();
+            return;
+        case HttpRequestParser::Complete:
+            break;
     }
+
+    // rest of buffer is start of next pipelined request
+    if (m_parser.consumed() == m_receivedData.size())
+        m_receivedData.clear();
     else
-    {
-        respond();
-    }
+        m_receivedData.remove(0, m_parser.consumed());
+
+    m_idle->stop();
+    m_keep_alive = keepAlive();
+    respond();
 }
 
 void HttpConnection::finish()
 {
-    m_socket->write(m_generator.toByteArray());
-    m_socket->disconnectFromHost();
+    if (!m_generator.hasContentLength()) m_generator.setContentLength(0);
+    m_generator.setValue("Connection", m_keep_alive ? "keep-alive" : "close");
+    m_socket->write(headRequest() ? m_generator.QHttpResponseHeader::toString().toUtf8() : m_generator.toByteArray());
+    done();
 }
 
 void HttpConnection::respond()
@@ -193,43 +298,38 @@ void HttpConnection::respond()
             return;
         }
 
-        if (list.isEmpty())
+        // listing pages are rendered from cached snapshot, shared tree belongs to GUI thread
+        const bool json = url.endsWith(".json");
+        const int page = m_parser.get("page").toInt();
+        const QString title = tr("Video files from: %1").arg(pref.nick());
+
+        if (list.isEmpty() || list[0] == "index.json")
         {
-            // display main page
-            m_generator.setStatusLine(200, "OK");
-            //m_generator.setContentTypeByExt(ext);
-            m_generator.setMessage("<html><head>"
-                                   "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">"
-                                   "<title>" + tr("Video files from: %1").arg(pref.nick()) +  + "</title>"
-                                  "</head><body>"
-                                  "<style>"
-                                    "li {"
-                                     "list-style-type: none; /* Убираем маркеры */"
-                                   "}"
-                                    "ul {"
-                                     "margin-left: 4; /* Отступ слева в браузере IE и Opera */"
-                                     "padding-left: 4; /* Отступ слева в браузере Firefox, Safari, Chrome */"
-                                     "margin-top: 4;"
-                                     "padding-top: 4;"
-                                   "}"
-                                    "li.marked {"
-                                     "list-style-type: disc;"
-                                     "margin-left: 20;"
-                                   "}"
-                                   "</style>"
-                                   + Session::instance()->root()->toHtml(m_socket->localAddress().toString(), m_httpserver->serverPort()) + "</body></html>");
-            finish();
+            respondChunks(m_httpserver->listing()->renderIndex(page, json, title), json);
             return;
         }
 
+        if (list[0] == "dir" || list[0] == "dir.json")
+        {
+            const QList<QByteArray> chunks = m_httpserver->listing()->renderDirectory(m_parser.get("path"), page, json, title);
+
+            if (chunks.isEmpty())
+                respondNotFound();
+            else
+                respondChunks(chunks, json);
+
+            return;
+        }
 
-        if (misc::isMD4Hash(list[0]))
+        if (misc::isMD4Hash(list[0]) || misc::isSHA1Hash(list[0]))
         {
             Transfer t = Session::instance()->getTransfer(list[0]);
+            const int index = m_parser.get("file").toInt();
 
-            if (t.is_valid())
+            if (t.is_valid() && t.has_metadata() && index >= 0 && index < t.num_files())
             {
-                uploadFile(t.absolute_files_path()[0]);
+                // incomplete files are streamed by pieces
+                uploadFile(t.absolute_files_path().at(index), t.is_seed() ? Transfer() : t, index);
                 return;
             }
         }
@@ -238,54 +338,415 @@ void HttpConnection::respond()
     respondNotFound();
 }
 
-void HttpConnection::uploadFile(const QString& srcPath)
+void HttpConnection::uploadFile(const QString& srcPath, const Transfer& stream /* = Transfer()*/, int index /* = 0*/)
 {
-    if (!m_httpserver->registerConnection(this))
+    if (!m_httpserver->admit())
     {
         respondLimitExceeded();
         return;
     }
 
-    QFile srcFile(srcPath);
+    m_admitted = true;
+    m_zero_copy = false;
+    m_sent = 0;
+    m_ready_begin = m_ready_end = 0;
+    m_deadline_piece = -1;
+    m_stream = stream;
+    m_streaming = stream.is_valid();
+    m_file.setFileName(srcPath);
+    QIODevice::OpenMode mode = QIODevice::ReadOnly;
+
+    // read ahead buffer would keep not yet downloaded data
+    if (m_streaming) mode |= QIODevice::Unbuffered;
+
+    if (!m_file.open(mode))
+    {
+        qDebug() << "Error: cannot open file: " << srcPath;
+        respondNotFound();
+        return;
+    }
+
+    const QHttpRequestHeader& request = m_parser.header();
+    const QFileInfo info(srcPath);
+    const qint64 size = m_streaming ? m_stream.filesize_at(index) : m_file.size();
+    // incomplete file changes with every piece, its content is defined by transfer hash
+    const QByteArray etag = m_streaming ? "\"" + m_stream.hash().toLatin1() + "\"" : entityTag(info);
+    const QByteArray modified = httpDate(info.lastModified());
+    const QByteArray type = contentType(srcPath).toUtf8();
+
     QByteArray buf;
-    if (srcFile.open(QIODevice::ReadOnly))
+
+    if (request.hasKey("If-None-Match") && request.value("If-None-Match").toUtf8() == etag)
+    {
+        buf += "HTTP/1.1 304 Not Modified\r\n";
+        buf += "ETag: " + etag + "\r\n";
+        buf += connectionHeader() + "\r\n";
+        m_file.close();
+        m_socket->write(buf);
+        done();
+        return;
+    }
+
+    QList<ByteRange> ranges;
+    int range_status = RangeIgnored;
+
+    // range of another version of file is ignored and whole file sent
+    if (request.hasKey("Range") &&
+        (!request.hasKey("If-Range") ||
+         request.value("If-Range").toUtf8() == etag || request.value("If-Range").toUtf8() == modified))
+    {
+        range_status = parseRanges(request.value("Range"), size, ranges);
+    }
+
+    if (range_status == RangeNotSatisfiable)
+    {
+        buf += "HTTP/1.1 416 Requested Range Not Satisfiable\r\n";
+        buf += "Content-Range: bytes */" + QByteArray::number(size) + "\r\n";
+        buf += connectionHeader();
+        buf += "Content-Length: 0\r\n\r\n";
+        m_file.close();
+        m_socket->write(buf);
+        done();
+        return;
+    }
+
+    m_parts.clear();
+    qint64 length = 0;
+
+    if (range_status == RangeIgnored)
     {
         buf += "HTTP/1.1 200 OK\r\n";
-        buf += QString("Content-Disposition: inline; filename=\"%1\"").arg(misc::fileName(srcPath)).toUtf8();
-        buf += QString("Content-Type: %1\r\n").arg(contentType(srcPath)).toUtf8();
-        buf += QString("Content-Length: %1\r\n\r\n").arg(srcFile.size()).toUtf8();
+        buf += "Content-Type: " + type + "\r\n";
+        m_parts << Part(QByteArray(), 0, size);
+        length = size;
+    }
+    else if (ranges.size() == 1)
+    {
+        buf += "HTTP/1.1 206 Partial Content\r\n";
+        buf += "Content-Type: " + type + "\r\n";
+        buf += "Content-Range: " + contentRange(ranges[0], size) + "\r\n";
+        m_parts << Part(QByteArray(), ranges[0].first, ranges[0].second - ranges[0].first + 1);
+        length = m_parts.last().length;
+    }
+    else
+    {
+        // every range goes in own body part with own headers
+        const QByteArray boundary = "QMULE" + QByteArray::number(qrand(), 16) + QByteArray::number(size, 16);
+
+        buf += "HTTP/1.1 206 Partial Content\r\n";
+        buf += "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n";
+
+        foreach(const ByteRange& range, ranges)
+        {
+            const QByteArray head = "\r\n--" + boundary + "\r\n"
+                "Content-Type: " + type + "\r\n"
+                "Content-Range: " + contentRange(range, size) + "\r\n\r\n";
+            m_parts << Part(head, range.first, range.second - range.first + 1);
+            length += head.size() + m_parts.last().length;
+        }
+
+        m_parts << Part("\r\n--" + boundary + "--\r\n", 0, 0);
+        length += m_parts.last().head.size();
+    }
+
+    buf += QString("Content-Disposition: inline; filename=\"%1\"\r\n").arg(misc::fileName(srcPath)).toUtf8();
+    buf += "Accept-Ranges: bytes\r\n";
+    buf += "ETag: " + etag + "\r\n";
+    buf += "Last-Modified: " + modified + "\r\n";
+    buf += connectionHeader();
+    buf += "Content-Length: " + QByteArray::number(length) + "\r\n\r\n";
+
+    if (m_socket->write(buf) == -1)
+    {
+        qDebug() << "Error: cannot send header: " << srcPath;
+        m_file.close();
+        close();
+        return;
+    }
+
+    if (headRequest())
+    {
+        m_file.close();
+        done();
+        return;
+    }
+
+    if (m_streaming)
+    {
+        m_stream_offset = m_stream.file_offset_at(index);
+        m_piece_length = m_stream.piece_length();
+        m_stream_index = index;
+        m_httpserver->beginStream(m_stream, index);
+        m_stream_registered = true;
+        qDebug() << "Stream incomplete file: " << srcPath;
+    }
+
+    qDebug() << "Start uploading file: " << srcPath << " parts " << m_parts.size();
+    m_state = Sending;
+    m_left = 0;
+    m_started.start();
+#ifdef Q_OS_LINUX
+    m_zero_copy = true;
+#endif
+    fill();
+}
+
+bool HttpConnection::nextPart()
+{
+    if (m_parts.isEmpty()) return false;
+
+    const Part part = m_parts.takeFirst();
+    if (!part.head.isEmpty()) m_socket->write(part.head);
+    m_offset = part.offset;
+    m_left = part.length;
+
+    return m_zero_copy || m_file.seek(m_offset);
+}
+
+void HttpConnection::fill()
+{
+    // pipelined request was left in socket while write buffer was full
+    if (m_state == Reading && (!m_receivedData.isEmpty() || m_socket->bytesAvailable() > 0))
+    {
+        read();
+        return;
+    }
 
-        if (m_socket->write(buf) != -1 && m_socket->waitForBytesWritten())
+    if (m_state == SendingChunks)
+    {
+        sendChunks();
+        return;
+    }
+
+    if (m_state != Sending) return;
+
+    for (;;)
+    {
+        if (m_left == 0)
         {
-            qDebug() << "Start uploading file: " << srcPath;
-            while(true)
+            if (m_parts.isEmpty())
+            {
+                completeUpload();
+                return;
+            }
+
+            if (!nextPart())
             {
-                if (m_interrupted)
-                {
-                    qDebug() << "Interrupted uploading file: " << srcPath;
-                    break;
-                }
-
-                buf = srcFile.read(256 * 1024);
-                if (buf.size() == 0) break;
-                if (m_socket->write(buf) == -1 || !m_socket->waitForBytesWritten())
-                {
-                    qDebug() << "Error: cannot send file: " << srcPath;
-                    break;
-                }
+                qDebug() << "Error: cannot seek file: " << m_file.fileName();
+                m_file.close();
+                m_socket->abort();
+                return;
             }
+
+            continue;
         }
-        else
-            qDebug() << "Error: cannot send header: " << srcPath;
 
-        qDebug() << "File upload completed: " << srcPath;
-        srcFile.close();
+        if (m_zero_copy)
+        {
+            // headers must leave socket buffer before body is sent past it
+            if (m_socket->bytesToWrite() == 0) sendFile();
+            return;
+        }
+
+        // keep socket buffer bounded, next portion is read when peer takes data
+        if (m_socket->bytesToWrite() >= UPLOAD_HIGH_WATER) return;
+
+        const qint64 count = qMin(ready(), UPLOAD_CHUNK_SIZE);
+
+        if (count == 0)
+        {
+            waitPieces();
+            return;
+        }
+
+        const QByteArray buf = m_file.read(count);
+
+        if (buf.isEmpty() || m_socket->write(buf) == -1)
+        {
+            qDebug() << "Error: cannot send file: " << m_file.fileName();
+            m_file.close();
+            m_socket->abort();
+            return;
+        }
+
+        m_sent += buf.size();
+        m_offset += buf.size();
+        m_left -= buf.size();
     }
-    else
-        qDebug() << "Error: cannot open file: " << srcPath;
+}
 
-    m_httpserver->unregisterConnection(this);
-    m_socket->disconnectFromHost();
+void HttpConnection::sendFile()
+{
+#ifdef Q_OS_LINUX
+    if (m_state != Sending) return;
+    if (m_notifier) m_notifier->setEnabled(false);
+
+    // next part headers are written through socket buffer
+    if (m_left == 0 || m_socket->bytesToWrite() > 0)
+    {
+        fill();
+        return;
+    }
+
+    const int fd = m_socket->socketDescriptor();
+
+    while (m_left > 0)
+    {
+        const qint64 count = qMin(ready(), SENDFILE_CHUNK_SIZE);
+
+        if (count == 0)
+        {
+            waitPieces();
+            return;
+        }
+
+        off_t offset = m_offset;
+        const ssize_t res = ::sendfile(fd, m_file.handle(), &offset, count);
+
+        if (res > 0)
+        {
+            m_sent += offset - m_offset;
+            m_left -= offset - m_offset;
+            m_offset = offset;
+            continue;
+        }
+
+        if (res < 0 && errno == EINTR) continue;
+
+        if (res < 0 && errno == EAGAIN)
+        {
+            // socket buffer is full, own notifier is used since socket's one is idle with empty buffer
+            if (!m_notifier)
+            {
+                m_notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+                connect(m_notifier, SIGNAL(activated(int)), SLOT(sendFile()));
+            }
+
+            m_notifier->setEnabled(true);
+            return;
+        }
+
+        if (res < 0 && (errno == EINVAL || errno == ENOSYS) && m_file.seek(m_offset))
+        {
+            // file system doesn't support sendfile, rest goes by buffered portions
+            qDebug() << "sendfile isn't available for " << m_file.fileName() << " use buffered upload";
+            m_zero_copy = false;
+            fill();
+            return;
+        }
+
+        // zero result means file was truncated after headers were sent
+        qDebug() << "Error: cannot send file: " << m_file.fileName() << " errno " << errno;
+        m_file.close();
+        m_socket->abort();
+        return;
+    }
+
+    fill();
+#endif
+}
+
+qint64 HttpConnection::ready()
+{
+    if (!m_streaming) return m_left;
+
+    // transfer could be removed while streaming
+    if (!m_stream.is_valid()) return 0;
+
+    if (m_offset < m_ready_begin || m_offset >= m_ready_end)
+    {
+        const TransferBitfield pieces = m_stream.pieces();
+        const int first = (m_stream_offset + m_offset) / m_piece_length;
+        int piece = first;
+
+        while (piece < pieces.size() && pieces[piece]) ++piece;
+
+        m_ready_begin = m_offset;
+        m_ready_end = qMax(m_offset, qint64(piece) * m_piece_length - m_stream_offset);
+    }
+
+    return qMin(m_left, m_ready_end - m_offset);
+}
+
+void HttpConnection::waitPieces()
+{
+    if (!m_stream.is_valid())
+    {
+        qDebug() << "Error: streamed transfer was removed: " << m_file.fileName();
+        if (m_notifier) m_notifier->setEnabled(false);
+        m_file.close();
+        m_socket->abort();
+        return;
+    }
+
+    const int first = (m_stream_offset + m_offset) / m_piece_length;
+
+    // deadlines are set once per reading position, engine keeps them until pieces arrive
+    if (first != m_deadline_piece)
+    {
+        const int last = qMin(first + STREAM_WINDOW, m_stream.pieces().size());
+
+        for (int piece = first; piece < last; ++piece)
+        {
+            m_stream.set_piece_deadline(piece, (piece - first) * STREAM_DEADLINE_STEP);
+        }
+
+        m_deadline_piece = first;
+        qDebug() << "Wait for pieces " << first << " - " << last - 1 << " of " << m_file.fileName();
+    }
+
+    QTimer::singleShot(STREAM_POLL_INTERVAL, this, SLOT(fill()));
+}
+
+void HttpConnection::completeUpload()
+{
+    const int elapsed = qMax(m_started.elapsed(), 1);
+
+    qDebug() << "File upload completed: " << m_file.fileName()
+             << (m_zero_copy ? " by sendfile " : " buffered ")
+             << m_sent << " bytes in " << elapsed << " ms, "
+             << m_sent * 1000 / elapsed << " bytes/s";
+
+    if (m_notifier) m_notifier->setEnabled(false);
+    m_file.close();
+    done();
+}
+
+void HttpConnection::respondChunks(const QList<QByteArray>& chunks, bool json)
+{
+    qint64 length = 0;
+
+    foreach(const QByteArray& chunk, chunks)
+    {
+        length += chunk.size();
+    }
+
+    QByteArray header = "HTTP/1.1 200 OK\r\n";
+    header += json ? "Content-Type: application/json; charset=utf-8\r\n" : "Content-Type: text/html; charset=utf-8\r\n";
+    header += connectionHeader();
+    header += "Content-Length: " + QByteArray::number(length) + "\r\n\r\n";
+    m_socket->write(header);
+
+    if (headRequest())
+    {
+        done();
+        return;
+    }
+
+    m_chunks = chunks;
+    m_state = SendingChunks;
+    sendChunks();
+}
+
+void HttpConnection::sendChunks()
+{
+    // listing goes by chunks when peer takes data, like file body
+    while (!m_chunks.isEmpty() && m_socket->bytesToWrite() < UPLOAD_HIGH_WATER)
+    {
+        m_socket->write(m_chunks.takeFirst());
+    }
+
+    if (m_chunks.isEmpty()) done();
 }
 
 QString HttpConnection::contentType(const QString& srcPath)
@@ -311,6 +772,67 @@ QString HttpConnection::contentType(const QString& srcPath)
     return type;
 }
 
+int HttpConnection::parseRanges(const QString& value, qint64 size, QList<ByteRange>& ranges)
+{
+    ranges.clear();
+    const QString spec = value.trimmed();
+    if (!spec.startsWith("bytes=")) return RangeIgnored;
+
+    const QStringList items = spec.mid(6).split(',', QString::SkipEmptyParts);
+    if (items.isEmpty() || items.size() > MAX_RANGES) return RangeIgnored;
+
+    foreach(const QString& item, items)
+    {
+        const int dash = item.indexOf('-');
+        if (dash < 0) return RangeIgnored;
+
+        const QString first = item.left(dash).trimmed();
+        const QString last = item.mid(dash + 1).trimmed();
+        bool ok_first = true;
+        bool ok_last = true;
+        qint64 begin = 0;
+        qint64 end = size - 1;
+
+        if (first.isEmpty())
+        {
+            // suffix range - last bytes of file
+            const qint64 suffix = last.toLongLong(&ok_last);
+            if (!ok_last || suffix < 0) return RangeIgnored;
+            if (suffix == 0 || size == 0) continue;    // empty file has no last bytes
+            begin = qMax(size - suffix, qint64(0));
+        }
+        else
+        {
+            begin = first.toLongLong(&ok_first);
+            if (!last.isEmpty()) end = qMin(last.toLongLong(&ok_last), size - 1);
+            if (!ok_first || !ok_last || begin < 0 || (!last.isEmpty() && last.toLongLong() < begin)) return RangeIgnored;
+            if (begin >= size) continue;
+        }
+
+        ranges << ByteRange(begin, end);
+    }
+
+    return ranges.isEmpty() ? RangeNotSatisfiable : RangeAccepted;
+}
+
+QByteArray HttpConnection::contentRange(const ByteRange& range, qint64 size)
+{
+    return "bytes " + QByteArray::number(range.first) + "-" + QByteArray::number(range.second) +
+        "/" + QByteArray::number(size);
+}
+
+QByteArray HttpConnection::entityTag(const QFileInfo& info)
+{
+    // changes with every write of file, enough to tell versions apart
+    return "\"" + QByteArray::number(info.size(), 16) + "-" +
+        QByteArray::number(info.lastModified().toTime_t(), 16) + "\"";
+}
+
+QByteArray HttpConnection::httpDate(const QDateTime& time)
+{
+    return QLocale::c().toString(time.toUTC(), "ddd, dd MMM yyyy hh:mm:ss").toLatin1() + " GMT";
+}
+
 void HttpConnection::respondNotFound()
 {
     m_generator.setStatusLine(404, "File not found");
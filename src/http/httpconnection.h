@@ -34,14 +34,30 @@
 
 #include "httprequestparser.h"
 #include "httpresponsegenerator.h"
+#include "transport/transfer.h"
 #include <QObject>
+#include <QList>
+#include <QFile>
+#include <QTime>
+#include <QPair>
 
 class HttpServer;
 
 QT_BEGIN_NAMESPACE
 class QTcpSocket;
+class QTimer;
+class QFileInfo;
+class QDateTime;
+class QSocketNotifier;
 QT_END_NAMESPACE
 
+/**
+ * lives in one of server event loop threads, never blocks on socket
+ * file body is written by portions while socket buffer is below high water mark
+ * on Linux body goes from page cache to socket by sendfile, buffered writing is fallback
+ * incomplete transfer file is sent as pieces arrive, connection waits only on missing pieces
+ * connections are persistent, pipelined request is read when previous response is sent
+ */
 class HttpConnection : public QObject
 {
   Q_OBJECT
@@ -49,11 +65,15 @@ class HttpConnection : public QObject
 
 public:
   HttpConnection(HttpServer* m_httpserver, int socketDescriptor);
-  void interrupt();
+  ~HttpConnection();
 
 signals:
   void finished();
 
+public slots:
+  void interrupt();
+  void terminate();
+
 protected slots:
   void finish();
   void respond();
@@ -61,16 +81,107 @@ protected slots:
 private slots:
   void start();
   void read();
+  void fill();
+  void sendFile();
+  void idle();
 
 private:
-  void uploadFile(const QString& srcPath);
+  enum State
+  {
+    Reading,
+    Sending,
+    SendingChunks,
+    Closing
+  };
+
+  enum RangeStatus
+  {
+    RangeIgnored,           // absent or malformed, whole file is sent
+    RangeAccepted,
+    RangeNotSatisfiable
+  };
+
+  typedef QPair<qint64, qint64> ByteRange;    // first and last byte positions
+
+  /**
+    * file region with headers written before it, multipart responses have one part per range
+   */
+  struct Part
+  {
+    Part(const QByteArray& h, qint64 o, qint64 l) : head(h), offset(o), length(l) {}
+    QByteArray head;
+    qint64 offset;
+    qint64 length;
+  };
+
+  /**
+    * transfer is given for incomplete files only
+   */
+  void uploadFile(const QString& srcPath, const Transfer& stream = Transfer(), int index = 0);
   void respondNotFound();
+
+  /**
+    * write response body by listing chunks, whole page isn't joined into one buffer
+   */
+  void respondChunks(const QList<QByteArray>& chunks, bool json);
+  void sendChunks();
   void respondLimitExceeded();
+  bool nextPart();
+
+  /**
+    * bytes of current part which can be sent now
+   */
+  qint64 ready();
+  void waitPieces();
+
+  /**
+    * give back transfer download mode when stream ends or connection is closed
+   */
+  void endStream();
+  void completeUpload();
+
+  /**
+    * response is written, wait for next request or close connection
+   */
+  void done();
+  void close();
+  bool keepAlive() const;
+  bool headRequest() const;
+  QByteArray connectionHeader() const;
   QString contentType(const QString& srcPath);
 
+  /**
+    * parse Range header value against file size, overlapping ranges are sent as requested
+   */
+  static int parseRanges(const QString& value, qint64 size, QList<ByteRange>& ranges);
+  static QByteArray contentRange(const ByteRange& range, qint64 size);
+  static QByteArray entityTag(const QFileInfo& info);
+  static QByteArray httpDate(const QDateTime& time);
+
   HttpServer *m_httpserver;
   int m_socketDescriptor;
-  volatile bool m_interrupted;
+  State m_state;
+  bool m_admitted;
+  bool m_keep_alive;
+  QTimer* m_idle;
+  QFile m_file;
+  bool m_zero_copy;
+  QList<QByteArray> m_chunks;   // listing chunks waiting to be sent
+  QList<Part> m_parts;  // parts waiting to be sent
+  qint64 m_offset;      // file position of current part
+  qint64 m_left;        // bytes of current part to send
+  qint64 m_sent;
+  QTime m_started;
+  bool m_streaming;
+  Transfer m_stream;
+  qint64 m_stream_offset;       // file offset in transfer data
+  qint64 m_piece_length;
+  qint64 m_ready_begin;         // region of file known as downloaded
+  qint64 m_ready_end;
+  int m_deadline_piece;         // first piece of last deadlines window
+  int m_stream_index;
+  bool m_stream_registered;
+  QSocketNotifier* m_notifier;
 
   QTcpSocket *m_socket;
   HttpRequestParser m_parser;
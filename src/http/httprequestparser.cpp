@@ -33,7 +33,10 @@
 #include <QUrl>
 #include <QDebug>
 
-HttpRequestParser::HttpRequestParser(): m_error(false)
+const int MAX_HEADER_SIZE = 64 * 1024;
+const int MAX_MESSAGE_SIZE = 10000000; // ~10MB
+
+HttpRequestParser::HttpRequestParser(): m_error(false), m_scanned(0), m_header_end(-1), m_content_length(0)
 {
 }
 
@@ -70,10 +73,68 @@ const QList<QByteArray>& HttpRequestParser::torrents() const {
   return m_torrents;
 }
 
-void HttpRequestParser::writeHeader(const QByteArray& ba) {
+void HttpRequestParser::reset() {
+  m_header = QHttpRequestHeader();
   m_error = false;
+  m_data.clear();
+  m_path.clear();
+  m_postMap.clear();
+  m_getMap.clear();
+  m_torrents.clear();
+  m_scanned = 0;
+  m_header_end = -1;
+  m_content_length = 0;
+}
+
+HttpRequestParser::Status HttpRequestParser::feed(const QByteArray& buffer) {
+  if (m_header_end < 0) {
+    const int end = buffer.indexOf("\r\n\r\n", m_scanned);
+
+    if (end < 0) {
+      // separator could be split between reads
+      m_scanned = qMax(0, buffer.size() - 3);
+      if (buffer.size() > MAX_HEADER_SIZE) {
+        qWarning() << "Bad request: header too long";
+        return Error;
+      }
+      return Incomplete;
+    }
+
+    // whole header could come with one read
+    if (end > MAX_HEADER_SIZE) {
+      qWarning() << "Bad request: header too long";
+      m_error = true;
+      return Error;
+    }
+
+    // header is converted to QString by QHttpRequestHeader, no intermediate copy of buffer
+    writeHeader(QByteArray::fromRawData(buffer.constData(), end));
+    if (m_error) return Error;
+
+    m_header_end = end + 4;
+    m_content_length = m_header.hasContentLength() ? m_header.contentLength() : 0;
+
+    if (m_content_length < 0 || m_content_length > MAX_MESSAGE_SIZE) {
+      qWarning() << "Bad request: message too long";
+      m_error = true;
+      return Error;
+    }
+  }
+
+  if (buffer.size() < consumed()) return Incomplete;
+
+  if (m_content_length > 0) {
+    writeMessage(buffer.mid(m_header_end, m_content_length));
+    if (m_error) return Error;
+  }
+
+  return Complete;
+}
+
+void HttpRequestParser::writeHeader(const QByteArray& ba) {
   // Parse header
   m_header = QHttpRequestHeader(ba);
+  m_error = !m_header.isValid();
   QUrl url = QUrl::fromEncoded(m_header.path().toAscii());
   m_path = url.path();
 
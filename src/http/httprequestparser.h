@@ -35,9 +35,19 @@
 #include <QHttpRequestHeader>
 #include <QHash>
 
+/**
+ * request is parsed in place from connection receive buffer as data arrives
+ * header is parsed once, pipelined requests following it stay in buffer
+ */
 class HttpRequestParser {
 
 public:
+  enum Status {
+    Incomplete,
+    Complete,
+    Error
+  };
+
   HttpRequestParser();
   ~HttpRequestParser();
   bool isError() const;
@@ -49,6 +59,21 @@ public:
   const QList<QByteArray>& torrents() const;
   void writeHeader(const QByteArray& ba);
   void writeMessage(const QByteArray& ba);
+
+  /**
+    * continue parsing of request at buffer head, buffer must only grow until request is complete
+   */
+  Status feed(const QByteArray& buffer);
+
+  /**
+    * size of complete request in buffer
+   */
+  inline int consumed() const { return m_header_end + m_content_length; }
+
+  /**
+    * prepare for next request on same connection
+   */
+  void reset();
   inline const QHttpRequestHeader& header() const { return m_header; }
 
 private:
@@ -59,6 +84,9 @@ private:
   QHash<QString, QString> m_postMap;
   QHash<QString, QString> m_getMap;
   QList<QByteArray> m_torrents;
+  int m_scanned;          // buffer part checked for header end
+  int m_header_end;       // message offset, -1 until header is received
+  int m_content_length;
 };
 
 #endif
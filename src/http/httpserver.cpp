@@ -7,8 +7,11 @@
 #include <QRegExp>
 #include <QTimer>
 #include <QTcpSocket>
+#include <QThread>
+#include <QMutexLocker>
 
 const int BAN_TIME = 3600000; // 1 hour
+const int HTTP_MAX_WORKERS = 4;
 
 class UnbanTimer: public QTimer {
 public:
@@ -24,57 +27,114 @@ private:
   QString m_peerIp;
 };
 
-HttpServer::HttpServer(QObject* parent): QTcpServer(parent)
+HttpServer::HttpServer(QObject* parent): QTcpServer(parent), m_next_worker(0)
 {
+    Preferences pref;
+    m_uploads_limit = pref.httpSesLimit();
+    m_listing = new ShareListingCache(this);
+
+    // event loops are cheap, few of them are enough for hundreds of clients
+    const int workers = qBound(1, QThread::idealThreadCount(), HTTP_MAX_WORKERS);
+
+    for (int i = 0; i < workers; ++i)
+    {
+        QThread* thread = new QThread(this);
+        thread->start();
+        m_workers << thread;
+    }
 }
 
-HttpServer::~HttpServer() {}
+HttpServer::~HttpServer()
+{
+    close();
+    emit terminated();
+
+    foreach(QThread* thread, m_workers)
+    {
+        thread->quit();
+        thread->wait();
+    }
+}
 
 void HttpServer::incomingConnection(int socketDescriptor)
 {
     HttpConnection* conn = new HttpConnection(this, socketDescriptor);
-    QThread* thread = new QThread(this);
+    QThread* thread = m_workers.at(m_next_worker++ % m_workers.size());
 
-    connect(thread, SIGNAL(started()), conn, SLOT(start()));
-    connect(conn, SIGNAL(finished()), thread, SLOT(quit()));
     connect(conn, SIGNAL(finished()), conn, SLOT(deleteLater()));
-    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    connect(this, SIGNAL(interrupted()), conn, SLOT(interrupt()));
+    connect(this, SIGNAL(terminated()), conn, SLOT(terminate()), Qt::BlockingQueuedConnection);
     conn->moveToThread(thread);
-    thread->start();
+    QMetaObject::invokeMethod(conn, "start", Qt::QueuedConnection);
 }
 
 void HttpServer::stop(bool disconnectClients)
 {
     close(); // stop server listening
+    if (disconnectClients) emit interrupted();
+}
 
-    if (disconnectClients)
+bool HttpServer::admit()
+{
+    for (;;)
     {
-        m_connectionsMutex.lock();
-        foreach(HttpConnection* c, m_connections)
-            c->interrupt();
-        m_connectionsMutex.unlock();
+        const int uploads = m_uploads;
+        if (uploads >= m_uploads_limit) return false;
+        if (m_uploads.testAndSetOrdered(uploads, uploads + 1)) return true;
     }
 }
 
-bool HttpServer::registerConnection(HttpConnection* c)
+void HttpServer::release()
 {
-    Preferences pref;
-    bool res = false;
+    m_uploads.deref();
+}
 
-    m_connectionsMutex.lock();
-    if (m_connections.size() < pref.httpSesLimit())
+void HttpServer::beginStream(const Transfer& t, int index)
+{
+    QMutexLocker locker(&m_streams_mutex);
+    QHash<QString, StreamMode>::iterator itr = m_streams.find(t.hash());
+
+    if (itr == m_streams.end())
     {
-        m_connections.insert(c);
-        res = true;
+        StreamMode mode;
+        mode.streams = 0;
+        mode.sequential = t.is_sequential_download();
+        mode.extremity = t.extremity_pieces_first();
+        itr = m_streams.insert(t.hash(), mode);
+        t.set_sequential_download(true);
+    }
+
+    ++itr->streams;
+
+    if (!itr->files.contains(index))
+    {
+        itr->files.insert(index);
+        t.prioritize_extremity_pieces(true, index);
+    }
+}
+
+void HttpServer::endStream(const Transfer& t, int index)
+{
+    Q_UNUSED(index);
+    QMutexLocker locker(&m_streams_mutex);
+    QHash<QString, StreamMode>::iterator itr = m_streams.find(t.hash());
+    if (itr == m_streams.end() || --itr->streams > 0) return;
+
+    // transfer could be removed or completed while streaming
+    if (t.is_valid() && !t.is_seed())
+    {
+        t.set_sequential_download(itr->sequential);
+
+        if (!itr->extremity)
+        {
+            foreach(int file, itr->files) t.prioritize_extremity_pieces(false, file);
+        }
     }
-    m_connectionsMutex.unlock();
 
-    return res;
+    m_streams.erase(itr);
 }
 
-void HttpServer::unregisterConnection(HttpConnection* c)
+void HttpServer::setUploadsLimit(int limit)
 {
-    m_connectionsMutex.lock();
-    m_connections.remove(c);
-    m_connectionsMutex.unlock();
+    m_uploads_limit = limit;
 }
@@ -34,20 +34,26 @@
 #include <QPair>
 #include <QTcpServer>
 #include <QByteArray>
+#include <QAtomicInt>
 #include <QHash>
-#include <QTimer>
-#include <QThreadPool>
+#include <QList>
 #include <QMutex>
 #include <QSet>
+#include <QSharedPointer>
+
+#include "share_listing.h"
+#include "transport/transfer.h"
 
-class EventManager;
 class HttpConnection;
 
 QT_BEGIN_NAMESPACE
-class QTimer;
+class QThread;
 QT_END_NAMESPACE
 
-
+/**
+ * connections are served by small fixed set of event loop threads, sockets are never blocked
+ * file uploads are limited by admission counter
+ */
 class HttpServer : public QTcpServer
 {
     Q_OBJECT
@@ -56,11 +62,52 @@ public:
     HttpServer(QObject* parent = 0);
     ~HttpServer();
     void stop(bool disconnectClients);
-    bool registerConnection(HttpConnection* c);
-    void unregisterConnection(HttpConnection* c);
+
+    /**
+      * take upload slot, false when uploads limit reached
+     */
+    bool admit();
+    void release();
+    void setUploadsLimit(int limit);
+
+    /**
+      * first stream of transfer switches it to sequential download with extremity pieces first
+      * previous mode is restored when last stream of transfer ends
+     */
+    void beginStream(const Transfer& t, int index);
+    void endStream(const Transfer& t, int index);
+
+    /**
+      * current listing of shared files, safe for connection threads
+     */
+    QSharedPointer<const ShareListing> listing() const { return m_listing->listing(); }
+signals:
+    /**
+      * stop all uploads, delivered to connections in their threads
+     */
+    void interrupted();
+
+    /**
+      * close and delete all connections, blocks until each worker thread handled it
+     */
+    void terminated();
 private:
-    QSet<HttpConnection*> m_connections;
-    QMutex m_connectionsMutex;
+    ShareListingCache* m_listing;
+    QList<QThread*> m_workers;
+    int             m_next_worker;
+    QAtomicInt      m_uploads;
+    QAtomicInt      m_uploads_limit;
+
+    struct StreamMode
+    {
+        int         streams;
+        bool        sequential;
+        bool        extremity;
+        QSet<int>   files;
+    };
+
+    QHash<QString, StreamMode> m_streams;   // by transfer hash
+    QMutex          m_streams_mutex;
 
     void incomingConnection(int socketDescriptor);
 };
@@ -0,0 +1,275 @@
+#include <QDebug>
+#include <QMap>
+#include <QMutexLocker>
+#include <QTime>
+#include <QUrl>
+
+#include "share_listing.h"
+#include "transport/session.h"
+#include "misc.h"
+
+const int LISTING_REBUILD_DELAY = 1000;   // milliseconds, events during this time are one rebuild
+const int LISTING_CHUNK_ITEMS = 50;       // items rendered into one output chunk
+
+namespace
+{
+    QString escapeHtml(const QString& s)
+    {
+        QString res;
+        res.reserve(s.size());
+
+        for (int i = 0; i < s.size(); ++i)
+        {
+            const QChar c = s.at(i);
+            if (c == QLatin1Char('<')) res += QLatin1String("&lt;");
+            else if (c == QLatin1Char('>')) res += QLatin1String("&gt;");
+            else if (c == QLatin1Char('&')) res += QLatin1String("&amp;");
+            else if (c == QLatin1Char('"')) res += QLatin1String("&quot;");
+            else res += c;
+        }
+
+        return res;
+    }
+
+    QString escapeJson(const QString& s)
+    {
+        QString res;
+        res.reserve(s.size() + 2);
+        res += QLatin1Char('"');
+
+        for (int i = 0; i < s.size(); ++i)
+        {
+            const QChar c = s.at(i);
+            if (c == QLatin1Char('"')) res += QLatin1String("\\\"");
+            else if (c == QLatin1Char('\\')) res += QLatin1String("\\\\");
+            else if (c.unicode() < 0x20) res += QString("\\u%1").arg(c.unicode(), 4, 16, QLatin1Char('0'));
+            else res += c;
+        }
+
+        res += QLatin1Char('"');
+        return res;
+    }
+
+    QByteArray pageHeader(const QString& title)
+    {
+        return ("<html><head>"
+                "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">"
+                "<title>" + escapeHtml(title) + "</title>"
+                "</head><body>"
+                "<style>"
+                "li { list-style-type: none; }"
+                "ul { margin-left: 4; padding-left: 4; margin-top: 4; padding-top: 4; }"
+                "li.marked { list-style-type: disc; margin-left: 20; }"
+                "</style>\n").toUtf8();
+    }
+
+    /**
+      * first, previous, next and last page links
+     */
+    QByteArray pageLinks(const QString& base, int page, int pages)
+    {
+        if (pages <= 1) return QByteArray();
+        const QString sep = base.contains(QLatin1Char('?')) ? "&" : "?";
+        QString res = "<p>";
+
+        if (page > 1)
+        {
+            res += QString("<a href=\"%1%2page=1\">&lt;&lt;</a> ").arg(base, sep);
+            res += QString("<a href=\"%1%2page=%3\">&lt;</a> ").arg(base, sep).arg(page - 1);
+        }
+
+        res += QString("%1 / %2").arg(page).arg(pages);
+
+        if (page < pages)
+        {
+            res += QString(" <a href=\"%1%2page=%3\">&gt;</a>").arg(base, sep).arg(page + 1);
+            res += QString(" <a href=\"%1%2page=%3\">&gt;&gt;</a>").arg(base, sep).arg(pages);
+        }
+
+        res += "</p>\n";
+        return res.toUtf8();
+    }
+
+    int pagesCount(int items, int per_page)
+    {
+        return qMax(1, (items + per_page - 1) / per_page);
+    }
+}
+
+QList<QByteArray> ShareListing::renderIndex(int page, bool json, const QString& title) const
+{
+    QList<QByteArray> res;
+    const int pages = pagesCount(m_dirs.size(), dirs_per_page);
+    page = qBound(1, page, pages);
+    const int first = (page - 1) * dirs_per_page;
+    const int last = qMin(m_dirs.size(), first + dirs_per_page);
+    QString chunk;
+
+    if (json)
+        chunk = QString("{\"page\":%1,\"pages\":%2,\"dirs\":[").arg(page).arg(pages);
+    else
+        res << pageHeader(title) + "<h3>" + escapeHtml(title).toUtf8() + "</h3>\n<ul>\n";
+
+    for (int i = first; i < last; ++i)
+    {
+        const Dir& dir = m_dirs.at(i);
+
+        if (json)
+        {
+            if (i != first) chunk += QLatin1Char(',');
+            chunk += QString("{\"path\":%1,\"files\":%2}").arg(escapeJson(dir.path)).arg(dir.files.size());
+        }
+        else
+        {
+            chunk += QString("<li><a href=\"/dir?path=%1\">%2</a> (%3)</li>\n")
+                .arg(QString::fromLatin1(QUrl::toPercentEncoding(dir.path).constData()))
+                .arg(escapeHtml(dir.path)).arg(dir.files.size());
+        }
+
+        if ((i - first + 1) % LISTING_CHUNK_ITEMS == 0)
+        {
+            res << chunk.toUtf8();
+            chunk.clear();
+        }
+    }
+
+    if (json)
+        chunk += "]}";
+    else
+        chunk += "</ul>\n" + QString::fromUtf8(pageLinks("/", page, pages).constData()) + "</body></html>";
+
+    res << chunk.toUtf8();
+    return res;
+}
+
+QList<QByteArray> ShareListing::renderDirectory(const QString& path, int page, bool json, const QString& title) const
+{
+    QList<QByteArray> res;
+    QHash<QString, int>::const_iterator itr = m_index.constFind(path);
+    if (itr == m_index.constEnd()) return res;
+
+    const Dir& dir = m_dirs.at(itr.value());
+    const int pages = pagesCount(dir.files.size(), files_per_page);
+    page = qBound(1, page, pages);
+    const int first = (page - 1) * files_per_page;
+    const int last = qMin(dir.files.size(), first + files_per_page);
+    QString chunk;
+
+    if (json)
+    {
+        chunk = QString("{\"path\":%1,\"page\":%2,\"pages\":%3,\"files\":[").arg(escapeJson(dir.path)).arg(page).arg(pages);
+    }
+    else
+    {
+        res << pageHeader(title) + "<p><a href=\"/\">" + escapeHtml(title).toUtf8() + "</a></p>\n<ul><li>" +
+            escapeHtml(dir.path).toUtf8() + "</li>\n";
+    }
+
+    for (int i = first; i < last; ++i)
+    {
+        const File& f = dir.files.at(i);
+
+        if (json)
+        {
+            if (i != first) chunk += QLatin1Char(',');
+            chunk += QString("{\"name\":%1,\"hash\":\"%2\",\"size\":%3}").arg(escapeJson(f.name)).arg(f.hash).arg(f.size);
+        }
+        else
+        {
+            chunk += QString("<li class=\"marked\"><a href=\"/%1\">%2</a></li>\n").arg(f.hash).arg(escapeHtml(f.name));
+        }
+
+        if ((i - first + 1) % LISTING_CHUNK_ITEMS == 0)
+        {
+            res << chunk.toUtf8();
+            chunk.clear();
+        }
+    }
+
+    if (json)
+    {
+        chunk += "]}";
+    }
+    else
+    {
+        const QString base = "/dir?path=" + QString::fromLatin1(QUrl::toPercentEncoding(dir.path).constData());
+        chunk += "</ul>\n" + QString::fromUtf8(pageLinks(base, page, pages).constData()) + "</body></html>";
+    }
+
+    res << chunk.toUtf8();
+    return res;
+}
+
+ShareListingCache::ShareListingCache(QObject* parent /* = 0*/) : QObject(parent), m_listing(new ShareListing)
+{
+    m_rebuild.setSingleShot(true);
+    m_rebuild.setInterval(LISTING_REBUILD_DELAY);
+    connect(&m_rebuild, SIGNAL(timeout()), SLOT(rebuild()));
+
+    // listing contains registered files only, tree events matter when files move with directories
+    Session* session = Session::instance();
+    connect(session, SIGNAL(insertSharedFile(FileNode*)), SLOT(invalidate()));
+    connect(session, SIGNAL(removeSharedFile(FileNode*)), SLOT(invalidate()));
+    connect(session, SIGNAL(insertSharedDirectory(const DirNode*)), SLOT(invalidate()));
+    connect(session, SIGNAL(removeSharedDirectory(const DirNode*)), SLOT(invalidate()));
+    connect(session, SIGNAL(endRemoveNode()), SLOT(invalidate()));
+    connect(session, SIGNAL(endLoadSharedFileSystem()), SLOT(invalidate()));
+    invalidate();
+}
+
+QSharedPointer<const ShareListing> ShareListingCache::listing() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_listing;
+}
+
+void ShareListingCache::invalidate()
+{
+    // don't postpone rebuild by continuous events
+    if (!m_rebuild.isActive()) m_rebuild.start();
+}
+
+void ShareListingCache::rebuild()
+{
+    QTime timer;
+    timer.start();
+    QMap<QString, QMap<QString, ShareListing::File> > dirs;   // sorted by path and by sort name
+
+    foreach(const FileNode* p, Session::instance()->files())
+    {
+        if (!p->has_transfer() || !p->m_parent || !misc::isPreviewable(p->filename().section(".", -1)))
+            continue;
+
+        ShareListing::File f;
+        f.name = p->filename();
+        f.hash = p->hash();
+        f.size = p->size_on_disk();
+        dirs[p->m_parent->path()].insert(p->sort_name() + QLatin1Char('/') + f.name, f);
+    }
+
+    ShareListing* listing = new ShareListing;
+    listing->m_dirs.reserve(dirs.size());
+
+    for (QMap<QString, QMap<QString, ShareListing::File> >::const_iterator itr = dirs.constBegin(); itr != dirs.constEnd(); ++itr)
+    {
+        ShareListing::Dir dir;
+        dir.path = itr.key();
+        dir.files.reserve(itr.value().size());
+
+        foreach(const ShareListing::File& f, itr.value())
+        {
+            dir.files.append(f);
+        }
+
+        listing->m_index.insert(dir.path, listing->m_dirs.size());
+        listing->m_dirs.append(dir);
+    }
+
+    {
+        // requests in progress keep previous listing alive
+        QMutexLocker lock(&m_mutex);
+        m_listing = QSharedPointer<const ShareListing>(listing);
+    }
+
+    qDebug() << "share listing rebuilt: " << listing->m_dirs.size() << " dirs in " << timer.elapsed() << " ms";
+}
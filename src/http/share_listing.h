@@ -0,0 +1,69 @@
+#ifndef __SHARE_LISTING_H__
+#define __SHARE_LISTING_H__
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * immutable listing of shared previewable files grouped by directory
+ * pages are rendered from listing data, shared tree isn't touched by HTTP threads
+ */
+class ShareListing
+{
+public:
+    enum { dirs_per_page = 50, files_per_page = 200 };
+
+    struct File
+    {
+        QString name;
+        QString hash;
+        qint64  size;
+    };
+
+    struct Dir
+    {
+        QString         path;
+        QVector<File>   files;
+    };
+
+    /**
+      * main page with directories, page is 1-based
+     */
+    QList<QByteArray> renderIndex(int page, bool json, const QString& title) const;
+
+    /**
+      * page of directory files, empty list when directory isn't in listing
+     */
+    QList<QByteArray> renderDirectory(const QString& path, int page, bool json, const QString& title) const;
+
+    QVector<Dir>        m_dirs;     // sorted by path
+    QHash<QString, int> m_index;    // directory path -> position
+};
+
+/**
+ * keeps listing of current shared files, listing is rebuilt on GUI thread after filesystem events settle
+ * any thread takes current listing
+ */
+class ShareListingCache : public QObject
+{
+    Q_OBJECT
+public:
+    ShareListingCache(QObject* parent = 0);
+    QSharedPointer<const ShareListing> listing() const;
+private slots:
+    void invalidate();
+    void rebuild();
+private:
+    QSharedPointer<const ShareListing>  m_listing;
+    mutable QMutex  m_mutex;
+    QTimer          m_rebuild;
+};
+
+#endif //__SHARE_LISTING_H__
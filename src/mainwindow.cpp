@@ -1237,6 +1237,8 @@ void MainWindow::loadPreferences(bool configure_session)
   //
   if (!m_http_server.isNull())
   {
+      m_http_server->setUploadsLimit(pref.httpSesLimit());
+
       // close server conditions
       if (!pref.runHttpServer() || (m_http_server->serverPort() != pref.httpPort()))
       {
@@ -830,6 +830,19 @@ public:
       return value(QString::fromUtf8("Preferences/eDonkey/HttpPort"), 8080).toInt();
   }
 
+  /**
+    * shared files hashing threads count, zero means count of processors
+   */
+  void setHashingThreads(int threads)
+  {
+      setValue(QString::fromUtf8("Preferences/eDonkey/HashingThreads"), threads);
+  }
+
+  int hashingThreads() const
+  {
+      return value(QString::fromUtf8("Preferences/eDonkey/HashingThreads"), 0).toInt();
+  }
+
   void setRunHttpServer(bool enabled)
   {
       setValue(QString::fromUtf8("Preferences/eDonkey/RunHttpServer"), enabled);
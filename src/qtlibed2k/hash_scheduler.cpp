@@ -0,0 +1,240 @@
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#ifndef Q_OS_WIN
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/sysmacros.h>
+#endif
+
+#include <libed2k/file.hpp>
+
+#include "hash_scheduler.h"
+
+class HashScheduler::Worker : public QRunnable
+{
+public:
+    Worker(HashScheduler* scheduler, Job* job) : m_scheduler(scheduler), m_job(job) {}
+
+    void run()
+    {
+        // file2atp takes plain bool& and polls it between file reads without any synchronization,
+        // so cancel is best effort - loop stops on some later poll, scheduler ignores result of cancelled job
+        std::pair<libed2k::add_transfer_params, libed2k::error_code> res =
+            libed2k::file2atp()(m_job->filepath.toUtf8().constData(), m_job->cancel);
+        m_scheduler->finished(m_job, res);
+    }
+private:
+    HashScheduler*  m_scheduler;
+    Job*            m_job;
+};
+
+HashScheduler::HashScheduler(int workers, QObject* parent /* = 0*/) :
+    QObject(parent),
+    m_workers(workers > 0 ? workers : QThread::idealThreadCount()),
+    m_running(0),
+    m_bytes(0)
+{
+    if (m_workers < 1) m_workers = 1;
+    m_pool.setMaxThreadCount(m_workers);
+    qDebug() << "hash scheduler started with " << m_workers << " workers";
+}
+
+HashScheduler::~HashScheduler()
+{
+    cancelAll();
+}
+
+void HashScheduler::enqueue(const QString& filepath)
+{
+    const QString id = deviceId(filepath);
+    const qint64 size = QFileInfo(filepath).size();
+
+    QMutexLocker locker(&m_mutex);
+    if (m_jobs.contains(filepath)) return;
+    if (m_jobs.isEmpty()) { m_busy.start(); m_bytes = 0; }
+
+    Job* job = new Job;
+    job->filepath = filepath;
+    job->device = id;
+    job->size = size;
+    job->running = false;
+    job->cancel = false;
+    m_jobs.insert(filepath, job);
+
+    QHash<QString, Device>::iterator itr = m_devices.find(id);
+
+    if (itr == m_devices.end())
+    {
+        Device d;
+        d.limit = deviceReaders(filepath, m_workers);
+        qDebug() << "hashing device " << id << " readers " << d.limit;
+        d.running = 0;
+        itr = m_devices.insert(id, d);
+    }
+
+    itr->queue.insert(size, job);
+    dispatch();
+}
+
+void HashScheduler::cancel(const QString& filepath)
+{
+    QMutexLocker locker(&m_mutex);
+    Job* job = m_jobs.value(filepath);
+    if (!job) return;
+
+    m_jobs.remove(filepath);
+
+    if (job->running)
+    {
+        // worker owns job, it will be deleted on finish
+        job->cancel = true;
+    }
+    else
+    {
+        m_devices[job->device].queue.remove(job->size, job);
+        delete job;
+    }
+}
+
+void HashScheduler::cancelAll()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        for (QHash<QString, Job*>::iterator itr = m_jobs.begin(); itr != m_jobs.end(); ++itr)
+        {
+            if (itr.value()->running)
+                itr.value()->cancel = true;
+            else
+                delete itr.value();
+        }
+
+        m_jobs.clear();
+
+        for (QHash<QString, Device>::iterator itr = m_devices.begin(); itr != m_devices.end(); ++itr)
+            itr->queue.clear();
+    }
+
+    m_pool.waitForDone();
+
+    QMutexLocker locker(&m_mutex);
+    m_results.clear();
+}
+
+int HashScheduler::queueDepth() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_jobs.size();
+}
+
+qreal HashScheduler::throughput() const
+{
+    QMutexLocker locker(&m_mutex);
+    const int elapsed = m_busy.elapsed();
+    return (elapsed > 0) ? m_bytes * 1000.0 / elapsed : 0;
+}
+
+void HashScheduler::dispatch()
+{
+    while (m_running < m_workers)
+    {
+        Device* best = 0;
+
+        // smallest waiting file among devices which have free reader
+        for (QHash<QString, Device>::iterator itr = m_devices.begin(); itr != m_devices.end(); ++itr)
+        {
+            if (itr->running >= itr->limit || itr->queue.isEmpty()) continue;
+            if (!best || itr->queue.begin().key() < best->queue.begin().key()) best = &itr.value();
+        }
+
+        if (!best) break;
+
+        Job* job = best->queue.begin().value();
+        best->queue.erase(best->queue.begin());
+        ++best->running;
+        ++m_running;
+        job->running = true;
+        m_pool.start(new Worker(this, job));
+    }
+}
+
+void HashScheduler::finished(Job* job, const std::pair<libed2k::add_transfer_params, libed2k::error_code>& res)
+{
+    QMutexLocker locker(&m_mutex);
+    --m_devices[job->device].running;
+    --m_running;
+
+    if (!job->cancel)
+    {
+        m_jobs.remove(job->filepath);
+        m_bytes += job->size;
+        m_results.push_back(res);
+        if (m_results.size() == 1) QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+
+    delete job;
+    dispatch();
+}
+
+void HashScheduler::deliver()
+{
+    std::deque<std::pair<libed2k::add_transfer_params, libed2k::error_code> > results;
+    int depth;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_results);
+        depth = m_jobs.size();
+    }
+
+    for (size_t i = 0; i < results.size(); ++i)
+        emit hashed(results[i].first, results[i].second);
+
+    if (depth == 0)
+        qDebug() << "hashing queue is empty, throughput " << throughput() / 1024 / 1024 << " MiB/s";
+    else
+        qDebug() << "hashing queue depth " << depth << ", throughput " << throughput() / 1024 / 1024 << " MiB/s";
+}
+
+QString HashScheduler::deviceId(const QString& filepath)
+{
+#ifdef Q_OS_WIN
+    // drive is the best guess of physical device
+    return QDir::toNativeSeparators(QFileInfo(filepath).absoluteFilePath()).left(2).toUpper();
+#else
+    struct stat st;
+    if (::stat(QFile::encodeName(filepath).constData(), &st) != 0) return QString();
+    return QString::number(quint64(st.st_dev));
+#endif
+}
+
+int HashScheduler::deviceReaders(const QString& filepath, int workers)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(filepath).constData(), &st) != 0) return 1;
+
+    // partitions have no queue, it is in parent block device
+    const QString sys = QString("/sys/dev/block/%1:%2").arg(major(st.st_dev)).arg(minor(st.st_dev));
+    QFile rotational(sys + "/queue/rotational");
+    if (!rotational.exists()) rotational.setFileName(sys + "/../queue/rotational");
+
+    if (rotational.open(QIODevice::ReadOnly) && rotational.readAll().trimmed() == "0")
+        return workers;
+#else
+    Q_UNUSED(filepath);
+    Q_UNUSED(workers);
+#endif
+    // rotational or unknown device - sequential reading only
+    return 1;
+}
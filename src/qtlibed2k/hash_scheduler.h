@@ -0,0 +1,100 @@
+#ifndef __HASH_SCHEDULER_H__
+#define __HASH_SCHEDULER_H__
+
+#include <deque>
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTime>
+
+#include <libed2k/add_transfer_params.hpp>
+#include <libed2k/error_code.hpp>
+
+/**
+ * hashes shared files on pool of workers
+ * jobs are grouped by physical device - one reader per rotational disk, all workers for solid state one
+ * small files go first on every device, so collections of small files become ready early
+ * results are reported in thread of scheduler
+ */
+class HashScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+      * zero workers means count of processors
+     */
+    HashScheduler(int workers, QObject* parent = 0);
+    ~HashScheduler();
+
+    void enqueue(const QString& filepath);
+
+    /**
+      * remove waiting job or interrupt running one, result of cancelled job isn't reported
+     */
+    void cancel(const QString& filepath);
+
+    /**
+      * cancel all jobs and wait running ones
+     */
+    void cancelAll();
+
+    /**
+      * waiting and running jobs count
+     */
+    int queueDepth() const;
+
+    /**
+      * hashed bytes per second since scheduler became busy
+     */
+    qreal throughput() const;
+signals:
+    void hashed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec);
+private slots:
+    void deliver();
+private:
+    struct Job
+    {
+        QString filepath;
+        QString device;
+        qint64  size;
+        bool    running;
+        bool    cancel;     // written under m_mutex only, hashing loop polls it without lock
+    };
+
+    struct Device
+    {
+        int limit;                          // parallel readers
+        int running;
+        QMultiMap<qint64, Job*> queue;      // by file size
+    };
+
+    class Worker;
+    friend class Worker;
+
+    void dispatch();
+    void finished(Job* job, const std::pair<libed2k::add_transfer_params, libed2k::error_code>& res);
+
+    /**
+      * physical device identifier of file
+     */
+    static QString deviceId(const QString& filepath);
+
+    /**
+      * parallel readers for device of file
+     */
+    static int deviceReaders(const QString& filepath, int workers);
+
+    int                     m_workers;
+    int                     m_running;
+    QThreadPool             m_pool;
+    QHash<QString, Job*>    m_jobs;     // by file path
+    QHash<QString, Device>  m_devices;
+    std::deque<std::pair<libed2k::add_transfer_params, libed2k::error_code> > m_results;
+    QTime                   m_busy;     // started when first job of busy period was queued
+    qint64                  m_bytes;    // hashed bytes in busy period
+    mutable QMutex          m_mutex;
+};
+
+#endif //__HASH_SCHEDULER_H__
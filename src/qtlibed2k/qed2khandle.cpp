@@ -146,6 +146,12 @@ TransferSize QED2KHandle::filesize_at(unsigned int index) const
     return m_delegate.size();
 }
 
+TransferSize QED2KHandle::file_offset_at(unsigned int index) const
+{
+    Q_ASSERT(index == 0);
+    return 0;
+}
+
 std::vector<int> QED2KHandle::file_extremity_pieces_at(unsigned int index) const {
     Q_ASSERT(index == 0);
     int last_piece = m_delegate.num_pieces() - 1;
@@ -216,6 +222,9 @@ void QED2KHandle::queue_position_top() const {}
 void QED2KHandle::queue_position_bottom() const {}
 void QED2KHandle::super_seeding(bool ss) const {}
 void QED2KHandle::set_sequential_download(bool sd) const { m_delegate.set_sequential_download(sd); }
+// ed2k transfers have no piece deadlines, streaming relies on sequential download only -
+// raised piece priority would never be restored when stream ends
+void QED2KHandle::set_piece_deadline(int index, int deadline) const {}
 void QED2KHandle::save_resume_data() const { m_delegate.save_resume_data(); }
 bool QED2KHandle::need_save_resume_data() const { return m_delegate.need_save_resume_data(); }
 void QED2KHandle::set_upload_mode(bool b) const { m_delegate.set_upload_mode(b); }
@@ -51,6 +51,7 @@ public:
     QString filepath_at(unsigned int index) const;
     QString filename_at(unsigned int index) const;
     TransferSize filesize_at(unsigned int index) const;
+    TransferSize file_offset_at(unsigned int index) const;
     std::vector<int> file_extremity_pieces_at(unsigned int index) const;
     QStringList url_seeds() const;
     QStringList absolute_files_path() const;
@@ -81,6 +82,7 @@ public:
     void queue_position_bottom() const;
     void super_seeding(bool ss) const;
     void set_sequential_download(bool sd) const;
+    void set_piece_deadline(int index, int deadline) const;
     void save_resume_data() const;
     bool need_save_resume_data() const;
     void set_upload_mode(bool b) const;
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include "qed2ksession.h"
 #include <libed2k/bencode.hpp>
 #include <libed2k/file.hpp>
@@ -16,6 +17,7 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QThread>
+#include <QtConcurrentMap>
 
 #include "preferences.h"
 
@@ -189,42 +191,7 @@ QED2KPeerOptions::QED2KPeerOptions(const libed2k::misc_options& mo, const libed2
     m_bLargeFiles       = mo2.support_large_files();
 }
 
-bool writeResumeData(const libed2k::save_resume_data_alert* p)
-{
-    qDebug() << Q_FUNC_INFO;
-    try
-    {
-        QED2KHandle h(p->m_handle);
-        qDebug() << "save fast resume data for " << h.hash();
-
-        if (h.is_valid() && p->resume_data)
-        {
-            QDir libed2kBackup(misc::ED2KBackupLocation());
-            // Remove old fastresume file if it exists
-            std::vector<char> out;
-            libed2k::bencode(back_inserter(out), *p->resume_data);
-            const QString filepath = libed2kBackup.absoluteFilePath(h.hash() +".fastresume");
-            libed2k::transfer_resume_data trd(p->m_handle.hash(), p->m_handle.save_path(), p->m_handle.name(), p->m_handle.size(), out);
-
-            std::ofstream fs(filepath.toLocal8Bit(), std::ios_base::out | std::ios_base::binary);
-
-            if (fs)
-            {
-                libed2k::archive::ed2k_oarchive oa(fs);
-                oa << trd;
-                return true;
-            }
-        }
-    }
-    catch(const libed2k::libed2k_exception& e)
-    {
-        qDebug() << "error on write resume data " << misc::toQStringU(e.what());
-    }
-
-    return false;
-}
-
-bool writeResumeDataOne(std::ofstream& fs, const libed2k::save_resume_data_alert* p)
+bool writeResumeDataOne(std::ostream& fs, const libed2k::save_resume_data_alert* p)
 {
     try
     {
@@ -251,14 +218,20 @@ bool writeResumeDataOne(std::ofstream& fs, const libed2k::save_resume_data_alert
 namespace aux
 {
 
-QED2KSession::QED2KSession()
+QED2KSession::QED2KSession() :
+    m_startupTimer("ed2k"),
+    m_hasher(new HashScheduler(Preferences().hashingThreads()))
 {
     connect(&finishTimer, SIGNAL(timeout()), this, SLOT(finishLoad()));
+    connect(m_hasher.data(), SIGNAL(hashed(const libed2k::add_transfer_params&, const libed2k::error_code&)),
+            this, SLOT(on_hashed(const libed2k::add_transfer_params&, const libed2k::error_code&)));
+    registerAlertHandlers();
 }
 
 void QED2KSession::start()
 {
     qDebug() <<  Q_FUNC_INFO;
+    m_paramsCache.open(QDir(misc::ED2KBackupLocation()).absoluteFilePath("hashes.journal"));
     Preferences pref;
     libed2k::session_settings settings;
     libed2k::fingerprint finger;
@@ -335,6 +308,9 @@ void QED2KSession::start()
 
 void QED2KSession::stop()
 {
+    // transfers not added yet keep their records in journal
+    m_resume_queue.clear();
+    m_hasher->cancelAll();
     m_session->pause();
     saveFastResumeData();
 }
@@ -347,6 +323,8 @@ QED2KSession::~QED2KSession()
     {
         stop();
     }
+
+    qDeleteAll(m_pendingAlerts.begin(), m_pendingAlerts.end());
 }
 
 
@@ -405,7 +383,12 @@ void QED2KSession::deleteTransfer(const QString& hash, bool delete_files)
         t.ed2kHandle().delegate(),
         delete_files ? libed2k::session::delete_files : libed2k::session::none);
 
-    if (QFile::remove(QDir(misc::ED2KBackupLocation()).absoluteFilePath(hash + ".fastresume")))
+    // under pump lock so worker can not put resume data of this hash back after removal
+    QMutexLocker locker(&m_pumpMutex);
+    m_removedHashes << hash;
+    m_journal.remove(hash.toLatin1());
+
+    if (m_journal.commit())
     {
         qDebug() << "Also deleted temp fast resume data: " << hash;
     }
@@ -414,6 +397,7 @@ void QED2KSession::deleteTransfer(const QString& hash, bool delete_files)
         qDebug() << "fast resume wasn't removed for " << hash;
     }
 
+    locker.unlock();
     emit deletedTransfer(hash);
 }
 void QED2KSession::recheckTransfer(const QString& hash) {}
@@ -439,7 +423,7 @@ void QED2KSession::setUploadRateLimit(long rate) {
 void QED2KSession::finishLoad()
 {
     qDebug() << "finish timer exeuted";
-    if (!m_fast_resume_transfers.empty())
+    if (!m_fast_resume_transfers.empty() && m_resume_queue.empty())
     {
         qDebug() << "emit load completed";
         emit fastResumeDataLoadCompleted();
@@ -610,6 +594,12 @@ QED2KHandle QED2KSession::addTransfer(const libed2k::add_transfer_params& atp)
         }
     }
 
+    {
+        // hash was added again after removal, its resume data may be saved
+        QMutexLocker locker(&m_pumpMutex);
+        m_removedHashes.remove(misc::toQString(atp.file_hash));
+    }
+
     QED2KHandle ret = QED2KHandle(delegate()->add_transfer(atp));
     Preferences pref;
     if (pref.addTorrentsInPause()){
@@ -708,205 +698,301 @@ libed2k::peer_connection_handle QED2KSession::findPeer(const libed2k::net_identi
     return pch;
 }
 
+#define ED2K_ALERT_HANDLER(type, method) \
+    m_alertDispatcher.add<libed2k::type>(#type, boost::bind(&QED2KSession::method, this, _1))
+
+void QED2KSession::registerAlertHandlers()
+{
+    ED2K_ALERT_HANDLER(server_name_resolved_alert, on_serverNameResolved);
+    ED2K_ALERT_HANDLER(server_connection_initialized_alert, on_serverConnectionInitialized);
+    ED2K_ALERT_HANDLER(server_status_alert, on_serverStatus);
+    ED2K_ALERT_HANDLER(server_identity_alert, on_serverIdentity);
+    ED2K_ALERT_HANDLER(server_message_alert, on_serverMessage);
+    ED2K_ALERT_HANDLER(server_connection_closed, on_serverConnectionClosed);
+    // shared files alert and its descendants are routed to the same handler
+    ED2K_ALERT_HANDLER(shared_files_alert, on_sharedFiles);
+    ED2K_ALERT_HANDLER(shared_directory_files_alert, on_sharedFiles);
+    ED2K_ALERT_HANDLER(ismod_shared_directory_files_alert, on_sharedFiles);
+    ED2K_ALERT_HANDLER(mule_listen_failed_alert, on_muleListenFailed);
+    ED2K_ALERT_HANDLER(peer_connected_alert, on_peerConnected);
+    ED2K_ALERT_HANDLER(peer_disconnected_alert, on_peerDisconnected);
+    ED2K_ALERT_HANDLER(peer_message_alert, on_peerMessage);
+    ED2K_ALERT_HANDLER(peer_captcha_request_alert, on_peerCaptchaRequest);
+    ED2K_ALERT_HANDLER(peer_captcha_result_alert, on_peerCaptchaResult);
+    ED2K_ALERT_HANDLER(shared_files_access_denied, on_sharedFilesAccessDenied);
+    ED2K_ALERT_HANDLER(shared_directories_alert, on_sharedDirectories);
+    ED2K_ALERT_HANDLER(added_transfer_alert, on_addedTransfer);
+    ED2K_ALERT_HANDLER(paused_transfer_alert, on_pausedTransfer);
+    ED2K_ALERT_HANDLER(resumed_transfer_alert, on_resumedTransfer);
+    ED2K_ALERT_HANDLER(deleted_transfer_alert, on_deletedTransfer);
+    ED2K_ALERT_HANDLER(finished_transfer_alert, on_finishedTransfer);
+    ED2K_ALERT_HANDLER(transfer_params_alert, on_transferParams);
+    ED2K_ALERT_HANDLER(file_renamed_alert, on_fileRenamed);
+    ED2K_ALERT_HANDLER(storage_moved_alert, on_storageMoved);
+    ED2K_ALERT_HANDLER(file_error_alert, on_fileError);
+
+    // resume data goes to disk directly from session worker thread
+    m_workerDispatcher.add<libed2k::save_resume_data_alert>(
+        "save_resume_data_alert", boost::bind(&QED2KSession::writeResumeData, this, _1));
+}
+
+#undef ED2K_ALERT_HANDLER
+
+bool QED2KSession::pumpAlerts()
+{
+    QMutexLocker locker(&m_pumpMutex);
+    const bool published = m_alertQueue.pump(m_session.data(), m_workerDispatcher);
+    // resume data collected from this batch goes to disk with one fsync
+    m_journal.commit();
+    return published;
+}
+
+// Runs on session worker thread under m_pumpMutex, or on GUI thread after worker was halted
+bool QED2KSession::writeResumeData(const libed2k::save_resume_data_alert* p)
+{
+    std::ostringstream fs(std::ios_base::out | std::ios_base::binary);
+    if (!writeResumeDataOne(fs, p)) return false;
+
+    const std::string data = fs.str();
+    const QString hash = QED2KHandle(p->m_handle).hash();
+    if (m_removedHashes.contains(hash)) return false;
+    qDebug() << "save fast resume data for " << hash;
+    m_journal.put(hash.toLatin1(), QByteArray(data.c_str(), data.size()));
+    return true;
+}
+
 void QED2KSession::readAlerts()
 {
-    std::auto_ptr<libed2k::alert> a = m_session->pop_alert();
+    m_alertQueue.take(m_pendingAlerts);
+
+    if (!m_alertDispatcher.drain(m_pendingAlerts))
+        qDebug() << "alerts reading time limit exceeded, " << m_pendingAlerts.size() << " alerts left for next tick";
+
+    // hashes completed on this tick go to disk together
+    m_paramsCache.commit();
+}
+
+void QED2KSession::drainAlerts()
+{
+    // on shutdown there is no next tick - dispatch everything
+    m_alertQueue.take(m_pendingAlerts);
+    m_alertDispatcher.drain(m_pendingAlerts, -1);
+    m_paramsCache.commit();
+}
+
+QHash<QString, quint64> QED2KSession::alertCounters() const
+{
+    QHash<QString, quint64> res = m_alertDispatcher.counters();
+    QMutexLocker locker(&m_pumpMutex);
+    QHash<QString, quint64> worker = m_workerDispatcher.counters();
+
+    for (QHash<QString, quint64>::const_iterator itr = worker.constBegin(); itr != worker.constEnd(); ++itr)
+        res[itr.key()] += itr.value();
+
+    return res;
+}
+
+void QED2KSession::on_serverNameResolved(libed2k::server_name_resolved_alert* p)
+{
+    emit serverNameResolved(QString::fromUtf8(p->m_strServer.c_str(), p->m_strServer.size()));
+}
+
+void QED2KSession::on_serverConnectionInitialized(libed2k::server_connection_initialized_alert* p)
+{
+    emit serverConnectionInitialized(p->m_address, p->m_nClientId, p->m_nTCPFlags, p->m_nAuxPort);
+}
+
+void QED2KSession::on_serverStatus(libed2k::server_status_alert* p)
+{
+    emit serverStatus(p->m_address, p->m_nFilesCount, p->m_nUsersCount);
+}
+
+void QED2KSession::on_serverIdentity(libed2k::server_identity_alert* p)
+{
+    emit serverIdentity(p->m_address, QString::fromUtf8(p->m_strName.c_str(), p->m_strName.size()),
+                        QString::fromUtf8(p->m_strDescr.c_str(), p->m_strDescr.size()));
+}
+
+void QED2KSession::on_serverMessage(libed2k::server_message_alert* p)
+{
+    emit serverMessage(p->m_address, QString::fromUtf8(p->m_strMessage.c_str(), p->m_strMessage.size()));
+}
+
+void QED2KSession::on_serverConnectionClosed(libed2k::server_connection_closed* p)
+{
+    emit serverConnectionClosed(p->m_address, QString::fromLocal8Bit(p->m_error.message().c_str()));
+}
 
-    while (a.get())
+void QED2KSession::on_sharedFiles(libed2k::shared_files_alert* p)
+{
+    std::vector<QED2KSearchResultEntry> vRes;
+    vRes.resize(p->m_files.m_collection.size());
+    bool bMoreResult = p->m_more;
+
+    for (size_t n = 0; n < p->m_files.m_collection.size(); ++n)
     {
-        if (libed2k::server_name_resolved_alert* p =
-            dynamic_cast<libed2k::server_name_resolved_alert*>(a.get()))
-        {
-            emit serverNameResolved(QString::fromUtf8(p->m_strServer.c_str(), p->m_strServer.size()));
-        }
-        if (libed2k::server_connection_initialized_alert* p =
-            dynamic_cast<libed2k::server_connection_initialized_alert*>(a.get()))
-        {
-            emit serverConnectionInitialized(p->m_address, p->m_nClientId, p->m_nTCPFlags, p->m_nAuxPort);
-        }
-        else if (libed2k::server_status_alert* p = dynamic_cast<libed2k::server_status_alert*>(a.get()))
-        {
-            emit serverStatus(p->m_address, p->m_nFilesCount, p->m_nUsersCount);
-        }
-        else if (libed2k::server_identity_alert* p = dynamic_cast<libed2k::server_identity_alert*>(a.get()))
-        {
-            emit serverIdentity(p->m_address, QString::fromUtf8(p->m_strName.c_str(), p->m_strName.size()),
-                                QString::fromUtf8(p->m_strDescr.c_str(), p->m_strDescr.size()));
-        }
-        else if (libed2k::server_message_alert* p = dynamic_cast<libed2k::server_message_alert*>(a.get()))
-        {
-            emit serverMessage(p->m_address, QString::fromUtf8(p->m_strMessage.c_str(), p->m_strMessage.size()));
-        }
-        else if (libed2k::server_connection_closed* p =
-                 dynamic_cast<libed2k::server_connection_closed*>(a.get()))
+        QED2KSearchResultEntry sre = QED2KSearchResultEntry::fromSharedFileEntry(p->m_files.m_collection[n]);
+
+        if (sre.isCorrect())
         {
-            emit serverConnectionClosed(p->m_address, QString::fromLocal8Bit(p->m_error.message().c_str()));
+            vRes[n] = sre;
         }
-        else if (libed2k::shared_files_alert* p = dynamic_cast<libed2k::shared_files_alert*>(a.get()))
-        {
-            std::vector<QED2KSearchResultEntry> vRes;
-            vRes.resize(p->m_files.m_collection.size());
-            bool bMoreResult = p->m_more;
+    }
 
-            for (size_t n = 0; n < p->m_files.m_collection.size(); ++n)
-            {
-                QED2KSearchResultEntry sre = QED2KSearchResultEntry::fromSharedFileEntry(p->m_files.m_collection[n]);
+    // emit special signal for derived class
+    if (libed2k::shared_directory_files_alert* p2 =
+        dynamic_cast<libed2k::shared_directory_files_alert*>(p))
+    {
+        emit peerSharedDirectoryFiles(
+            p2->m_np, md4toQString(p2->m_hash),
+            QString::fromUtf8(p2->m_strDirectory.c_str(), p2->m_strDirectory.size()), vRes);
+    }
+    else if (libed2k::ismod_shared_directory_files_alert* p2 =
+             dynamic_cast<libed2k::ismod_shared_directory_files_alert*>(p))
+    {
+        emit peerIsModSharedFiles(p2->m_np, md4toQString(p2->m_hash), md4toQString(p2->m_dir_hash), vRes);
+    }
+    else
+    {
+        emit searchResult(p->m_np, md4toQString(p->m_hash), vRes, bMoreResult);
+    }
+}
 
-                if (sre.isCorrect())
-                {
-                    vRes[n] = sre;
-                }
-            }
+void QED2KSession::on_muleListenFailed(libed2k::mule_listen_failed_alert* p)
+{
+    Q_UNUSED(p)
+    // TODO - process signal - it means we have different client on same port
+}
 
-            // emit special signal for derived class
-            if (libed2k::shared_directory_files_alert* p2 =
-                dynamic_cast<libed2k::shared_directory_files_alert*>(p))
-            {
-                emit peerSharedDirectoryFiles(
-                    p2->m_np, md4toQString(p2->m_hash),
-                    QString::fromUtf8(p2->m_strDirectory.c_str(), p2->m_strDirectory.size()), vRes);
-            }
-            else if (libed2k::ismod_shared_directory_files_alert* p2 =
-                     dynamic_cast<libed2k::ismod_shared_directory_files_alert*>(p))
-            {
-                emit peerIsModSharedFiles(p2->m_np, md4toQString(p2->m_hash), md4toQString(p2->m_dir_hash), vRes);
-            }
-            else
-            {
-                emit searchResult(p->m_np, md4toQString(p->m_hash), vRes, bMoreResult);
-            }
-        }
-        else if (libed2k::mule_listen_failed_alert* p =
-                 dynamic_cast<libed2k::mule_listen_failed_alert*>(a.get()))
-        {
-            Q_UNUSED(p)
-            // TODO - process signal - it means we have different client on same port
-        }
-        else if (libed2k::peer_connected_alert* p = dynamic_cast<libed2k::peer_connected_alert*>(a.get()))
-        {
-            emit peerConnected(p->m_np, md4toQString(p->m_hash), p->m_active);
-        }
-        else if (libed2k::peer_disconnected_alert* p = dynamic_cast<libed2k::peer_disconnected_alert*>(a.get()))
-        {
-            emit peerDisconnected(p->m_np, md4toQString(p->m_hash), p->m_ec);
-        }
-        else if (libed2k::peer_message_alert* p = dynamic_cast<libed2k::peer_message_alert*>(a.get()))
-        {
-            emit peerMessage(p->m_np, md4toQString(p->m_hash),
-                             QString::fromUtf8(p->m_strMessage.c_str(), p->m_strMessage.size()));
-        }
-        else if (libed2k::peer_captcha_request_alert* p =
-                 dynamic_cast<libed2k::peer_captcha_request_alert*>(a.get()))
-        {
-            QPixmap pm;
-            if (!p->m_captcha.empty()) pm.loadFromData((const uchar*)&p->m_captcha[0], p->m_captcha.size()); // avoid windows rtl error
-            emit peerCaptchaRequest(p->m_np, md4toQString(p->m_hash), pm);
-        }
-        else if (libed2k::peer_captcha_result_alert* p =
-                 dynamic_cast<libed2k::peer_captcha_result_alert*>(a.get()))
-        {
-            emit peerCaptchaResult(p->m_np, md4toQString(p->m_hash), p->m_nResult);
-        }
-        else if (libed2k::shared_files_access_denied* p =
-                 dynamic_cast<libed2k::shared_files_access_denied*>(a.get()))
-        {
-            emit peerSharedFilesAccessDenied(p->m_np, md4toQString(p->m_hash));
-        }
-        else if (libed2k::shared_directories_alert* p = dynamic_cast<libed2k::shared_directories_alert*>(a.get()))
-        {
-            QStringList qstrl;
+void QED2KSession::on_peerConnected(libed2k::peer_connected_alert* p)
+{
+    emit peerConnected(p->m_np, md4toQString(p->m_hash), p->m_active);
+}
 
-            for (size_t n = 0; n < p->m_dirs.size(); ++n)
-            {
-                qstrl.append(QString::fromUtf8(p->m_dirs[n].c_str(), p->m_dirs[n].size()));
-            }
+void QED2KSession::on_peerDisconnected(libed2k::peer_disconnected_alert* p)
+{
+    emit peerDisconnected(p->m_np, md4toQString(p->m_hash), p->m_ec);
+}
 
-            emit peerSharedDirectories(p->m_np, md4toQString(p->m_hash), qstrl);
-        }
-        else if (libed2k::added_transfer_alert* p =
-                 dynamic_cast<libed2k::added_transfer_alert*>(a.get()))
-        {
-            Transfer t(QED2KHandle(p->m_handle));
-            emit addedTransfer(t);           
-        }
-        else if (libed2k::paused_transfer_alert* p =
-                 dynamic_cast<libed2k::paused_transfer_alert*>(a.get()))
-        {
-            emit pausedTransfer(Transfer(QED2KHandle(p->m_handle)));
-        }
-        else if (libed2k::resumed_transfer_alert* p =
-                 dynamic_cast<libed2k::resumed_transfer_alert*>(a.get()))
-        {
-            emit resumedTransfer(Transfer(QED2KHandle(p->m_handle)));
-        }
-        else if (libed2k::deleted_transfer_alert* p =
-                 dynamic_cast<libed2k::deleted_transfer_alert*>(a.get()))
-        {            
-            QString hash = QString::fromStdString(p->m_hash.toString());
-            qDebug() << "delete transfer alert" << hash;
-            emit deletedTransfer(QString::fromStdString(p->m_hash.toString()));
-        }
-        else if (libed2k::finished_transfer_alert* p =
-                 dynamic_cast<libed2k::finished_transfer_alert*>(a.get()))
-        {
-            Preferences pref;
-            Transfer t(QED2KHandle(p->m_handle));
+void QED2KSession::on_peerMessage(libed2k::peer_message_alert* p)
+{
+    emit peerMessage(p->m_np, md4toQString(p->m_hash),
+                     QString::fromUtf8(p->m_strMessage.c_str(), p->m_strMessage.size()));
+}
 
-            if (p->m_had_picker)
-                emit finishedTransfer(t);
+void QED2KSession::on_peerCaptchaRequest(libed2k::peer_captcha_request_alert* p)
+{
+    QPixmap pm;
+    if (!p->m_captcha.empty()) pm.loadFromData((const uchar*)&p->m_captcha[0], p->m_captcha.size()); // avoid windows rtl error
+    emit peerCaptchaRequest(p->m_np, md4toQString(p->m_hash), pm);
+}
 
-            if (t.is_seed())
-                emit registerNode(t);
+void QED2KSession::on_peerCaptchaResult(libed2k::peer_captcha_result_alert* p)
+{
+    emit peerCaptchaResult(p->m_np, md4toQString(p->m_hash), p->m_nResult);
+}
 
-            if (!m_fast_resume_transfers.empty())
-            {
-                m_fast_resume_transfers.remove(t.hash());
+void QED2KSession::on_sharedFilesAccessDenied(libed2k::shared_files_access_denied* p)
+{
+    emit peerSharedFilesAccessDenied(p->m_np, md4toQString(p->m_hash));
+}
 
-                remove_by_state(std::max(pref.getPartialTransfersCount(), 50));
+void QED2KSession::on_sharedDirectories(libed2k::shared_directories_alert* p)
+{
+    QStringList qstrl;
 
-                if (m_fast_resume_transfers.empty())
-                {
-                    emit fastResumeDataLoadCompleted();
-                }
-                else
-                {
-                    qDebug() << "start finish timer";
-                    finishTimer.start(1000);
-                }
-            }
+    for (size_t n = 0; n < p->m_dirs.size(); ++n)
+    {
+        qstrl.append(QString::fromUtf8(p->m_dirs[n].c_str(), p->m_dirs[n].size()));
+    }
 
-            if (pref.isAutoRunEnabled() && p->m_had_picker)
-                autoRunExternalProgram(t);
-        }
-        else if (libed2k::save_resume_data_alert* p = dynamic_cast<libed2k::save_resume_data_alert*>(a.get()))
-        {
-            writeResumeData(p);
-        }
-        else if (libed2k::transfer_params_alert* p = dynamic_cast<libed2k::transfer_params_alert*>(a.get()))
+    emit peerSharedDirectories(p->m_np, md4toQString(p->m_hash), qstrl);
+}
+
+void QED2KSession::on_addedTransfer(libed2k::added_transfer_alert* p)
+{
+    Transfer t(QED2KHandle(p->m_handle));
+    emit addedTransfer(t);
+}
+
+void QED2KSession::on_pausedTransfer(libed2k::paused_transfer_alert* p)
+{
+    emit pausedTransfer(Transfer(QED2KHandle(p->m_handle)));
+}
+
+void QED2KSession::on_resumedTransfer(libed2k::resumed_transfer_alert* p)
+{
+    emit resumedTransfer(Transfer(QED2KHandle(p->m_handle)));
+}
+
+void QED2KSession::on_deletedTransfer(libed2k::deleted_transfer_alert* p)
+{
+    QString hash = QString::fromStdString(p->m_hash.toString());
+    qDebug() << "delete transfer alert" << hash;
+    emit deletedTransfer(hash);
+}
+
+void QED2KSession::on_finishedTransfer(libed2k::finished_transfer_alert* p)
+{
+    Preferences pref;
+    Transfer t(QED2KHandle(p->m_handle));
+
+    if (p->m_had_picker)
+        emit finishedTransfer(t);
+
+    if (t.is_seed())
+        emit registerNode(t);
+
+    if (!m_fast_resume_transfers.empty())
+    {
+        m_fast_resume_transfers.remove(t.hash());
+
+        remove_by_state(std::max(pref.getPartialTransfersCount(), 50));
+
+        if (!m_resume_queue.empty())
         {
-            emit transferParametersReady(p->m_atp, p->m_ec);
+            // load completion is reported by addResumedTransfers
         }
-        else if (libed2k::file_renamed_alert* p = dynamic_cast<libed2k::file_renamed_alert*>(a.get()))
+        else if (m_fast_resume_transfers.empty())
         {
-            emit savePathChanged(Transfer(QED2KHandle(p->m_handle)));
+            emit fastResumeDataLoadCompleted();
         }
-        else if (libed2k::storage_moved_alert* p = dynamic_cast<libed2k::storage_moved_alert*>(a.get()))
+        else
         {
-            emit savePathChanged(Transfer(QED2KHandle(p->m_handle)));
+            qDebug() << "start finish timer";
+            finishTimer.start(1000);
         }
-        else if (libed2k::file_error_alert* p = dynamic_cast<libed2k::file_error_alert*>(a.get()))
-        {
-            QED2KHandle h(p->m_handle);
+    }
 
-            if (h.is_valid())
-            {
-                emit fileError(Transfer(h),
-                               QString::fromLocal8Bit(p->error.message().c_str(), p->error.message().size()));
-                h.pause();
-            }
-        }
+    if (pref.isAutoRunEnabled() && p->m_had_picker)
+        autoRunExternalProgram(t);
+}
 
-        a = m_session->pop_alert();
+void QED2KSession::on_transferParams(libed2k::transfer_params_alert* p)
+{
+    if (!p->m_ec) m_paramsCache.store(p->m_atp);
+    emit transferParametersReady(p->m_atp, p->m_ec);
+}
+
+void QED2KSession::on_fileRenamed(libed2k::file_renamed_alert* p)
+{
+    emit savePathChanged(Transfer(QED2KHandle(p->m_handle)));
+}
+
+void QED2KSession::on_storageMoved(libed2k::storage_moved_alert* p)
+{
+    emit savePathChanged(Transfer(QED2KHandle(p->m_handle)));
+}
+
+void QED2KSession::on_fileError(libed2k::file_error_alert* p)
+{
+    QED2KHandle h(p->m_handle);
+
+    if (h.is_valid())
+    {
+        emit fileError(Transfer(h),
+                       QString::fromLocal8Bit(p->error.message().c_str(), p->error.message().size()));
+        h.pause();
     }
 }
 
@@ -1022,12 +1108,14 @@ void QED2KSession::saveFastResumeData()
         delegate()->pop_alert();
     }
 
+    m_journal.commit();
     Preferences().setPartialTransfersCount(part_num);
 }
 
 void QED2KSession::loadFastResumeData()
 {
     qDebug("load fast resume data");
+    m_startupTimer.phase("read journal");
     // avoid load collections from previous fail
     QDir bkp_dir(misc::ED2KCollectionLocation());
     if (bkp_dir.exists())
@@ -1039,69 +1127,140 @@ void QED2KSession::loadFastResumeData()
         }
     }
 
-    // we need files 32 length(MD4_HASH_SIZE*2) name and extension fastresume
+    QDir fastresume_dir(misc::ED2KBackupLocation());
+    QHash<QByteArray, QByteArray> records;
+    m_journal.open(fastresume_dir.absoluteFilePath("resume.journal"), records);
+
+    m_startupTimer.phase("migrate");
+    // migration from one file per transfer - we need files 32 length(MD4_HASH_SIZE*2) name and extension fastresume
     QStringList filter;
     filter << "????????????????????????????????.fastresume";
-
-    QDir fastresume_dir(misc::ED2KBackupLocation());
     const QStringList files = fastresume_dir.entryList(filter, QDir::Files, QDir::Unsorted);
 
     foreach (const QString &file, files)
     {
-        qDebug("Trying to load fastresume data: %s", qPrintable(file));
-        const QString file_abspath = fastresume_dir.absoluteFilePath(file);
-        // extract hash from name
-        libed2k::md4_hash hash = libed2k::md4_hash::fromString(
-            file.toStdString().substr(0, libed2k::MD4_HASH_SIZE*2));
+        const QByteArray hash = file.left(libed2k::MD4_HASH_SIZE*2).toLatin1();
+        QFile fs(fastresume_dir.absoluteFilePath(file));
 
-        if (hash.defined())
+        if (!records.contains(hash) && fs.open(QIODevice::ReadOnly))
         {
-            try
-            {
-                std::ifstream fs(file_abspath.toLocal8Bit(), std::ios_base::in | std::ios_base::binary);
+            qDebug("Migrate fastresume data: %s", qPrintable(file));
+            const QByteArray data = fs.readAll();
+            m_journal.put(hash, data);
+            records.insert(hash, data);
+        }
+    }
 
-                if (fs)
-                {
-                    libed2k::transfer_resume_data trd;
-                    libed2k::archive::ed2k_iarchive ia(fs);
-                    ia >> trd;
-                    // compare hashes
-                    if (trd.m_hash == hash)
-                    {
-                        // add transfer
-                        libed2k::add_transfer_params params;
-                        params.seed_mode = false;
-                        params.file_path = trd.m_filepath.m_collection;
-                        params.file_size = trd.m_filesize;
-                        params.file_hash = trd.m_hash;
-
-                        if (trd.m_fast_resume_data.count() > 0)
-                        {
-                            params.resume_data = const_cast<std::vector<char>* >(
-                                &trd.m_fast_resume_data.getTagByNameId(libed2k::FT_FAST_RESUME_DATA)->asBlob());
-                        }
-
-                        QFileInfo qfi(QString::fromUtf8(trd.m_filepath.m_collection.c_str()));
-                        // add transfer only when file still exists
-                        if (qfi.exists() && qfi.isFile())
-                        {                            
-                            QED2KHandle h(delegate()->add_transfer(params));
-                            m_fast_resume_transfers.insert(h.hash(), h);
-                        }
-                        else
-                        {
-                            qDebug() << "file not exists: " << qfi.fileName();
-                        }
-                    }
-                    else // bad file
-                        QFile::remove(file_abspath);
-                }
-            }
-            catch(const libed2k::libed2k_exception&)
-            {}
+    // old files are removed only when their content is on disk in journal
+    if (!files.isEmpty() && m_journal.commit())
+    {
+        foreach (const QString &file, files)
+            QFile::remove(fastresume_dir.absoluteFilePath(file));
+    }
+
+    m_startupTimer.phase("decode");
+    QList<QPair<QString, QByteArray> > input;
+    input.reserve(records.size());
+
+    for (QHash<QByteArray, QByteArray>::const_iterator itr = records.constBegin(); itr != records.constEnd(); ++itr)
+        input << qMakePair(QString::fromLatin1(itr.key().constData(), itr.key().size()), itr.value());
+
+    records.clear();
+    const QList<ResumeEntry> entries =
+        QtConcurrent::blockingMapped<QList<ResumeEntry> >(input, &QED2KSession::decodeResumeEntry);
+    input.clear();
+
+    foreach (const ResumeEntry& e, entries)
+    {
+        if (e.broken)
+            m_journal.remove(e.hash.toLatin1());
+        else if (e.exists)
+            m_resume_queue.push_back(e);
+        else
+            qDebug() << "file not exists for " << e.hash;
+    }
+
+    m_journal.commit();
+    m_startupTimer.phase("add transfers");
+    addResumedTransfers();
+}
+
+QED2KSession::ResumeEntry QED2KSession::decodeResumeEntry(const QPair<QString, QByteArray>& record)
+{
+    ResumeEntry e;
+    e.hash = record.first;
+    e.broken = true;
+    e.exists = false;
+    e.has_resume_data = false;
+
+    libed2k::md4_hash hash = libed2k::md4_hash::fromString(record.first.toStdString());
+    if (!hash.defined()) return e;
+
+    try
+    {
+        std::istringstream fs(std::string(record.second.constData(), record.second.size()),
+                              std::ios_base::in | std::ios_base::binary);
+        libed2k::transfer_resume_data trd;
+        libed2k::archive::ed2k_iarchive ia(fs);
+        ia >> trd;
+        // compare hashes
+        if (!(trd.m_hash == hash)) return e;
+
+        e.broken = false;
+        e.params.seed_mode = false;
+        e.params.file_path = trd.m_filepath.m_collection;
+        e.params.file_size = trd.m_filesize;
+        e.params.file_hash = trd.m_hash;
+
+        if (trd.m_fast_resume_data.count() > 0)
+        {
+            e.resume_data = trd.m_fast_resume_data.getTagByNameId(libed2k::FT_FAST_RESUME_DATA)->asBlob();
+            e.has_resume_data = true;
+        }
+
+        // add transfer only when file still exists
+        QFileInfo qfi(QString::fromUtf8(trd.m_filepath.m_collection.c_str()));
+        e.exists = qfi.exists() && qfi.isFile();
+    }
+    catch(const libed2k::libed2k_exception&)
+    {
+        // keep record, it was written by incompatible version probably
+        e.broken = false;
+    }
+
+    return e;
+}
+
+void QED2KSession::addResumedTransfers()
+{
+    const int batch_size = 100;
+
+    for (int i = 0; i < batch_size && !m_resume_queue.empty(); ++i)
+    {
+        ResumeEntry& e = m_resume_queue.front();
+        if (e.has_resume_data) e.params.resume_data = &e.resume_data;
+
+        try
+        {
+            QED2KHandle h(delegate()->add_transfer(e.params));
+            m_fast_resume_transfers.insert(h.hash(), h);
+        }
+        catch(const libed2k::libed2k_exception& ex)
+        {
+            qDebug() << "unable to add transfer " << e.hash << " " << misc::toQStringU(ex.what());
         }
+
+        m_resume_queue.pop_front();
     }
 
+    // let GUI and alerts breathe between batches
+    if (!m_resume_queue.empty())
+    {
+        QTimer::singleShot(0, this, SLOT(addResumedTransfers()));
+        return;
+    }
+
+    m_startupTimer.finish(m_fast_resume_transfers.size());
     finishTimer.start(1000);
 
     // migration stage or empty transfers - immediately emit signal
@@ -1148,18 +1307,63 @@ bool QED2KSession::isServerConnected() const
 
 void QED2KSession::makeTransferParametersAsync(const QString& filepath)
 {
-    delegate()->make_transfer_parameters(filepath.toUtf8().constData());
+    libed2k::add_transfer_params atp;
+
+    if (m_paramsCache.lookup(filepath, atp))
+    {
+        // caller expects result later, like from hashing thread
+        m_cachedParams.push_back(atp);
+        if (m_cachedParams.size() == 1) QTimer::singleShot(0, this, SLOT(deliverCachedParams()));
+        return;
+    }
+
+    m_hasher->enqueue(filepath);
 }
 
 void QED2KSession::cancelTransferParameters(const QString& filepath)
 {
-    delegate()->cancel_transfer_parameters(filepath.toUtf8().constData());
+    const std::string path = filepath.toUtf8().constData();
+
+    for (std::deque<libed2k::add_transfer_params>::iterator itr = m_cachedParams.begin(); itr != m_cachedParams.end(); ++itr)
+    {
+        if (itr->file_path == path)
+        {
+            m_cachedParams.erase(itr);
+            return;
+        }
+    }
+
+    m_hasher->cancel(filepath);
 }
 
-std::pair<libed2k::add_transfer_params, libed2k::error_code> QED2KSession::makeTransferParameters(const QString& filepath) const
+void QED2KSession::deliverCachedParams()
 {
+    // handlers can request more parameters, take current requests only
+    std::deque<libed2k::add_transfer_params> ready;
+    ready.swap(m_cachedParams);
+
+    while (!ready.empty())
+    {
+        emit transferParametersReady(ready.front(), libed2k::error_code());
+        ready.pop_front();
+    }
+}
+
+void QED2KSession::on_hashed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec)
+{
+    if (!ec) m_paramsCache.store(atp);
+    emit transferParametersReady(atp, ec);
+}
+
+std::pair<libed2k::add_transfer_params, libed2k::error_code> QED2KSession::makeTransferParameters(const QString& filepath)
+{
+    std::pair<libed2k::add_transfer_params, libed2k::error_code> res;
+    if (m_paramsCache.lookup(filepath, res.first)) return res;
+
     bool cancel = false;
-    return libed2k::file2atp()(filepath.toUtf8().constData(), cancel);
+    res = libed2k::file2atp()(filepath.toUtf8().constData(), cancel);
+    if (!res.second) m_paramsCache.store(res.first);
+    return res;
 }
 
 void QED2KSession::remove_by_state(int sborder)
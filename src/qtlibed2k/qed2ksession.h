@@ -9,17 +9,25 @@
 #endif
 
 #include <set>
+#include <deque>
 #include <QPixmap>
 #include <QPointer>
 #include <QTimer>
 #include <QHash>
 #include <QStringList>
-#include <QHash>
+#include <QMutex>
+#include <QSet>
 
 #include <transport/session_base.h>
+#include <transport/alert_dispatcher.h>
+#include <transport/startup_timer.h>
+#include <transport/resume_journal.h>
 #include <libed2k/session.hpp>
+#include <libed2k/alert_types.hpp>
 #include <libed2k/session_settings.hpp>
 #include "qed2khandle.h"
+#include "transfer_params_cache.h"
+#include "hash_scheduler.h"
 #include "trackerinfos.h"
 #include "preferences.h"
 
@@ -101,28 +109,104 @@ public:
     void setUploadRateLimit(long rate);
     virtual void saveTempFastResumeData();
     virtual void readAlerts();
+    virtual void drainAlerts();
+    virtual bool pumpAlerts();
     virtual void saveFastResumeData();
     void startServerConnection();
     void stopServerConnection();
     bool isServerConnected() const;
     void makeTransferParametersAsync(const QString& filepath);
     void cancelTransferParameters(const QString& filepath);
-    std::pair<libed2k::add_transfer_params, libed2k::error_code> makeTransferParameters(const QString& filepath) const;
+    std::pair<libed2k::add_transfer_params, libed2k::error_code> makeTransferParameters(const QString& filepath);
 
-    /** scan ed2k backup directory and load all files were matched name filter */
+    /** load transfers from resume journal, old per-transfer fastresume files are moved into journal */
     void loadFastResumeData();
     void enableUPnP(bool b);
 
     libed2k::session* delegate() const;
 
+    /**
+      * dispatched alerts count by alert type
+     */
+    QHash<QString, quint64> alertCounters() const;
+
     const libed2k::ip_filter& session_filter() const;
 private:
     QScopedPointer<libed2k::session> m_session;
     QHash<QString, Transfer> m_fast_resume_transfers;   // contains fast resume data were loading
     void remove_by_state(int sborder);  // begin remove when start border great or equal transfers count
     QTimer finishTimer;
+    AlertDispatcher<libed2k::alert> m_alertDispatcher;     // GUI thread handlers
+    AlertDispatcher<libed2k::alert> m_workerDispatcher;    // session worker thread handlers
+    AlertQueue<libed2k::alert>      m_alertQueue;          // batches published by session worker
+    std::deque<libed2k::alert*>     m_pendingAlerts;       // taken from queue, not dispatched yet
+    mutable QMutex                  m_pumpMutex;
+    ResumeJournal                   m_journal;             // resume data of all transfers
+    QSet<QString>                   m_removedHashes;       // deleted, resume data must not be written; guarded by m_pumpMutex
+
+    /**
+     * resume record decoded and checked on worker pool
+     */
+    struct ResumeEntry
+    {
+        QString hash;
+        bool broken;                        // record can't belong to hash, drop it from journal
+        bool exists;                        // record is good and transfer file still exists
+        bool has_resume_data;
+        libed2k::add_transfer_params params;
+        std::vector<char> resume_data;      // params.resume_data points here only when transfer is being added
+    };
+
+    static ResumeEntry decodeResumeEntry(const QPair<QString, QByteArray>& record);
+    std::deque<ResumeEntry>         m_resume_queue;        // decoded transfers are waiting to be added
+    StartupTimer                    m_startupTimer;
+    TransferParamsCache             m_paramsCache;         // hashes of shared files
+    std::deque<libed2k::add_transfer_params> m_cachedParams; // hashing requests served from cache
+    QScopedPointer<HashScheduler>   m_hasher;              // hashing of shared files
+
+    /**
+      * buffer transfer resume data in journal, it reaches disk on next journal commit
+     */
+    bool writeResumeData(const libed2k::save_resume_data_alert* p);
+
+    void registerAlertHandlers();
+    void on_serverNameResolved(libed2k::server_name_resolved_alert* p);
+    void on_serverConnectionInitialized(libed2k::server_connection_initialized_alert* p);
+    void on_serverStatus(libed2k::server_status_alert* p);
+    void on_serverIdentity(libed2k::server_identity_alert* p);
+    void on_serverMessage(libed2k::server_message_alert* p);
+    void on_serverConnectionClosed(libed2k::server_connection_closed* p);
+    void on_sharedFiles(libed2k::shared_files_alert* p);
+    void on_muleListenFailed(libed2k::mule_listen_failed_alert* p);
+    void on_peerConnected(libed2k::peer_connected_alert* p);
+    void on_peerDisconnected(libed2k::peer_disconnected_alert* p);
+    void on_peerMessage(libed2k::peer_message_alert* p);
+    void on_peerCaptchaRequest(libed2k::peer_captcha_request_alert* p);
+    void on_peerCaptchaResult(libed2k::peer_captcha_result_alert* p);
+    void on_sharedFilesAccessDenied(libed2k::shared_files_access_denied* p);
+    void on_sharedDirectories(libed2k::shared_directories_alert* p);
+    void on_addedTransfer(libed2k::added_transfer_alert* p);
+    void on_pausedTransfer(libed2k::paused_transfer_alert* p);
+    void on_resumedTransfer(libed2k::resumed_transfer_alert* p);
+    void on_deletedTransfer(libed2k::deleted_transfer_alert* p);
+    void on_finishedTransfer(libed2k::finished_transfer_alert* p);
+    void on_transferParams(libed2k::transfer_params_alert* p);
+    void on_fileRenamed(libed2k::file_renamed_alert* p);
+    void on_storageMoved(libed2k::storage_moved_alert* p);
+    void on_fileError(libed2k::file_error_alert* p);
 private slots:
     void finishLoad();
+
+    /**
+      * add next batch of decoded transfers, the rest is added on next event loop iteration
+     */
+    void addResumedTransfers();
+
+    /**
+      * report parameters found in cache like they were hashed
+     */
+    void deliverCachedParams();
+    void on_hashed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec);
 public slots:
 	void startUpTransfers();
 	void configureSession();
@@ -2,8 +2,12 @@ INCLUDEPATH += $$PWD
 
 HEADERS += $$PWD/qed2ksession.h \
            $$PWD/qed2khandle.h\
-           $$PWD/qed2kpeerhandle.h
+           $$PWD/qed2kpeerhandle.h \
+           $$PWD/transfer_params_cache.h \
+           $$PWD/hash_scheduler.h
 
 SOURCES += $$PWD/qed2ksession.cpp \
            $$PWD/qed2khandle.cpp\
-           $$PWD/qed2kpeerhandle.cpp
+           $$PWD/qed2kpeerhandle.cpp \
+           $$PWD/transfer_params_cache.cpp \
+           $$PWD/hash_scheduler.cpp
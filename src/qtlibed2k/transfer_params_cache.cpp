@@ -0,0 +1,117 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#ifndef Q_OS_WIN
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include "transfer_params_cache.h"
+
+TransferParamsCache::TransferParamsCache()
+{
+}
+
+void TransferParamsCache::open(const QString& filepath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_records.clear();
+    m_journal.open(filepath, m_records);
+    qDebug() << "transfer parameters cache has " << m_records.size() << " files";
+}
+
+bool TransferParamsCache::lookup(const QString& filepath, libed2k::add_transfer_params& atp)
+{
+    FileStamp current;
+    if (!stamp(filepath, current)) return false;
+
+    const QByteArray k = key(filepath);
+    QMutexLocker locker(&m_mutex);
+    QHash<QByteArray, QByteArray>::const_iterator itr = m_records.constFind(k);
+    if (itr == m_records.constEnd()) return false;
+
+    QDataStream ds(itr.value());
+    ds.setVersion(QDataStream::Qt_4_6);
+    QString path;
+    FileStamp cached;
+    QByteArray file_hash;
+    QByteArray piece_hashes;
+    ds >> path >> cached.size >> cached.mtime >> cached.inode >> file_hash >> piece_hashes;
+
+    if (ds.status() != QDataStream::Ok || path != filepath || !(cached == current) ||
+        file_hash.size() != libed2k::MD4_HASH_SIZE || piece_hashes.size() % libed2k::MD4_HASH_SIZE)
+    {
+        // file was changed, it will be hashed and stored again
+        m_records.remove(k);
+        m_journal.remove(k);
+        return false;
+    }
+
+    atp.file_path = filepath.toUtf8().constData();
+    atp.file_size = cached.size;
+    atp.file_hash = libed2k::md4_hash::fromString(file_hash.toHex().constData());
+    atp.piece_hashses.clear();
+
+    for (int i = 0; i < piece_hashes.size(); i += libed2k::MD4_HASH_SIZE)
+        atp.piece_hashses.push_back(
+            libed2k::md4_hash::fromString(piece_hashes.mid(i, libed2k::MD4_HASH_SIZE).toHex().constData()));
+
+    return true;
+}
+
+void TransferParamsCache::store(const libed2k::add_transfer_params& atp)
+{
+    const QString filepath = QString::fromUtf8(atp.file_path.c_str(), atp.file_path.size());
+    FileStamp current;
+    if (!stamp(filepath, current) || current.size != atp.file_size) return;
+
+    QByteArray piece_hashes;
+    for (std::vector<libed2k::md4_hash>::const_iterator itr = atp.piece_hashses.begin(); itr != atp.piece_hashses.end(); ++itr)
+        piece_hashes.append(QByteArray::fromHex(itr->toString().c_str()));
+
+    QByteArray record;
+    QDataStream ds(&record, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_4_6);
+    ds << filepath << current.size << current.mtime << current.inode
+       << QByteArray::fromHex(atp.file_hash.toString().c_str()) << piece_hashes;
+
+    const QByteArray k = key(filepath);
+    QMutexLocker locker(&m_mutex);
+    m_records.insert(k, record);
+    m_journal.put(k, record);
+}
+
+void TransferParamsCache::commit()
+{
+    m_journal.commit();
+}
+
+bool TransferParamsCache::stamp(const QString& filepath, FileStamp& s)
+{
+    QFileInfo fi(filepath);
+    if (!fi.exists() || !fi.isFile()) return false;
+
+    s.size = fi.size();
+    s.mtime = fi.lastModified().toTime_t();
+    s.inode = 0;
+
+#ifndef Q_OS_WIN
+    // file replaced by another one with the same size and time is a new file
+    struct stat st;
+    if (::stat(QFile::encodeName(filepath).constData(), &st) == 0)
+        s.inode = st.st_ino;
+#endif
+
+    return true;
+}
+
+QByteArray TransferParamsCache::key(const QString& filepath)
+{
+    // paths are longer than journal key, record keeps full path to check collisions
+    return QCryptographicHash::hash(filepath.toUtf8(), QCryptographicHash::Sha1);
+}
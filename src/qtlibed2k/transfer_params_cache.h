@@ -0,0 +1,53 @@
+#ifndef __TRANSFER_PARAMS_CACHE_H__
+#define __TRANSFER_PARAMS_CACHE_H__
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <libed2k/add_transfer_params.hpp>
+#include <transport/resume_journal.h>
+
+/**
+ * persistent results of shared files hashing
+ * record is valid while file has the same path, size, modification time and inode
+ * thread safe, stored records reach disk on commit
+ */
+class TransferParamsCache
+{
+public:
+    TransferParamsCache();
+
+    /**
+      * load records from journal, call once before use
+     */
+    void open(const QString& filepath);
+
+    /**
+      * fill file hash, size and piece hashes when file wasn't changed since it was hashed
+     */
+    bool lookup(const QString& filepath, libed2k::add_transfer_params& atp);
+
+    /**
+      * remember parameters of hashed file
+     */
+    void store(const libed2k::add_transfer_params& atp);
+    void commit();
+private:
+    struct FileStamp
+    {
+        qint64  size;
+        uint    mtime;
+        quint64 inode;
+        bool operator==(const FileStamp& s) const { return size == s.size && mtime == s.mtime && inode == s.inode; }
+    };
+
+    static bool stamp(const QString& filepath, FileStamp& s);
+    static QByteArray key(const QString& filepath);
+
+    QHash<QByteArray, QByteArray>   m_records;  // path digest -> record
+    ResumeJournal                   m_journal;
+    QMutex                          m_mutex;
+};
+
+#endif //__TRANSFER_PARAMS_CACHE_H__
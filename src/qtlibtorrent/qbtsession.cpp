@@ -29,6 +29,7 @@
  */
 
 #include <QDir>
+#include <QFileInfo>
 #include <QDateTime>
 #include <QString>
 #include <QNetworkInterface>
@@ -36,6 +37,7 @@
 #include <QNetworkAddressEntry>
 #include <QProcess>
 #include <QTextCodec>
+#include <QtConcurrentMap>
 #include <stdlib.h>
 
 #include "smtp.h"
@@ -52,6 +54,7 @@
 #include "geoipmanager.h"
 #endif
 #include "torrentpersistentdata.h"
+#include "transport/startup_timer.h"
 #ifdef RSS_ENABLE
 #include "httpserver.h"
 #endif
@@ -112,7 +115,9 @@ QBtSession::QBtSession()
   #endif
   , m_tracker(0), m_shutdownAct(NO_SHUTDOWN),
     m_upnp(0), m_natpmp(0)
-{}
+{
+  registerAlertHandlers();
+}
 
 void QBtSession::start()
 {
@@ -174,6 +179,8 @@ QBtSession::~QBtSession()
     {
         stop();
     }
+
+    qDeleteAll(m_pendingAlerts.begin(), m_pendingAlerts.end());
 }
 
 void QBtSession::stop()
@@ -182,6 +189,8 @@ void QBtSession::stop()
     // Do some BT related saving
     saveSessionState();
     saveFastResumeData();
+    // Persistent data changes are cached in memory
+    TorrentDataCache::instance()->flush();
     // Delete our objects
     if (m_tracker)
       delete m_tracker;
@@ -782,7 +791,10 @@ void QBtSession::deleteTransfer(const QString &hash, bool delete_local_files) {
       QDir().rmdir(parent_folder);
     }
   }
-  // Remove it from torrent backup directory
+  // Remove it from torrent backup directory, under pump lock so worker
+  // can not write fastresume for this hash back after removal
+  QMutexLocker locker(&m_pumpMutex);
+  m_removedHashes << hash;
   QDir torrentBackup(misc::BTBackupLocation());
   QStringList filters;
   filters << hash+".*";
@@ -806,6 +818,7 @@ void QBtSession::deleteTransfer(const QString &hash, bool delete_local_files) {
           }
       }
   }
+  locker.unlock();
   // Remove tracker errors
   trackersInfos.remove(hash);
   if (delete_local_files)
@@ -836,9 +849,7 @@ std::vector<Transfer> QBtSession::getActiveTransfers() const {
   return getTransfers();
 }
 
-bool QBtSession::loadFastResumeData(const QString &hash, std::vector<char> &buf) {
-  const QString fastresume_path = QDir(misc::BTBackupLocation()).absoluteFilePath(hash+QString(".fastresume"));
-  qDebug("Trying to load fastresume data: %s", qPrintable(fastresume_path));
+static bool readFastResumeFile(const QString &fastresume_path, std::vector<char> &buf) {
   QFile fastresume_file(fastresume_path);
   if (!fastresume_file.open(QIODevice::ReadOnly)) return false;
   const QByteArray content = fastresume_file.readAll();
@@ -849,6 +860,51 @@ bool QBtSession::loadFastResumeData(const QString &hash, std::vector<char> &buf)
   return true;
 }
 
+bool QBtSession::loadFastResumeData(const QString &hash, std::vector<char> &buf) {
+  QHash<QString, std::vector<char> >::iterator it = m_preloadedResumeData.find(hash);
+  if (it != m_preloadedResumeData.end()) {
+    buf.swap(it.value());
+    m_preloadedResumeData.erase(it);
+    return true;
+  }
+  const QString fastresume_path = QDir(misc::BTBackupLocation()).absoluteFilePath(hash+QString(".fastresume"));
+  qDebug("Trying to load fastresume data: %s", qPrintable(fastresume_path));
+  return readFastResumeFile(fastresume_path, buf);
+}
+
+// Runs on worker pool: decode torrent file and read fast resume data next to it
+QBtSession::PreloadedTorrent QBtSession::preloadTorrent(const QString &path) {
+  PreloadedTorrent res;
+  res.path = path;
+  res.hash = QFileInfo(path).completeBaseName();
+  try {
+    res.ti = new torrent_info(path.toUtf8().constData());
+    if (!res.ti->is_valid())
+      res.ti = 0;
+  } catch(std::exception&) {
+    // addTorrent decodes it once again and reports the error
+    res.ti = 0;
+  }
+  res.has_resume_data = readFastResumeFile(QFileInfo(path).absoluteDir().absoluteFilePath(res.hash+".fastresume"), res.resume_data);
+  return res;
+}
+
+void QBtSession::preloadTorrents(const QStringList &hashes) {
+  const QDir torrentBackup(misc::BTBackupLocation());
+  QStringList paths;
+  foreach (const QString &hash, hashes) {
+    if (!TorrentPersistentData::isMagnet(hash))
+      paths << torrentBackup.path()+QDir::separator()+hash+".torrent";
+  }
+  const QList<PreloadedTorrent> preloaded = QtConcurrent::blockingMapped<QList<PreloadedTorrent> >(paths, &QBtSession::preloadTorrent);
+  foreach (const PreloadedTorrent &p, preloaded) {
+    if (p.ti)
+      m_preloadedTorrents.insert(p.path, p.ti);
+    if (p.has_resume_data)
+      m_preloadedResumeData.insert(p.hash, p.resume_data);
+  }
+}
+
 void QBtSession::loadTorrentSettings(QTorrentHandle& h) {
   Preferences pref;
   // Connections limit per torrent
@@ -973,6 +1029,7 @@ QPair<Transfer,ErrorCode> QBtSession::addLink(QString strLink, bool resumed /* =
     // Start torrent because it was added in paused state
     h.resume();
   }
+  forgetRemoved(h.hash());
   // Send torrent addition signal
   addConsoleMessage(tr("'%1' added to download list.", "'/home/y/xxx.torrent' was added to download list.").arg(strLink));
   emit addedTorrent(h);
@@ -1013,8 +1070,11 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
   boost::intrusive_ptr<torrent_info> t;
   try {
     qDebug() << "Loading torrent at" << path;
-    // Getting torrent file informations
-    t = new torrent_info(path.toUtf8().constData());
+    // Getting torrent file informations, torrents of start up were decoded in advance
+    if (resumed)
+      t = m_preloadedTorrents.take(path);
+    if (!t)
+      t = new torrent_info(path.toUtf8().constData());
     if (!t->is_valid())
       throw std::exception();
   } catch(std::exception& e) {
@@ -1228,6 +1288,7 @@ QTorrentHandle QBtSession::addTorrent(QString path, bool fromScanDir, QString fr
 #endif
   }
 
+  forgetRemoved(h.hash());
   // Send torrent addition signal
   emit addedTorrent(h);
   return h;
@@ -2072,397 +2133,474 @@ void QBtSession::sendNotificationEmail(const QTorrentHandle &h)
 {
 }
 
+#define BT_ALERT_HANDLER(type, method) \
+  m_alertDispatcher.add<libtorrent::type>(#type, boost::bind(&QBtSession::method, this, _1))
+
+void QBtSession::registerAlertHandlers() {
+  BT_ALERT_HANDLER(torrent_finished_alert, on_torrentFinished);
+  BT_ALERT_HANDLER(file_renamed_alert, on_fileRenamed);
+  BT_ALERT_HANDLER(torrent_deleted_alert, on_torrentDeleted);
+  BT_ALERT_HANDLER(storage_moved_alert, on_storageMoved);
+  BT_ALERT_HANDLER(metadata_received_alert, on_metadataReceived);
+  BT_ALERT_HANDLER(file_error_alert, on_fileError);
+  BT_ALERT_HANDLER(file_completed_alert, on_fileCompleted);
+  BT_ALERT_HANDLER(torrent_paused_alert, on_torrentPaused);
+  BT_ALERT_HANDLER(tracker_error_alert, on_trackerError);
+  BT_ALERT_HANDLER(tracker_reply_alert, on_trackerReply);
+  BT_ALERT_HANDLER(tracker_warning_alert, on_trackerWarning);
+  BT_ALERT_HANDLER(portmap_error_alert, on_portmapError);
+  BT_ALERT_HANDLER(portmap_alert, on_portmap);
+  BT_ALERT_HANDLER(peer_blocked_alert, on_peerBlocked);
+  BT_ALERT_HANDLER(peer_ban_alert, on_peerBan);
+  BT_ALERT_HANDLER(fastresume_rejected_alert, on_fastresumeRejected);
+  BT_ALERT_HANDLER(url_seed_alert, on_urlSeed);
+  BT_ALERT_HANDLER(listen_succeeded_alert, on_listenSucceeded);
+  BT_ALERT_HANDLER(torrent_checked_alert, on_torrentChecked);
+
+  // Resume data goes to disk directly from session worker thread
+  m_workerDispatcher.add<libtorrent::save_resume_data_alert>(
+    "save_resume_data_alert", boost::bind(&QBtSession::on_saveResumeData, this, _1));
+}
+
+#undef BT_ALERT_HANDLER
+
+// Called from session worker thread
+bool QBtSession::pumpAlerts() {
+  QMutexLocker locker(&m_pumpMutex);
+  return m_alertQueue.pump(s, m_workerDispatcher);
+}
+
 // Read alerts sent by the Bittorrent session
 void QBtSession::readAlerts() {
-  // look at session alerts and display some infos
-  std::auto_ptr<alert> a = s->pop_alert();
-  while (a.get()) {
-    if (torrent_finished_alert* p = dynamic_cast<torrent_finished_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        const QString hash = h.hash();
-        qDebug("Got a torrent finished alert for %s", qPrintable(h.name()));
-        // Remove .!qB extension if necessary
-        if (appendqBExtension)
-          appendqBextensionToTorrent(h, false);
-
-        const bool was_already_seeded = TorrentPersistentData::isSeed(hash);
-        qDebug("Was already seeded: %d", was_already_seeded);
-        if (!was_already_seeded) {
-          h.save_resume_data();
-          qDebug("Checking if the torrent contains torrent files to download");
-          // Check if there are torrent files inside
-          for (int i=0; i<h.num_files(); ++i) {
-            const QString torrent_relpath = h.filepath_at(i).replace("\\", "/");
-            qDebug() << "File path:" << torrent_relpath;
-            if (torrent_relpath.endsWith(".torrent", Qt::CaseInsensitive)) {
-              qDebug("Found possible recursive torrent download.");
-              const QString torrent_fullpath = h.save_path()+"/"+torrent_relpath;
-              qDebug("Full subtorrent path is %s", qPrintable(torrent_fullpath));
-              try {
-                boost::intrusive_ptr<torrent_info> t = new torrent_info(torrent_fullpath.toUtf8().constData());
-                if (t->is_valid()) {
-                  qDebug("emitting recursiveTorrentDownloadPossible()");
-                  emit recursiveTorrentDownloadPossible(h);
-                  break;
-                }
-              } catch(std::exception&) {
-                qDebug("Caught error loading torrent");
-#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
-                QString displayed_path = torrent_fullpath;
-                displayed_path.replace("/", "\\");
-                addConsoleMessage(tr("Unable to decode %1 torrent file.").arg(displayed_path), QString::fromUtf8("red"));
-#else
-                addConsoleMessage(tr("Unable to decode %1 torrent file.").arg(torrent_fullpath), QString::fromUtf8("red"));
-#endif
-              }
-            }
-          }
-          // Move to download directory if necessary
-          if (!defaultTempPath.isEmpty()) {
-            // Check if directory is different
-            const QDir current_dir(h.save_path());
-            const QDir save_dir(getSavePath(hash));
-            if (current_dir != save_dir) {
-              qDebug("Moving torrent from the temp folder");
-              h.move_storage(save_dir.absolutePath());
+  m_alertQueue.take(m_pendingAlerts);
+  if (!m_alertDispatcher.drain(m_pendingAlerts))
+    qDebug("alerts reading time limit exceeded, %d alerts left for next tick", (int)m_pendingAlerts.size());
+}
+
+// Read all alerts without time limit - on shutdown there is no next tick
+void QBtSession::drainAlerts() {
+  m_alertQueue.take(m_pendingAlerts);
+  m_alertDispatcher.drain(m_pendingAlerts, -1);
+}
+
+QHash<QString, quint64> QBtSession::alertCounters() const {
+  QHash<QString, quint64> res = m_alertDispatcher.counters();
+  QMutexLocker locker(&m_pumpMutex);
+  QHash<QString, quint64> worker = m_workerDispatcher.counters();
+  QHash<QString, quint64>::const_iterator it;
+  for (it = worker.constBegin(); it != worker.constEnd(); ++it)
+    res[it.key()] += it.value();
+  return res;
+}
+
+void QBtSession::on_torrentFinished(libtorrent::torrent_finished_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    const QString hash = h.hash();
+    qDebug("Got a torrent finished alert for %s", qPrintable(h.name()));
+    // Remove .!qB extension if necessary
+    if (appendqBExtension)
+      appendqBextensionToTorrent(h, false);
+
+    const bool was_already_seeded = TorrentPersistentData::isSeed(hash);
+    qDebug("Was already seeded: %d", was_already_seeded);
+    if (!was_already_seeded) {
+      h.save_resume_data();
+      qDebug("Checking if the torrent contains torrent files to download");
+      // Check if there are torrent files inside
+      for (int i=0; i<h.num_files(); ++i) {
+        const QString torrent_relpath = h.filepath_at(i).replace("\\", "/");
+        qDebug() << "File path:" << torrent_relpath;
+        if (torrent_relpath.endsWith(".torrent", Qt::CaseInsensitive)) {
+          qDebug("Found possible recursive torrent download.");
+          const QString torrent_fullpath = h.save_path()+"/"+torrent_relpath;
+          qDebug("Full subtorrent path is %s", qPrintable(torrent_fullpath));
+          try {
+            boost::intrusive_ptr<torrent_info> t = new torrent_info(torrent_fullpath.toUtf8().constData());
+            if (t->is_valid()) {
+              qDebug("emitting recursiveTorrentDownloadPossible()");
+              emit recursiveTorrentDownloadPossible(h);
+              break;
             }
-          }
-          // Remember finished state
-          qDebug("Saving seed status");
-          TorrentPersistentData::saveSeedStatus(h);
-          // Recheck if the user asked to
-          Preferences pref;
-          if (pref.recheckTorrentsOnCompletion()) {
-            h.force_recheck();
-          }
-          qDebug("Emitting finishedTorrent() signal");
-          emit finishedTorrent(h);
-          qDebug("Received finished alert for %s", qPrintable(h.name()));
-#ifndef DISABLE_GUI
-          bool will_shutdown = (pref.shutdownWhenDownloadsComplete() ||
-                                pref.shutdownqBTWhenDownloadsComplete() ||
-                                pref.suspendWhenDownloadsComplete())
-              && !hasDownloadingTorrents();
+          } catch(std::exception&) {
+            qDebug("Caught error loading torrent");
+#if defined(Q_WS_WIN) || defined(Q_OS_OS2)
+            QString displayed_path = torrent_fullpath;
+            displayed_path.replace("/", "\\");
+            addConsoleMessage(tr("Unable to decode %1 torrent file.").arg(displayed_path), QString::fromUtf8("red"));
 #else
-          bool will_shutdown = false;
+            addConsoleMessage(tr("Unable to decode %1 torrent file.").arg(torrent_fullpath), QString::fromUtf8("red"));
 #endif
-          // AutoRun program
-          if (pref.isAutoRunEnabled())
-            autoRunExternalProgram(h);
-#ifndef DISABLE_GUI
-          // Auto-Shutdown
-          if (will_shutdown) {
-            bool suspend = pref.suspendWhenDownloadsComplete();
-            bool shutdown = pref.shutdownWhenDownloadsComplete();
-            // Confirm shutdown
-            QString confirm_msg;
-            if (suspend) {
-              confirm_msg = tr("The computer will now go to sleep mode unless you cancel within the next 15 seconds...");
-            } else if (shutdown) {
-              confirm_msg = tr("The computer will now be switched off unless you cancel within the next 15 seconds...");
-            } else {
-              confirm_msg = tr("qMule will now exit unless you cancel within the next 15 seconds...");
-            }
-            if (!ShutdownConfirmDlg::askForConfirmation(confirm_msg))
-              return;
-            // Actually shut down
-            if (suspend || shutdown) {
-              qDebug("Preparing for auto-shutdown because all downloads are complete!");
-              // Disabling it for next time
-              pref.setShutdownWhenDownloadsComplete(false);
-              pref.setSuspendWhenDownloadsComplete(false);
-              // Make sure preferences are synced before exiting
-              if (suspend)
-                m_shutdownAct = SUSPEND_COMPUTER;
-              else
-                m_shutdownAct = SHUTDOWN_COMPUTER;
-            }
-            qDebug("Exiting the application");
-            qApp->exit();
-            return;
           }
-#endif // DISABLE_GUI
         }
       }
-    }
-    else if (save_resume_data_alert* p = dynamic_cast<save_resume_data_alert*>(a.get())) {
-      const QDir torrentBackup(misc::BTBackupLocation());
-      const QTorrentHandle h(p->handle);
-      if (h.is_valid() && p->resume_data) {
-        const QString filepath = torrentBackup.absoluteFilePath(h.hash()+".fastresume");
-        QFile resume_file(filepath);
-        if (resume_file.exists())
-          QFile::remove(filepath);
-        qDebug("Saving fastresume data in %s", qPrintable(filepath));
-        vector<char> out;
-        bencode(back_inserter(out), *p->resume_data);
-        if (!out.empty() && resume_file.open(QIODevice::WriteOnly)) {
-          resume_file.write(&out[0], out.size());
-          resume_file.close();
+      // Move to download directory if necessary
+      if (!defaultTempPath.isEmpty()) {
+        // Check if directory is different
+        const QDir current_dir(h.save_path());
+        const QDir save_dir(getSavePath(hash));
+        if (current_dir != save_dir) {
+          qDebug("Moving torrent from the temp folder");
+          h.move_storage(save_dir.absolutePath());
         }
       }
-    }
-    else if (file_renamed_alert* p = dynamic_cast<file_renamed_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        emit savePathChanged(h);
-      }
-    }
-    else if (torrent_deleted_alert* p = dynamic_cast<torrent_deleted_alert*>(a.get())) {
-      qDebug("A torrent was deleted from the hard disk, attempting to remove the root folder too...");
-      QString hash = misc::toQString(p->info_hash);
-      if (!hash.isEmpty()) {
-        if (savePathsToRemove.contains(hash)) {
-          const QString dirpath = savePathsToRemove.take(hash);
-          qDebug() << "Removing save path: " << dirpath << "...";
-          bool ok = QDir().rmdir(dirpath);
-          Q_UNUSED(ok);
-          qDebug() << "Folder was removed: " << ok;
-        }
-      } else {
-        // Fallback
-        qDebug() << "hash is empty, use fallback to remove save path";
-        foreach (const QString& key, savePathsToRemove.keys()) {
-          // Attempt to delete
-          if (QDir().rmdir(savePathsToRemove[key])) {
-            savePathsToRemove.remove(key);
-          }
-        }
+      // Remember finished state
+      qDebug("Saving seed status");
+      TorrentPersistentData::saveSeedStatus(h);
+      // Recheck if the user asked to
+      Preferences pref;
+      if (pref.recheckTorrentsOnCompletion()) {
+        h.force_recheck();
       }
-    }
-    else if (storage_moved_alert* p = dynamic_cast<storage_moved_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        // Attempt to remove old folder if empty
-        const QString old_save_path = TorrentPersistentData::getPreviousPath(h.hash());
-        const QString new_save_path = misc::toQStringU(p->path.c_str());
-        qDebug("Torrent moved from %s to %s", qPrintable(old_save_path), qPrintable(new_save_path));
-        QDir old_save_dir(old_save_path);
-        if (old_save_dir != QDir(defaultSavePath) && old_save_dir != QDir(defaultTempPath)) {
-          qDebug("Attempting to remove %s", qPrintable(old_save_path));
-          QDir().rmpath(old_save_path);
+      qDebug("Emitting finishedTorrent() signal");
+      emit finishedTorrent(h);
+      qDebug("Received finished alert for %s", qPrintable(h.name()));
+#ifndef DISABLE_GUI
+      bool will_shutdown = (pref.shutdownWhenDownloadsComplete() ||
+                            pref.shutdownqBTWhenDownloadsComplete() ||
+                            pref.suspendWhenDownloadsComplete())
+          && !hasDownloadingTorrents();
+#else
+      bool will_shutdown = false;
+#endif
+      // AutoRun program
+      if (pref.isAutoRunEnabled())
+        autoRunExternalProgram(h);
+#ifndef DISABLE_GUI
+      // Auto-Shutdown
+      if (will_shutdown) {
+        bool suspend = pref.suspendWhenDownloadsComplete();
+        bool shutdown = pref.shutdownWhenDownloadsComplete();
+        // Confirm shutdown
+        QString confirm_msg;
+        if (suspend) {
+          confirm_msg = tr("The computer will now go to sleep mode unless you cancel within the next 15 seconds...");
+        } else if (shutdown) {
+          confirm_msg = tr("The computer will now be switched off unless you cancel within the next 15 seconds...");
+        } else {
+          confirm_msg = tr("qMule will now exit unless you cancel within the next 15 seconds...");
         }
-        if (defaultTempPath.isEmpty() || !new_save_path.startsWith(defaultTempPath)) {
-          qDebug("Storage has been moved, updating save path to %s", qPrintable(new_save_path));
-          TorrentPersistentData::saveSavePath(h.hash(), new_save_path);
+        if (!ShutdownConfirmDlg::askForConfirmation(confirm_msg))
+          return;
+        // Actually shut down
+        if (suspend || shutdown) {
+          qDebug("Preparing for auto-shutdown because all downloads are complete!");
+          // Disabling it for next time
+          pref.setShutdownWhenDownloadsComplete(false);
+          pref.setSuspendWhenDownloadsComplete(false);
+          // Make sure preferences are synced before exiting
+          if (suspend)
+            m_shutdownAct = SUSPEND_COMPUTER;
+          else
+            m_shutdownAct = SHUTDOWN_COMPUTER;
         }
-        emit savePathChanged(h);
-        //h.force_recheck();
+        qDebug("Exiting the application");
+        qApp->exit();
+        return;
       }
+#endif // DISABLE_GUI
     }
-    else if (metadata_received_alert* p = dynamic_cast<metadata_received_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        qDebug("Received metadata for %s", qPrintable(h.hash()));
-        // Save metadata
-        const QDir torrentBackup(misc::BTBackupLocation());
-        if (!QFile::exists(torrentBackup.absoluteFilePath(h.hash()+QString(".torrent"))))
-          h.save_torrent_file(torrentBackup.absoluteFilePath(h.hash()+QString(".torrent")));
-        // Copy the torrent file to the export folder
-        if (torrentExport)
-          exportTorrentFile(h);
-        // Append .!qB to incomplete files
-        if (appendqBExtension)
-          appendqBextensionToTorrent(h, true);
-        // Truncate root folder
-        const QString root_folder = misc::truncateRootFolder(p->handle);
-        TorrentPersistentData::setRootFolder(h.hash(), root_folder);
-        qDebug() << "magnet root folder is:" <<  root_folder;
-
-        // Move to a subfolder corresponding to the torrent root folder if necessary
-        if (!root_folder.isEmpty()) {
-          if (!h.is_seed() && !defaultTempPath.isEmpty()) {
-            qDebug("Incomplete torrent in temporary folder case");
-            QString torrent_tmp_path = defaultTempPath.replace("\\", "/");
-            if (!torrent_tmp_path.endsWith("/")) torrent_tmp_path += "/";
-            torrent_tmp_path += root_folder;
-            qDebug() << "Moving torrent to" << torrent_tmp_path;
-            h.move_storage(torrent_tmp_path);
-          } else {
-            qDebug() << "Incomplete torrent in destination folder case";
-            QString save_path = h.save_path();
-            h.move_storage(QDir(save_path).absoluteFilePath(root_folder));
-          }
-        }
-        emit metadataReceived(h);
-        if (h.is_paused()) {
-          // XXX: Unfortunately libtorrent-rasterbar does not send a torrent_paused_alert
-          // and the torrent can be paused when metadata is received
-          emit pausedTorrent(h);
-        }
+  }
+}
 
-      }
-    }
-    else if (file_error_alert* p = dynamic_cast<file_error_alert*>(a.get()))
-    {
-      QTorrentHandle h(p->handle);
+// Hash was added again after removal, its resume data may be saved
+void QBtSession::forgetRemoved(const QString& hash) {
+  QMutexLocker locker(&m_pumpMutex);
+  m_removedHashes.remove(hash);
+}
 
-      if (h.is_valid())
-      {
-          emit fileError(Transfer(h), QString::fromLocal8Bit(p->error.message().c_str(), p->error.message().size()));
-          h.pause();
-      }
+// Runs on session worker thread under m_pumpMutex, touches no other session state
+void QBtSession::on_saveResumeData(libtorrent::save_resume_data_alert* p) {
+  const QDir torrentBackup(misc::BTBackupLocation());
+  const QTorrentHandle h(p->handle);
+  if (h.is_valid() && p->resume_data && !m_removedHashes.contains(h.hash())) {
+    const QString filepath = torrentBackup.absoluteFilePath(h.hash()+".fastresume");
+    QFile resume_file(filepath);
+    if (resume_file.exists())
+      QFile::remove(filepath);
+    qDebug("Saving fastresume data in %s", qPrintable(filepath));
+    vector<char> out;
+    bencode(back_inserter(out), *p->resume_data);
+    if (!out.empty() && resume_file.open(QIODevice::WriteOnly)) {
+      resume_file.write(&out[0], out.size());
+      resume_file.close();
     }
-    else if (file_completed_alert* p = dynamic_cast<file_completed_alert*>(a.get()))
-    {
-      QTorrentHandle h(p->handle);
+  }
+}
 
-      if (h.is_valid())
-      {
-          qDebug("A file completed download in torrent %s", qPrintable(h.name()));
-          if (appendqBExtension) {
-            qDebug("appendqBTExtension is true");
-            QString name = h.filepath_at(p->index);
-            if (name.endsWith(".!qB")) {
-              const QString old_name = name;
-              name.chop(4);
-              qDebug("Renaming %s to %s", qPrintable(old_name), qPrintable(name));
-              h.rename_file(p->index, name);
-            }
-          }
-      }
-    }
-    else if (torrent_paused_alert* p = dynamic_cast<torrent_paused_alert*>(a.get())) {
-      if (p->handle.is_valid()) {
-        QTorrentHandle h(p->handle);
-        if (!h.has_error())
-          h.save_resume_data();
-        emit pausedTorrent(h);
-      }
-    }
-    else if (tracker_error_alert* p = dynamic_cast<tracker_error_alert*>(a.get())) {
-      // Level: fatal
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        // Authentication
-        if (p->status_code != 401) {
-          qDebug("Received a tracker error for %s: %s", p->url.c_str(), p->msg.c_str());
-          const QString tracker_url = misc::toQString(p->url);
-          QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-          TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-          data.last_message = misc::toQString(p->msg);
-          trackers_data.insert(tracker_url, data);
-          trackersInfos[h.hash()] = trackers_data;
-        } else {
-          emit trackerAuthenticationRequired(h);
-        }
-      }
+void QBtSession::on_fileRenamed(libtorrent::file_renamed_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    emit savePathChanged(h);
+  }
+}
+
+void QBtSession::on_torrentDeleted(libtorrent::torrent_deleted_alert* p) {
+  qDebug("A torrent was deleted from the hard disk, attempting to remove the root folder too...");
+  QString hash = misc::toQString(p->info_hash);
+  if (!hash.isEmpty()) {
+    if (savePathsToRemove.contains(hash)) {
+      const QString dirpath = savePathsToRemove.take(hash);
+      qDebug() << "Removing save path: " << dirpath << "...";
+      bool ok = QDir().rmdir(dirpath);
+      Q_UNUSED(ok);
+      qDebug() << "Folder was removed: " << ok;
     }
-    else if (tracker_reply_alert* p = dynamic_cast<tracker_reply_alert*>(a.get())) {
-      const QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        qDebug("Received a tracker reply from %s (Num_peers=%d)", p->url.c_str(), p->num_peers);
-        // Connection was successful now. Remove possible old errors
-        QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-        const QString tracker_url = misc::toQString(p->url);
-        TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-        data.last_message = ""; // Reset error/warning message
-        data.num_peers = p->num_peers;
-        trackers_data.insert(tracker_url, data);
-        trackersInfos[h.hash()] = trackers_data;
-      }
-    } else if (tracker_warning_alert* p = dynamic_cast<tracker_warning_alert*>(a.get())) {
-      const QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        // Connection was successful now but there is a warning message
-        QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
-        const QString tracker_url = misc::toQString(p->url);
-        TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
-        data.last_message = misc::toQString(p->msg); // Store warning message
-        trackers_data.insert(tracker_url, data);
-        trackersInfos[h.hash()] = trackers_data;
-        qDebug("Received a tracker warning from %s: %s", p->url.c_str(), p->msg.c_str());
+  } else {
+    // Fallback
+    qDebug() << "hash is empty, use fallback to remove save path";
+    foreach (const QString& key, savePathsToRemove.keys()) {
+      // Attempt to delete
+      if (QDir().rmdir(savePathsToRemove[key])) {
+        savePathsToRemove.remove(key);
       }
     }
-    else if (portmap_error_alert* p = dynamic_cast<portmap_error_alert*>(a.get())) {
-      addConsoleMessage(tr("UPnP/NAT-PMP: Port mapping failure, message: %1").arg(misc::toQString(p->message())), "red");
-      //emit UPnPError(QString(p->msg().c_str()));
+  }
+}
+
+void QBtSession::on_storageMoved(libtorrent::storage_moved_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    // Attempt to remove old folder if empty
+    const QString old_save_path = TorrentPersistentData::getPreviousPath(h.hash());
+    const QString new_save_path = misc::toQStringU(p->path.c_str());
+    qDebug("Torrent moved from %s to %s", qPrintable(old_save_path), qPrintable(new_save_path));
+    QDir old_save_dir(old_save_path);
+    if (old_save_dir != QDir(defaultSavePath) && old_save_dir != QDir(defaultTempPath)) {
+      qDebug("Attempting to remove %s", qPrintable(old_save_path));
+      QDir().rmpath(old_save_path);
     }
-    else if (portmap_alert* p = dynamic_cast<portmap_alert*>(a.get())) {
-      qDebug("UPnP Success, msg: %s", p->message().c_str());
-      addConsoleMessage(tr("UPnP/NAT-PMP: Port mapping successful, message: %1").arg(misc::toQString(p->message())), "blue");
-      //emit UPnPSuccess(QString(p->msg().c_str()));
+    if (defaultTempPath.isEmpty() || !new_save_path.startsWith(defaultTempPath)) {
+      qDebug("Storage has been moved, updating save path to %s", qPrintable(new_save_path));
+      TorrentPersistentData::saveSavePath(h.hash(), new_save_path);
     }
-    else if (peer_blocked_alert* p = dynamic_cast<peer_blocked_alert*>(a.get())) {
-      boost::system::error_code ec;
-      string ip = p->ip.to_string(ec);
-      if (!ec) {
-        addPeerBanMessage(QString::fromAscii(ip.c_str()), true);
-        //emit peerBlocked(QString::fromAscii(ip.c_str()));
+    emit savePathChanged(h);
+    //h.force_recheck();
+  }
+}
+
+void QBtSession::on_metadataReceived(libtorrent::metadata_received_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    qDebug("Received metadata for %s", qPrintable(h.hash()));
+    // Save metadata
+    const QDir torrentBackup(misc::BTBackupLocation());
+    if (!QFile::exists(torrentBackup.absoluteFilePath(h.hash()+QString(".torrent"))))
+      h.save_torrent_file(torrentBackup.absoluteFilePath(h.hash()+QString(".torrent")));
+    // Copy the torrent file to the export folder
+    if (torrentExport)
+      exportTorrentFile(h);
+    // Append .!qB to incomplete files
+    if (appendqBExtension)
+      appendqBextensionToTorrent(h, true);
+    // Truncate root folder
+    const QString root_folder = misc::truncateRootFolder(p->handle);
+    TorrentPersistentData::setRootFolder(h.hash(), root_folder);
+    qDebug() << "magnet root folder is:" <<  root_folder;
+
+    // Move to a subfolder corresponding to the torrent root folder if necessary
+    if (!root_folder.isEmpty()) {
+      if (!h.is_seed() && !defaultTempPath.isEmpty()) {
+        qDebug("Incomplete torrent in temporary folder case");
+        QString torrent_tmp_path = defaultTempPath.replace("\\", "/");
+        if (!torrent_tmp_path.endsWith("/")) torrent_tmp_path += "/";
+        torrent_tmp_path += root_folder;
+        qDebug() << "Moving torrent to" << torrent_tmp_path;
+        h.move_storage(torrent_tmp_path);
+      } else {
+        qDebug() << "Incomplete torrent in destination folder case";
+        QString save_path = h.save_path();
+        h.move_storage(QDir(save_path).absoluteFilePath(root_folder));
       }
     }
-    else if (peer_ban_alert* p = dynamic_cast<peer_ban_alert*>(a.get())) {
-      boost::system::error_code ec;
-      string ip = p->ip.address().to_string(ec);
-      if (!ec) {
-        addPeerBanMessage(QString::fromAscii(ip.c_str()), false);
-        //emit peerBlocked(QString::fromAscii(ip.c_str()));
-      }
+    emit metadataReceived(h);
+    if (h.is_paused()) {
+      // XXX: Unfortunately libtorrent-rasterbar does not send a torrent_paused_alert
+      // and the torrent can be paused when metadata is received
+      emit pausedTorrent(h);
     }
-    else if (fastresume_rejected_alert* p = dynamic_cast<fastresume_rejected_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        qDebug("/!\\ Fast resume failed for %s, reason: %s", qPrintable(h.name()), p->message().c_str());
-        if (p->error.value() == 134 && TorrentPersistentData::isSeed(h.hash()) && h.has_missing_files()) {
-          const QString hash = h.hash();
-          // Mismatching file size (files were probably moved
-          addConsoleMessage(tr("File sizes mismatch for torrent %1, pausing it.").arg(h.name()));
-          TorrentPersistentData::setErrorState(hash, true);
-          pauseTransfer(hash);
-        } else {
-          addConsoleMessage(tr("Fast resume data was rejected for torrent %1, checking again...").arg(h.name()), QString::fromUtf8("red"));
-          addConsoleMessage(tr("Reason: %1").arg(misc::toQString(p->message())));
+
+  }
+}
+
+void QBtSession::on_fileError(libtorrent::file_error_alert* p) {
+  QTorrentHandle h(p->handle);
+
+  if (h.is_valid())
+  {
+      emit fileError(Transfer(h), QString::fromLocal8Bit(p->error.message().c_str(), p->error.message().size()));
+      h.pause();
+  }
+}
+
+void QBtSession::on_fileCompleted(libtorrent::file_completed_alert* p) {
+  QTorrentHandle h(p->handle);
+
+  if (h.is_valid())
+  {
+      qDebug("A file completed download in torrent %s", qPrintable(h.name()));
+      if (appendqBExtension) {
+        qDebug("appendqBTExtension is true");
+        QString name = h.filepath_at(p->index);
+        if (name.endsWith(".!qB")) {
+          const QString old_name = name;
+          name.chop(4);
+          qDebug("Renaming %s to %s", qPrintable(old_name), qPrintable(name));
+          h.rename_file(p->index, name);
         }
       }
+  }
+}
+
+void QBtSession::on_torrentPaused(libtorrent::torrent_paused_alert* p) {
+  if (p->handle.is_valid()) {
+    QTorrentHandle h(p->handle);
+    if (!h.has_error())
+      h.save_resume_data();
+    emit pausedTorrent(h);
+  }
+}
+
+void QBtSession::on_trackerError(libtorrent::tracker_error_alert* p) {
+  // Level: fatal
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    // Authentication
+    if (p->status_code != 401) {
+      qDebug("Received a tracker error for %s: %s", p->url.c_str(), p->msg.c_str());
+      const QString tracker_url = misc::toQString(p->url);
+      QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
+      TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
+      data.last_message = misc::toQString(p->msg);
+      trackers_data.insert(tracker_url, data);
+      trackersInfos[h.hash()] = trackers_data;
+    } else {
+      emit trackerAuthenticationRequired(h);
     }
-    else if (url_seed_alert* p = dynamic_cast<url_seed_alert*>(a.get())) {
-      addConsoleMessage(tr("Url seed lookup failed for url: %1, message: %2").arg(misc::toQString(p->url)).arg(misc::toQString(p->message())), QString::fromUtf8("red"));
-      //emit urlSeedProblem(QString::fromUtf8(p->url.c_str()), QString::fromUtf8(p->msg().c_str()));
+  }
+}
+
+void QBtSession::on_trackerReply(libtorrent::tracker_reply_alert* p) {
+  const QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    qDebug("Received a tracker reply from %s (Num_peers=%d)", p->url.c_str(), p->num_peers);
+    // Connection was successful now. Remove possible old errors
+    QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
+    const QString tracker_url = misc::toQString(p->url);
+    TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
+    data.last_message = ""; // Reset error/warning message
+    data.num_peers = p->num_peers;
+    trackers_data.insert(tracker_url, data);
+    trackersInfos[h.hash()] = trackers_data;
+  }
+}
+
+void QBtSession::on_trackerWarning(libtorrent::tracker_warning_alert* p) {
+  const QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    // Connection was successful now but there is a warning message
+    QHash<QString, TrackerInfos> trackers_data = trackersInfos.value(h.hash(), QHash<QString, TrackerInfos>());
+    const QString tracker_url = misc::toQString(p->url);
+    TrackerInfos data = trackers_data.value(tracker_url, TrackerInfos(tracker_url));
+    data.last_message = misc::toQString(p->msg); // Store warning message
+    trackers_data.insert(tracker_url, data);
+    trackersInfos[h.hash()] = trackers_data;
+    qDebug("Received a tracker warning from %s: %s", p->url.c_str(), p->msg.c_str());
+  }
+}
+
+void QBtSession::on_portmapError(libtorrent::portmap_error_alert* p) {
+  addConsoleMessage(tr("UPnP/NAT-PMP: Port mapping failure, message: %1").arg(misc::toQString(p->message())), "red");
+  //emit UPnPError(QString(p->msg().c_str()));
+}
+
+void QBtSession::on_portmap(libtorrent::portmap_alert* p) {
+  qDebug("UPnP Success, msg: %s", p->message().c_str());
+  addConsoleMessage(tr("UPnP/NAT-PMP: Port mapping successful, message: %1").arg(misc::toQString(p->message())), "blue");
+  //emit UPnPSuccess(QString(p->msg().c_str()));
+}
+
+void QBtSession::on_peerBlocked(libtorrent::peer_blocked_alert* p) {
+  boost::system::error_code ec;
+  string ip = p->ip.to_string(ec);
+  if (!ec) {
+    addPeerBanMessage(QString::fromAscii(ip.c_str()), true);
+    //emit peerBlocked(QString::fromAscii(ip.c_str()));
+  }
+}
+
+void QBtSession::on_peerBan(libtorrent::peer_ban_alert* p) {
+  boost::system::error_code ec;
+  string ip = p->ip.address().to_string(ec);
+  if (!ec) {
+    addPeerBanMessage(QString::fromAscii(ip.c_str()), false);
+    //emit peerBlocked(QString::fromAscii(ip.c_str()));
+  }
+}
+
+void QBtSession::on_fastresumeRejected(libtorrent::fastresume_rejected_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    qDebug("/!\\ Fast resume failed for %s, reason: %s", qPrintable(h.name()), p->message().c_str());
+    if (p->error.value() == 134 && TorrentPersistentData::isSeed(h.hash()) && h.has_missing_files()) {
+      const QString hash = h.hash();
+      // Mismatching file size (files were probably moved
+      addConsoleMessage(tr("File sizes mismatch for torrent %1, pausing it.").arg(h.name()));
+      TorrentPersistentData::setErrorState(hash, true);
+      pauseTransfer(hash);
+    } else {
+      addConsoleMessage(tr("Fast resume data was rejected for torrent %1, checking again...").arg(h.name()), QString::fromUtf8("red"));
+      addConsoleMessage(tr("Reason: %1").arg(misc::toQString(p->message())));
     }
-    else if (listen_succeeded_alert *p = dynamic_cast<listen_succeeded_alert*>(a.get())) {
-      boost::system::error_code ec;
-      qDebug() << "Sucessfully listening on" << p->endpoint.address().to_string(ec).c_str() << "/" << p->endpoint.port();
-      // Force reannounce on all torrents because some trackers blacklist some ports
-      std::vector<torrent_handle> torrents = s->get_torrents();
-      std::vector<torrent_handle>::iterator it;
-      for (it = torrents.begin(); it != torrents.end(); it++) {
-        it->force_reannounce();
-      }
-      emit listenSucceeded();
-    }
-    else if (torrent_checked_alert* p = dynamic_cast<torrent_checked_alert*>(a.get())) {
-      QTorrentHandle h(p->handle);
-      if (h.is_valid()) {
-        const QString hash = h.hash();
-        qDebug("%s have just finished checking", qPrintable(hash));
-        // Save seed status
-        TorrentPersistentData::saveSeedStatus(h);
-        // Move to temp directory if necessary
-        if (!h.is_seed() && !defaultTempPath.isEmpty()) {
-          // Check if directory is different
-          const QDir current_dir(h.save_path());
-          const QDir save_dir(getSavePath(h.hash()));
-          if (current_dir == save_dir) {
-            qDebug("Moving the torrent to the temp directory...");
-            QString root_folder = TorrentPersistentData::getRootFolder(hash);
-            QString torrent_tmp_path = defaultTempPath.replace("\\", "/");
-            if (!root_folder.isEmpty()) {
-              if (!torrent_tmp_path.endsWith("/")) torrent_tmp_path += "/";
-              torrent_tmp_path += root_folder;
-            }
-            h.move_storage(torrent_tmp_path);
-          }
-        }
-        emit torrentFinishedChecking(h);
-        if (torrentsToPausedAfterChecking.contains(hash)) {
-          torrentsToPausedAfterChecking.removeOne(hash);
-          h.pause();
-          emit pausedTorrent(h);
+  }
+}
+
+void QBtSession::on_urlSeed(libtorrent::url_seed_alert* p) {
+  addConsoleMessage(tr("Url seed lookup failed for url: %1, message: %2").arg(misc::toQString(p->url)).arg(misc::toQString(p->message())), QString::fromUtf8("red"));
+  //emit urlSeedProblem(QString::fromUtf8(p->url.c_str()), QString::fromUtf8(p->msg().c_str()));
+}
+
+void QBtSession::on_listenSucceeded(libtorrent::listen_succeeded_alert* p) {
+  boost::system::error_code ec;
+  qDebug() << "Sucessfully listening on" << p->endpoint.address().to_string(ec).c_str() << "/" << p->endpoint.port();
+  // Force reannounce on all torrents because some trackers blacklist some ports
+  std::vector<torrent_handle> torrents = s->get_torrents();
+  std::vector<torrent_handle>::iterator it;
+  for (it = torrents.begin(); it != torrents.end(); it++) {
+    it->force_reannounce();
+  }
+  emit listenSucceeded();
+}
+
+void QBtSession::on_torrentChecked(libtorrent::torrent_checked_alert* p) {
+  QTorrentHandle h(p->handle);
+  if (h.is_valid()) {
+    const QString hash = h.hash();
+    qDebug("%s have just finished checking", qPrintable(hash));
+    // Save seed status
+    TorrentPersistentData::saveSeedStatus(h);
+    // Move to temp directory if necessary
+    if (!h.is_seed() && !defaultTempPath.isEmpty()) {
+      // Check if directory is different
+      const QDir current_dir(h.save_path());
+      const QDir save_dir(getSavePath(h.hash()));
+      if (current_dir == save_dir) {
+        qDebug("Moving the torrent to the temp directory...");
+        QString root_folder = TorrentPersistentData::getRootFolder(hash);
+        QString torrent_tmp_path = defaultTempPath.replace("\\", "/");
+        if (!root_folder.isEmpty()) {
+          if (!torrent_tmp_path.endsWith("/")) torrent_tmp_path += "/";
+          torrent_tmp_path += root_folder;
         }
+        h.move_storage(torrent_tmp_path);
       }
     }
-    a = s->pop_alert();
+    emit torrentFinishedChecking(h);
+    if (torrentsToPausedAfterChecking.contains(hash)) {
+      torrentsToPausedAfterChecking.removeOne(hash);
+      h.pause();
+      emit pausedTorrent(h);
+    }
   }
 }
 
@@ -2623,6 +2761,8 @@ void QBtSession::applyEncryptionSettings(pe_settings se) {
 // backup directory
 void QBtSession::startUpTransfers() {
   qDebug("Resuming unfinished torrents");
+  StartupTimer timer("bt");
+  timer.phase("scan backup");
   const QDir torrentBackup(misc::BTBackupLocation());
   QStringList torrents = TorrentPersistentData::knownTorrents();
 
@@ -2649,6 +2789,11 @@ void QBtSession::startUpTransfers() {
   }
   // End of safety measure
 
+  // Decode torrent files and read fast resume data in parallel, adding stays in queue order
+  timer.phase("preload");
+  preloadTorrents(known_torrents);
+
+  timer.phase("add transfers");
   qDebug("Starting up torrents");
   if (isQueueingEnabled()) {
     priority_queue<QPair<int, QString>, vector<QPair<int, QString> >, std::greater<QPair<int, QString> > > torrent_queue;
@@ -2685,6 +2830,11 @@ void QBtSession::startUpTransfers() {
     }
   }
 
+  // Torrents failed to add keep nothing in memory
+  m_preloadedTorrents.clear();
+  m_preloadedResumeData.clear();
+  timer.finish(known_torrents.size());
+
   Preferences().setValue("ported_to_new_savepath_system", true);
   qDebug("Unfinished torrents resumed");
 }
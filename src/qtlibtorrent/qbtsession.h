@@ -41,12 +41,16 @@
 #endif
 #include <QPointer>
 #include <QTimer>
+#include <QMutex>
+#include <QSet>
 
 #include <libtorrent/version.hpp>
 #include <libtorrent/session.hpp>
 #include <libtorrent/ip_filter.hpp>
+#include <libtorrent/alert_types.hpp>
 
 #include <transport/session_base.h>
+#include <transport/alert_dispatcher.h>
 
 #include "qtracker.h"
 #include "qtorrenthandle.h"
@@ -106,6 +110,10 @@ public:
 
   virtual void saveTempFastResumeData();
   virtual void readAlerts();
+  virtual void drainAlerts();
+  virtual bool pumpAlerts();
+  // Dispatched alerts count by alert type
+  QHash<QString, quint64> alertCounters() const;
 
 public slots:
   void addTransferFromFile(const QString& filename);
@@ -169,7 +177,40 @@ private:
   void loadTorrentTempData(QTorrentHandle &h, QString savePath, bool magnet);
   libtorrent::add_torrent_params initializeAddTorrentParams(const QString &hash);
   libtorrent::entry generateFilePriorityResumeData(boost::intrusive_ptr<libtorrent::torrent_info> &t, const std::vector<int> &fp);
+  // Start up
+  struct PreloadedTorrent {
+    QString path;
+    QString hash;
+    boost::intrusive_ptr<libtorrent::torrent_info> ti; // null when torrent file can't be decoded
+    bool has_resume_data;
+    std::vector<char> resume_data;
+  };
+  static PreloadedTorrent preloadTorrent(const QString &path);
+  void preloadTorrents(const QStringList &hashes);
   void updateRatioTimer();
+  // Alert handlers
+  void registerAlertHandlers();
+  void on_torrentFinished(libtorrent::torrent_finished_alert* p);
+  void on_saveResumeData(libtorrent::save_resume_data_alert* p);
+  void forgetRemoved(const QString& hash);
+  void on_fileRenamed(libtorrent::file_renamed_alert* p);
+  void on_torrentDeleted(libtorrent::torrent_deleted_alert* p);
+  void on_storageMoved(libtorrent::storage_moved_alert* p);
+  void on_metadataReceived(libtorrent::metadata_received_alert* p);
+  void on_fileError(libtorrent::file_error_alert* p);
+  void on_fileCompleted(libtorrent::file_completed_alert* p);
+  void on_torrentPaused(libtorrent::torrent_paused_alert* p);
+  void on_trackerError(libtorrent::tracker_error_alert* p);
+  void on_trackerReply(libtorrent::tracker_reply_alert* p);
+  void on_trackerWarning(libtorrent::tracker_warning_alert* p);
+  void on_portmapError(libtorrent::portmap_error_alert* p);
+  void on_portmap(libtorrent::portmap_alert* p);
+  void on_peerBlocked(libtorrent::peer_blocked_alert* p);
+  void on_peerBan(libtorrent::peer_ban_alert* p);
+  void on_fastresumeRejected(libtorrent::fastresume_rejected_alert* p);
+  void on_urlSeed(libtorrent::url_seed_alert* p);
+  void on_listenSucceeded(libtorrent::listen_succeeded_alert* p);
+  void on_torrentChecked(libtorrent::torrent_checked_alert* p);
 
 private slots:
   void addTorrentsFromScanFolder(QStringList&);
@@ -252,6 +293,16 @@ private:
   // Port forwarding
   libtorrent::upnp *m_upnp;
   libtorrent::natpmp *m_natpmp;
+  // Alerts
+  AlertDispatcher<libtorrent::alert> m_alertDispatcher;  // GUI thread handlers
+  AlertDispatcher<libtorrent::alert> m_workerDispatcher; // Session worker thread handlers
+  AlertQueue<libtorrent::alert> m_alertQueue;            // Batches published by session worker
+  std::deque<libtorrent::alert*> m_pendingAlerts;        // Taken from queue, not dispatched yet
+  mutable QMutex m_pumpMutex;
+  QSet<QString> m_removedHashes;                         // Deleted, resume data must not be written; guarded by m_pumpMutex
+  // Start up, decoded on worker pool and consumed by addTorrent
+  QHash<QString, boost::intrusive_ptr<libtorrent::torrent_info> > m_preloadedTorrents; // by torrent file path
+  QHash<QString, std::vector<char> > m_preloadedResumeData;                          // by hash
 };
 
 }
@@ -239,6 +239,11 @@ size_type QTorrentHandle::filesize_at(unsigned int index) const {
   return torrent_handle::get_torrent_info().file_at(index).size;
 }
 
+size_type QTorrentHandle::file_offset_at(unsigned int index) const {
+  Q_ASSERT(index < (unsigned int)torrent_handle::get_torrent_info().num_files());
+  return torrent_handle::get_torrent_info().file_at(index).offset;
+}
+
 QString QTorrentHandle::filepath_at(unsigned int index) const {
 #if LIBTORRENT_VERSION_MINOR > 15
   return misc::toQStringU(torrent_handle::get_torrent_info().file_at(index).path);
@@ -384,6 +389,10 @@ void QTorrentHandle::set_sequential_download(bool sd) const {
     torrent_handle::set_sequential_download(sd);
 }
 
+void QTorrentHandle::set_piece_deadline(int index, int deadline) const {
+    torrent_handle::set_piece_deadline(index, deadline);
+}
+
 bool QTorrentHandle::has_missing_files() const {
   const QStringList paths = absolute_files_path();
   foreach (const QString &path, paths) {
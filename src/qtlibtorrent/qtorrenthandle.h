@@ -78,6 +78,7 @@ public:
   bool is_queued() const;
   QString filename_at(unsigned int index) const;
   libtorrent::size_type filesize_at(unsigned int index) const;
+  libtorrent::size_type file_offset_at(unsigned int index) const;
   QString filepath_at(unsigned int index) const;
   QString orig_filepath_at(unsigned int index) const;
   std::vector<int> file_extremity_pieces_at(unsigned int index) const;
@@ -105,6 +106,7 @@ public:
   void queue_position_bottom() const;
   void super_seeding(bool ss) const;
   void set_sequential_download(bool sd) const;
+  void set_piece_deadline(int index, int deadline) const;
   bool has_missing_files() const;
   int num_uploads() const;
   bool is_valid() const;
@@ -46,73 +46,65 @@ TorrentModelItem::TorrentModelItem(const Transfer &h) : m_torrent(h)
   m_label = TorrentPersistentData::getLabel(h.hash());
 }
 
-TorrentModelItem::State TorrentModelItem::state() const
+TorrentModelItem::State TorrentModelItem::state(const TransferSnapshotEntry& e) const
 {
-  try {
-    // Pause or Queued
-    if (m_torrent.is_paused()) {
-      m_icon = QIcon(":/Icons/skin/paused.png");
-      m_fgColor = QColor("red");
-      return m_torrent.is_seed() ? STATE_PAUSED_UP : STATE_PAUSED_DL;
-    }
-    if (m_torrent.is_queued()) {
-      if (m_torrent.state() != qt_queued_for_checking
-          && m_torrent.state() != qt_checking_resume_data
-          && m_torrent.state() != qt_checking_files) {
-        m_icon = QIcon(":/Icons/skin/queued.png");
-        m_fgColor = QColor("grey");
-        return m_torrent.is_seed() ? STATE_QUEUED_UP : STATE_QUEUED_DL;
-      }
+  if (!e.valid) {
+    m_icon = QIcon(":/Icons/skin/error.png");
+    m_fgColor = QColor("red");
+    return STATE_INVALID;
+  }
+  // Pause or Queued
+  if (e.paused) {
+    m_icon = QIcon(":/Icons/skin/paused.png");
+    m_fgColor = QColor("red");
+    return e.seed ? STATE_PAUSED_UP : STATE_PAUSED_DL;
+  }
+  if (e.queued) {
+    if (e.status.state != qt_queued_for_checking
+        && e.status.state != qt_checking_resume_data
+        && e.status.state != qt_checking_files) {
+      m_icon = QIcon(":/Icons/skin/queued.png");
+      m_fgColor = QColor("grey");
+      return e.seed ? STATE_QUEUED_UP : STATE_QUEUED_DL;
     }
-    // Other states
-    switch(m_torrent.state()) {
-    case qt_allocating:
-    case qt_downloading_metadata:
-    case qt_downloading: {
-      if (m_torrent.download_payload_rate() > 0) {
-        m_icon = QIcon(":/Icons/skin/downloading.png");
-        m_fgColor = QColor("green");
-        return STATE_DOWNLOADING;
-      } else {
-        m_icon = QIcon(":/Icons/skin/stalledDL.png");
-        m_fgColor = QColor("grey");
-        return STATE_STALLED_DL;
-      }
+  }
+  // Other states
+  switch(e.status.state) {
+  case qt_allocating:
+  case qt_downloading_metadata:
+  case qt_downloading: {
+    if (e.status.download_payload_rate > 0) {
+      m_icon = QIcon(":/Icons/skin/downloading.png");
+      m_fgColor = QColor("green");
+      return STATE_DOWNLOADING;
+    } else {
+      m_icon = QIcon(":/Icons/skin/stalledDL.png");
+      m_fgColor = QColor("grey");
+      return STATE_STALLED_DL;
     }
-    case qt_finished:
-    case qt_seeding:
-      if (m_torrent.upload_payload_rate() > 0) {
-        m_icon = QIcon(":/Icons/skin/uploading.png");
-        m_fgColor = QColor("orange");
-        return STATE_SEEDING;
-      } else {
-        m_icon = QIcon(":/Icons/skin/stalledUP.png");
-        m_fgColor = QColor("grey");
-        return STATE_STALLED_UP;
-      }
-    case qt_queued_for_checking:
-    case qt_checking_resume_data:
-    case qt_checking_files:
-      m_icon = QIcon(":/Icons/skin/checking.png");
+  }
+  case qt_finished:
+  case qt_seeding:
+    if (e.status.upload_payload_rate > 0) {
+      m_icon = QIcon(":/Icons/skin/uploading.png");
+      m_fgColor = QColor("orange");
+      return STATE_SEEDING;
+    } else {
+      m_icon = QIcon(":/Icons/skin/stalledUP.png");
       m_fgColor = QColor("grey");
-      return m_torrent.is_seed() ? STATE_CHECKING_UP : STATE_CHECKING_DL;
-    default:
-      m_icon = QIcon(":/Icons/skin/error.png");
-      m_fgColor = QColor("red");
-      return STATE_INVALID;
+      return STATE_STALLED_UP;
     }
-  } catch(libtorrent::invalid_handle&)
-    {
+  case qt_queued_for_checking:
+  case qt_checking_resume_data:
+  case qt_checking_files:
+    m_icon = QIcon(":/Icons/skin/checking.png");
+    m_fgColor = QColor("grey");
+    return e.seed ? STATE_CHECKING_UP : STATE_CHECKING_DL;
+  default:
     m_icon = QIcon(":/Icons/skin/error.png");
     m_fgColor = QColor("red");
     return STATE_INVALID;
   }
-  catch(libed2k::libed2k_exception&)
-    {
-        m_icon = QIcon(":/Icons/skin/error.png");
-        m_fgColor = QColor("red");
-        return STATE_INVALID;
-    }
 }
 
 bool TorrentModelItem::setData(int column, const QVariant &value, int role)
@@ -150,35 +142,37 @@ QVariant TorrentModelItem::data(int column, int role) const
     return m_fgColor;
   }
   if (role != Qt::DisplayRole && role != Qt::UserRole) return QVariant();
-  if (!m_torrent.is_valid()) return QVariant();
+  // all columns are served from the session snapshot of the last tick
+  const TransferSnapshotEntry e = Session::instance()->getSnapshotEntry(m_hash);
+  if (!e.valid) return QVariant();
   switch(column) {
   case TR_NAME:
     return m_name.isEmpty()? m_torrent.name() : m_name;
   case TR_PRIORITY:
-    return m_torrent.queue_position();
+    return e.queue_position;
   case TR_SIZE:
-    return m_torrent.has_metadata() ? static_cast<qlonglong>(m_torrent.actual_size()) : -1;
+    return e.has_metadata ? static_cast<qlonglong>(e.actual_size) : -1;
   case TR_PROGRESS:
-    return m_torrent.progress();
+    return e.progress();
   case TR_STATUS:
-    return state();
+    return state(e);
   case TR_SEEDS: {
-    return (role == Qt::DisplayRole) ? m_torrent.num_seeds() : m_torrent.num_complete();
+    return (role == Qt::DisplayRole) ? e.status.num_seeds : e.status.num_complete;
   }
   case TR_PEERS: {
-    return (role == Qt::DisplayRole) ? (m_torrent.num_peers()-m_torrent.num_seeds()) : m_torrent.num_incomplete();
+    return (role == Qt::DisplayRole) ? (e.status.num_peers-e.status.num_seeds) : e.status.num_incomplete;
   }
   case TR_DLSPEED:
-    return m_torrent.download_payload_rate();
+    return e.status.download_payload_rate;
   case TR_UPSPEED:
-    return m_torrent.upload_payload_rate();
+    return e.status.upload_payload_rate;
   case TR_ETA: {
     // XXX: Is this correct?
-    if (m_torrent.is_seed() || m_torrent.is_paused() || m_torrent.is_queued()) return MAX_ETA;
-    return Session::instance()->getETA(m_torrent.hash());
+    if (e.seed || e.paused || e.queued) return MAX_ETA;
+    return Session::instance()->getETA(m_hash);
   }
   case TR_RATIO:
-    return Session::instance()->getRealRatio(m_torrent.hash());
+    return e.ratio();
   case TR_LABEL:
     return m_label;
   case TR_ADD_DATE:
@@ -186,17 +180,17 @@ QVariant TorrentModelItem::data(int column, int role) const
   case TR_SEED_DATE:
     return m_seedTime;
   case TR_TRACKER:
-    return m_torrent.current_tracker();
+    return e.status.current_tracker;
   case TR_DLLIMIT:
-    return m_torrent.download_limit();
+    return e.download_limit;
   case TR_UPLIMIT:
-    return m_torrent.upload_limit();
+    return e.upload_limit;
   case TR_AMOUNT_DOWNLOADED:
-    return static_cast<qlonglong>(m_torrent.total_wanted_done());
+    return static_cast<qlonglong>(e.status.total_wanted_done);
   case TR_AMOUNT_LEFT:
-    return static_cast<qlonglong>(m_torrent.total_wanted() - m_torrent.total_wanted_done());
+    return static_cast<qlonglong>(e.status.total_wanted - e.status.total_wanted_done);
   case TR_TIME_ELAPSED:
-    return (role == Qt::DisplayRole) ? m_torrent.active_time() : m_torrent.seeding_time();
+    return (role == Qt::DisplayRole) ? e.status.active_time : e.status.seeding_time;
   default:
     return QVariant();
   }
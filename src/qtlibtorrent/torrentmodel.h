@@ -38,6 +38,7 @@
 #include <QTimer>
 
 #include "transport/transfer.h"
+#include "transport/transfer_snapshot.h"
 
 struct TorrentStatusReport {
   TorrentStatusReport(): nb_downloading(0), nb_seeding(0), nb_active(0), nb_inactive(0), nb_paused(0) {}
@@ -62,7 +63,7 @@ signals:
   void labelChanged(QString previous, QString current);
 
 private:
-  State state() const;
+  State state(const TransferSnapshotEntry& e) const;
 
 private:
   Transfer m_torrent;
@@ -54,7 +54,7 @@ private:
 };
 
 TorrentSpeedMonitor::TorrentSpeedMonitor(Session* session) :
-  QThread(session), m_abort(false), m_session(session)
+  QThread(session), m_abort(false), m_session(session), m_lastTick(0)
 {
   connect(m_session, SIGNAL(deletedTransfer(QString)), SLOT(removeSamples(QString)));
   connect(m_session, SIGNAL(pausedTransfer(Transfer)), SLOT(removeSamples(Transfer)));
@@ -112,22 +112,22 @@ void TorrentSpeedMonitor::removeSamples(const Transfer& h) {
 qlonglong TorrentSpeedMonitor::getETA(const QString &hash) const
 {
   QMutexLocker locker(&m_mutex);
-  Transfer h = m_session->getTransfer(hash);
-  TransferStatus st = h.status();
-  if (!h.is_valid() || st.paused || !m_samples.contains(hash)) return -1;
+  const TransferSnapshotEntry e = m_session->getSnapshotEntry(hash);
+  if (!e.valid || e.status.paused || !m_samples.contains(hash)) return -1;
   const qreal speed_average = m_samples.value(hash).average();
   if (speed_average == 0) return -1;
-  return (st.total_wanted - st.total_wanted_done) / speed_average;
+  return (e.status.total_wanted - e.status.total_wanted_done) / speed_average;
 }
 
 void TorrentSpeedMonitor::getSamples()
 {
-  const std::vector<Transfer> torrents = m_session->getActiveTransfers();
-  std::vector<Transfer>::const_iterator it;
-  for (it = torrents.begin(); it != torrents.end(); it++) {
-    try {
-      if (!it->is_paused())
-        m_samples[it->hash()].addSample(it->status().download_payload_rate);
-    } catch(invalid_handle&) {}
+  const TransferSnapshot snapshot = m_session->getSnapshot();
+  // do not sample the same tick twice
+  if (snapshot.tick() == m_lastTick) return;
+  m_lastTick = snapshot.tick();
+  QHash<QString, TransferSnapshotEntry>::const_iterator it;
+  for (it = snapshot.entries().constBegin(); it != snapshot.entries().constEnd(); ++it) {
+    if (it->active && !it->paused)
+      m_samples[it.key()].addSample(it->status.download_payload_rate);
   }
 }
@@ -69,6 +69,7 @@ private:
   QHash<QString, SpeedSample> m_samples;
   mutable QMutex m_mutex;
   Session *m_session;
+  quint64 m_lastTick; // snapshot tick of last sampling
 };
 
 #endif // TORRENTSPEEDMONITOR_H
@@ -4,7 +4,7 @@
 #include <QString>
 
 BaseModel::BaseModel(DirNode* root, QObject *parent/* = 0*/) :
-    QAbstractItemModel(parent), m_rootItem(root), m_row_count_changed(false)
+    QAbstractItemModel(parent), m_rootItem(root), m_removing(NULL), m_loading(false), m_flush_scheduled(false)
 {
     // integrate model into session
     connect(Session::instance(), SIGNAL(changeNode(const FileNode*)), this, SLOT(changeNode(const FileNode*)));
@@ -12,6 +12,8 @@ BaseModel::BaseModel(DirNode* root, QObject *parent/* = 0*/) :
     connect(Session::instance(), SIGNAL(endRemoveNode()), this, SLOT(endRemoveNode()));
     connect(Session::instance(), SIGNAL(beginInsertNode(const FileNode*)), this, SLOT(beginInsertNode(const FileNode*)));
     connect(Session::instance(), SIGNAL(endInsertNode()), this, SLOT(endInsertNode()));
+    connect(Session::instance(), SIGNAL(beginLoadSharedFileSystem()), this, SLOT(beginLoadSharedFileSystem()));
+    connect(Session::instance(), SIGNAL(endLoadSharedFileSystem()), this, SLOT(endLoadSharedFileSystem()));
 }
 
 BaseModel::~BaseModel()
@@ -80,6 +82,8 @@ void BaseModel::setRootNode(const QModelIndex& index)
     {
         qDebug() << "set index to " << static_cast<DirNode*>(index.internalPointer())->filepath();
         m_rootItem = static_cast<DirNode*>(index.internalPointer());
+        m_published.clear();
+        m_changed.clear();
         reset();
     }
 }
@@ -90,6 +94,8 @@ void BaseModel::setRootNode(DirNode* node)
     {
         qDebug() << "set index to " << node->filepath();
         m_rootItem = node;
+        m_published.clear();
+        m_changed.clear();
         reset();
     }
 }
@@ -123,33 +129,19 @@ qint64 BaseModel::size(const QModelIndex &index) const
 QString BaseModel::type(const QModelIndex &index) const
 {
     if (!index.isValid()) return QString();
-    FileNode* p = node(index);
-
-    if (p->m_displayType.isEmpty())
-    {
-        p->m_displayType = m_iconProvider.type(p->m_info);
-    }
-
-    return p->m_displayType;
+    return appearance(node(index)).type;
 }
 
 QDateTime BaseModel::lastModified(const QModelIndex &index) const
 {
     if (!index.isValid()) return QDateTime();
-    return node(index)->m_info.lastModified();
+    return node(index)->last_modified();
 }
 
 QIcon BaseModel::icon(const QModelIndex& index) const
 {
     if (!index.isValid()) return QIcon();
-    FileNode* p = node(index);
-
-    if (p->m_icon.isNull())
-    {
-        p->m_icon = m_iconProvider.icon(p->m_info);
-    }
-
-    return p->m_icon;
+    return appearance(node(index)).icon;
 }
 
 QString BaseModel::displayName(const QModelIndex &index) const
@@ -182,7 +174,7 @@ QString BaseModel::time(const QModelIndex& index) const
 {
     if (!index.isValid()) return QString();
 #ifndef QT_NO_DATESTRING
-    return node(index)->m_info.lastModified().toString(Qt::SystemLocaleDate);
+    return node(index)->last_modified().toString(Qt::SystemLocaleDate);
 #else
     Q_UNUSED(index);
     return QString();
@@ -192,13 +184,13 @@ QString BaseModel::time(const QModelIndex& index) const
 QDateTime BaseModel::dt(const QModelIndex& index) const
 {
     if (!index.isValid()) return QDateTime();
-    return node(index)->m_info.lastModified();
+    return node(index)->last_modified();
 }
 
 QFile::Permissions BaseModel::permissions(const QModelIndex &index) const
 {
     if (!index.isValid()) return QFile::Permissions();
-    return node(index)->m_info.permissions();
+    return node(index)->info().permissions();
 }
 
 QString BaseModel::error(const QModelIndex& index) const
@@ -272,6 +264,36 @@ Qt::CheckState BaseModel::state(const QModelIndex& index) const
     return st;
 }
 
+const BaseModel::Appearance& BaseModel::appearance(const FileNode* p) const
+{
+    // drives have own icons, directories share one and files share by extension
+    static QHash<QString, Appearance> cache;
+    QString key;
+
+    if (p->m_parent && p->m_parent->is_root())
+        key = QLatin1String("drive:") + p->filename();
+    else if (p->is_dir())
+        key = QLatin1String("dir");
+    else
+    {
+        const int dot = p->filename().lastIndexOf(QLatin1Char('.'));
+        key = QLatin1String("file:") + ((dot < 0) ? QString() : p->filename().mid(dot + 1).toLower());
+    }
+
+    QHash<QString, Appearance>::iterator itr = cache.find(key);
+
+    if (itr == cache.end())
+    {
+        const QFileInfo info = p->info();
+        Appearance a;
+        a.icon = m_iconProvider.icon(info);
+        a.type = m_iconProvider.type(info);
+        itr = cache.insert(key, a);
+    }
+
+    return itr.value();
+}
+
 FileNode* BaseModel::node(const QModelIndex& index) const
 {
     FileNode* p = static_cast<FileNode*>(index.internalPointer());
@@ -280,71 +302,170 @@ FileNode* BaseModel::node(const QModelIndex& index) const
 }
 
 
-// slots
-void BaseModel::changeNode(const FileNode* node)
+int BaseModel::published_rows(const DirNode* parent) const
 {
-    QModelIndex indx = index(node);        
+    QHash<const DirNode*, int>::const_iterator itr = m_published.constFind(parent);
+    return (itr != m_published.constEnd()) ? itr.value() : children_count(parent);
+}
 
-    if (indx.isValid())
+void BaseModel::publish()
+{
+    // appended rows of each parent are one range
+    QHash<const DirNode*, int> published;
+    published.swap(m_published);
+
+    for (QHash<const DirNode*, int>::const_iterator itr = published.constBegin(); itr != published.constEnd(); ++itr)
     {
-        emitChangeSignal(indx);
+        const int count = children_count(itr.key());
+
+        if (count > itr.value())
+        {
+            beginInsertRows(node2index(itr.key()), itr.value(), count - 1);
+            endInsertRows();
+        }
+    }
+
+    // group changed nodes by parent and find their rows by one pass over parent children
+    QHash<const DirNode*, QSet<const FileNode*> > parents;
+
+    foreach(const FileNode* p, m_changed)
+    {
+        if (is_row(p)) parents[p->m_parent].insert(p);
+    }
+
+    m_changed.clear();
+
+    for (QHash<const DirNode*, QSet<const FileNode*> >::const_iterator itr = parents.constBegin(); itr != parents.constEnd(); ++itr)
+    {
+        QList<int> rows;
+        const int count = children_count(itr.key());
+
+        for (int row = 0; row < count; ++row)
+        {
+            if (itr.value().contains(child_at(itr.key(), row))) rows << row;
+        }
+
+        emitChangedRows(node2index(itr.key()), rows);
     }
 }
 
-void BaseModel::beginRemoveNode(const FileNode* node)
+void BaseModel::emitChangedRows(const QModelIndex& parent, const QList<int>& rows)
 {
-    QModelIndex indx = index(node);
-    m_row_count_changed = false;
+    int first = 0;
 
-    if (indx.isValid())
+    for (int i = 0; i < rows.size(); ++i)
     {
-        qDebug() << "beginRemoveNode row: " << indx.row();
-        beginRemoveRows(parent(indx), indx.row(), indx.row());
-        m_row_count_changed = true;
+        if (i + 1 == rows.size() || rows.at(i + 1) != rows.at(i) + 1)
+        {
+            emitChangeSignal(parent, rows.at(first), rows.at(i));
+            first = i + 1;
+        }
     }
+}
 
+void BaseModel::scheduleFlush()
+{
+    if (!m_flush_scheduled && !m_loading)
+    {
+        m_flush_scheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
 }
 
-void BaseModel::endRemoveNode()
+void BaseModel::forget(const FileNode* node)
 {
-    if (m_row_count_changed)
+    m_changed.remove(node);
+    if (!node->is_dir()) return;
+
+    // directory deletes its subtree silently
+    QSet<const FileNode*>::iterator itr = m_changed.begin();
+
+    while (itr != m_changed.end())
     {
-        endRemoveRows();
-        m_row_count_changed = false;
+        const FileNode* p = (*itr)->m_parent;
+        while (p && p != node) p = p->m_parent;
+        itr = p ? m_changed.erase(itr) : itr + 1;
+    }
+
+    QHash<const DirNode*, int>::iterator pitr = m_published.begin();
+
+    while (pitr != m_published.end())
+    {
+        const FileNode* p = pitr.key();
+        while (p && p != node) p = p->m_parent;
+        pitr = p ? m_published.erase(pitr) : pitr + 1;
     }
 }
 
-void BaseModel::beginInsertNode(const FileNode* node)
+void BaseModel::flush()
+{
+    m_flush_scheduled = false;
+    if (!m_loading) publish();
+}
+
+// slots
+void BaseModel::changeNode(const FileNode* node)
+{
+    // loading ends with reset
+    if (m_loading) return;
+    m_changed.insert(node);
+    scheduleFlush();
+}
+
+void BaseModel::beginRemoveNode(const FileNode* node)
 {
-    QModelIndex indx = index(node);
-    m_row_count_changed = false;
+    forget(node);
+    m_removing = NULL;
 
-    if (indx.isValid())
+    if (is_row(node))
     {
-        int row = 0;
-        FileNode* node = static_cast<FileNode*>(indx.internalPointer());
-        DirNode* parent_node = node->m_parent;
+        const int row = node2row(node);
 
-        if (node->is_dir())
+        // rows appended after last batch were never announced
+        if (row < published_rows(node->m_parent))
         {
-            row = parent_node->m_dir_vector.size();
-        }
-        else
-        {
-            row = parent_node->m_file_vector.size();
+            beginRemoveRows(node2index(node->m_parent), row, row);
+            m_removing = node->m_parent;
         }
+    }
+}
 
-        qDebug() << "beginInsertNode row: " << row;
-        beginInsertRows(index(parent_node), row, row);
-        m_row_count_changed = true;
+void BaseModel::endRemoveNode()
+{
+    if (m_removing)
+    {
+        QHash<const DirNode*, int>::iterator itr = m_published.find(m_removing);
+        if (itr != m_published.end()) --itr.value();
+        m_removing = NULL;
+        endRemoveRows();
     }
 }
 
-void BaseModel::endInsertNode()
+void BaseModel::beginInsertNode(const FileNode* node)
 {
-    if (m_row_count_changed)
+    // row is appended by parent now, it will be announced with other rows of batch
+    if (is_row(node) && !m_published.contains(node->m_parent))
     {
-        endInsertRows();
-        m_row_count_changed = false;
+        m_published.insert(node->m_parent, children_count(node->m_parent));
+        scheduleFlush();
     }
 }
+
+void BaseModel::endInsertNode()
+{
+}
+
+void BaseModel::beginLoadSharedFileSystem()
+{
+    m_loading = true;
+}
+
+void BaseModel::endLoadSharedFileSystem()
+{
+    // one reset instead of events of whole shared filesystem
+    m_loading = false;
+    m_published.clear();
+    m_changed.clear();
+    resync();
+    reset();
+}
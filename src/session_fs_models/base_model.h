@@ -2,7 +2,9 @@
 #define __BASE_MODEL__
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QModelIndex>
+#include <QSet>
 #include <QVariant>
 #include "transport/session_filesystem.h"
 
@@ -66,13 +68,65 @@ public:
 protected:
      int elements_count(const DirNode* node) const;
      FileNode* node(const QModelIndex& index) const;
+
+     struct Appearance
+     {
+         QIcon   icon;
+         QString type;
+     };
+
+     /**
+       * icon and type name are shared by all files with same extension
+      */
+     const Appearance& appearance(const FileNode* p) const;
      virtual QModelIndex node2index(const FileNode*) const = 0;
      virtual int node2row(const FileNode*) const = 0;
      virtual int colcount() const = 0;
-     virtual void emitChangeSignal(const QModelIndex& index) = 0;
+
+     /**
+       * node is row of this model, rows of parent are children_count(parent) first children
+      */
+     virtual bool is_row(const FileNode* node) const = 0;
+     virtual int children_count(const DirNode* parent) const = 0;
+     virtual const FileNode* child_at(const DirNode* parent, int row) const = 0;
+
+     /**
+       * rows first..last of parent were changed
+      */
+     virtual void emitChangeSignal(const QModelIndex& parent, int first, int last) = 0;
+
+     /**
+       * rows of parent which views know about, appended rows are announced by batch
+      */
+     int published_rows(const DirNode* parent) const;
+
+     /**
+       * announce rows appended since last batch and changed rows, called once per event loop iteration
+      */
+     virtual void publish();
+
+     /**
+       * rebuild own data after shared filesystem was loaded, model is reset after call
+      */
+     virtual void resync() {}
+
+     /**
+       * emit change signal for each contiguous run of sorted rows
+      */
+     void emitChangedRows(const QModelIndex& parent, const QList<int>& rows);
+     void scheduleFlush();
+
+     /**
+       * drop pending events of node and its subtree before node is deleted
+      */
+     void forget(const FileNode* node);
 
      DirNode*   m_rootItem;
-     bool       m_row_count_changed;
+     const DirNode* m_removing;     // parent of row in removal
+     bool       m_loading;
+     bool       m_flush_scheduled;
+     QHash<const DirNode*, int> m_published;    // parents with appended rows not announced yet
+     QSet<const FileNode*>      m_changed;      // nodes changed since last batch
      QFileIconProvider  m_iconProvider;
 public slots:
 
@@ -81,6 +135,10 @@ public slots:
     void endRemoveNode();
     void beginInsertNode(const FileNode* node);
     void endInsertNode();
+    void beginLoadSharedFileSystem();
+    void endLoadSharedFileSystem();
+private slots:
+    void flush();
 };
 
 
@@ -39,7 +39,7 @@ int DirectoryModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) cons
         parentNode = static_cast<DirNode*>(parent.internalPointer());
 
     parentNode->populate();
-    return parentNode->m_dir_vector.size();
+    return published_rows(parentNode);
 }
 
 bool DirectoryModel::hasChildren(const QModelIndex & parent /* = QModelIndex()*/) const
@@ -172,6 +172,18 @@ QVariant DirectoryModel::data(const QModelIndex &index, int role) const
                 res = f;
             }
         }
+        break;
+    case Qt::ToolTipRole:
+        if (index.column() == DC_STATUS && node(index)->is_dir())
+        {
+            // live totals of folder subtree
+            const NodeCounters& c = static_cast<const DirNode*>(node(index))->counters();
+            QString tip = tr("Files: %1, shared: %2 (%3)").arg(c.files).arg(c.transfer_files).arg(size(c.shared_bytes));
+            if (c.active_files > c.transfer_files) tip += "\n" + tr("Hashing: %1").arg(c.active_files - c.transfer_files);
+            if (c.error_files) tip += "\n" + tr("Errors: %1").arg(c.error_files);
+            res = tip;
+        }
+        break;
     default:
         break;
     }
@@ -179,7 +191,7 @@ QVariant DirectoryModel::data(const QModelIndex &index, int role) const
     return res;
 }
 
-void DirectoryModel::emitChangeSignal(const QModelIndex& indx)
+void DirectoryModel::emitChangeSignal(const QModelIndex& parent, int first, int last)
 {
-    emit dataChanged(indx, indx);
+    emit dataChanged(index(first, 0, parent), index(last, 0, parent));
 }
@@ -21,7 +21,10 @@ protected:
     virtual QModelIndex node2index(const FileNode*) const;
     virtual int node2row(const FileNode*) const;
     virtual int colcount() const { return 1; }
-    virtual void emitChangeSignal(const QModelIndex&);
+    virtual bool is_row(const FileNode* node) const { return node->is_dir() && node != m_rootItem; }
+    virtual int children_count(const DirNode* parent) const { return parent->m_dir_vector.size(); }
+    virtual const FileNode* child_at(const DirNode* parent, int row) const { return parent->m_dir_vector.at(row); }
+    virtual void emitChangeSignal(const QModelIndex& parent, int first, int last);
 };
 
 #endif // __DIR_MODEL__H__
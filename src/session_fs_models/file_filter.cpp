@@ -1,15 +1,46 @@
 #include "file_filter.h"
+#include "transport/session.h"
 
+QList<FileNode*> BaseFilter::files() const
+{
+    return Session::instance()->files().values();
+}
 
 PathFilter::PathFilter(const QString& parent_path) : m_parentpath(parent_path)
 {
 }
 
+bool PathFilter::match(const FileNode* node) const
+{
+    return node->m_parent && node->m_parent->path() == m_parentpath;
+}
+
+QList<FileNode*> PathFilter::files() const
+{
+    // children list of directory is the per-parent index
+    QList<FileNode*> res;
+    const DirNode* dir = dynamic_cast<const DirNode*>(Session::instance()->findNode(m_parentpath));
+
+    if (dir)
+    {
+        foreach(FileNode* p, dir->files())
+        {
+            if (Session::instance()->isRegistered(p)) res.append(p);
+        }
+    }
+
+    return res;
+}
+
 TypeFilter::TypeFilter(libed2k::EED2KFileType type) : m_type(type)
 {}
 
-bool TypeFilter::match(const QString& parent_path, const QString& filename) const
+bool TypeFilter::match(const FileNode* node) const
+{
+    return (m_type == node->type());
+}
+
+QList<FileNode*> TypeFilter::files() const
 {
-    Q_UNUSED(parent_path);
-    return (m_type == libed2k::GetED2KFileTypeID(filename.toLower().toStdString()));
+    return Session::instance()->filesOfType(m_type);
 }
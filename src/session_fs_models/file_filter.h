@@ -1,16 +1,24 @@
 #ifndef __FILE_FILTER__
 #define __FILE_FILTER__
 
+#include <QList>
 #include <QString>
 #include <libed2k/file.hpp>
 
+class FileNode;
+
 /**
   * base filter, always true
  */
 class BaseFilter
 {
 public:
-    virtual bool match(const QString& parent_path, const QString& filename) const { return true; }
+    virtual bool match(const FileNode* node) const { return true; }
+
+    /**
+      * registered files passing filter, taken from session indexes
+     */
+    virtual QList<FileNode*> files() const;
     virtual ~BaseFilter() {}
 };
 
@@ -23,7 +31,8 @@ private:
     QString m_parentpath;
 public:
     PathFilter(const QString& parent_path);
-    virtual bool match(const QString& parent_path, const QString& filename) const { return parent_path == m_parentpath;}
+    virtual bool match(const FileNode* node) const;
+    virtual QList<FileNode*> files() const;
 };
 
 /**
@@ -35,7 +44,8 @@ private:
     libed2k::EED2KFileType  m_type;
 public:
     TypeFilter(libed2k::EED2KFileType type);
-    virtual bool match(const QString& parent_path, const QString& filename) const;
+    virtual bool match(const FileNode* node) const;
+    virtual QList<FileNode*> files() const;
 };
 
 #endif
@@ -37,7 +37,7 @@ int FilesModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) const
         parentNode = static_cast<DirNode*>(parent.internalPointer());
 
     parentNode->populate();
-    return parentNode->m_file_vector.size();
+    return published_rows(parentNode);
 }
 
 bool FilesModel::hasChildren(const QModelIndex & parent /*= QModelIndex()*/) const
@@ -265,9 +265,7 @@ int FilesModel::node2row(const FileNode* node) const
     return row;
 }
 
-void FilesModel::emitChangeSignal(const QModelIndex& indx)
+void FilesModel::emitChangeSignal(const QModelIndex& parent, int first, int last)
 {
-    emit dataChanged(indx, indx);
-    emit dataChanged(index(indx.row(), columnCount() - 2, parent(indx)),
-                               index(indx.row(), columnCount() - 1, parent(indx)));
+    emit dataChanged(index(first, 0, parent), index(last, columnCount() - 1, parent));
 }
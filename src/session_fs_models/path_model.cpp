@@ -2,20 +2,29 @@
 #include "session.h"
 
 PathModel::PathModel(QObject *parent /* = 0*/)
-    : QAbstractListModel(parent)
+    : QAbstractListModel(parent), m_published_paths(-1), m_loading(false)
 {
+    sync();
+    connect(Session::instance(), SIGNAL(insertSharedDirectory(const DirNode*)), this, SLOT(on_insertSharedDirectory(const DirNode*)));
+    connect(Session::instance(), SIGNAL(removeSharedDirectory(const DirNode*)), this, SLOT(on_removeSharedDirectory(const DirNode*)));
+    connect(Session::instance(), SIGNAL(beginLoadSharedFileSystem()), this, SLOT(beginLoadSharedFileSystem()));
+    connect(Session::instance(), SIGNAL(endLoadSharedFileSystem()), this, SLOT(endLoadSharedFileSystem()));
+}
+
+void PathModel::sync()
+{
+    m_paths.clear();
+    m_published_paths = -1;
+
     foreach(const DirNode* node, Session::instance()->directories())
     {
         m_paths.append(node);
     }
-
-    connect(Session::instance(), SIGNAL(insertSharedDirectory(const DirNode*)), this, SLOT(on_insertSharedDirectory(const DirNode*)));
-    connect(Session::instance(), SIGNAL(removeSharedDirectory(const DirNode*)), this, SLOT(on_removeSharedDirectory(const DirNode*)));
 }
 
 int PathModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) const
 {
-    return m_paths.size() + filters_count;
+    return ((m_published_paths < 0) ? m_paths.size() : m_published_paths) + filters_count;
 }
 
 QVariant PathModel::data(const QModelIndex &index, int role) const
@@ -181,20 +190,60 @@ void PathModel::on_removeSharedDirectory(const DirNode* node)
 
     if (row != -1)
     {
-        beginRemoveRows(QModelIndex(), row, row);
+        if (m_published_paths >= 0 && row >= m_published_paths)
+        {
+            // path wasn't announced yet
+            m_paths.removeAt(row);
+            return;
+        }
+
+        beginRemoveRows(QModelIndex(), row + filters_count, row + filters_count);
         m_paths.removeAt(row);
+        if (m_published_paths >= 0) --m_published_paths;
         endRemoveRows();
     }
 }
 
 void PathModel::on_insertSharedDirectory(const DirNode* node)
 {
+    // model is synchronized after loading
+    if (m_loading) return;
+
     if (node2row(node) == -1)
     {
-        beginInsertRows(QModelIndex(), m_paths.size(), m_paths.size());
+        if (m_published_paths < 0)
+        {
+            m_published_paths = m_paths.size();
+            QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+        }
+
         m_paths.append(node);
+    }
+}
+
+void PathModel::beginLoadSharedFileSystem()
+{
+    m_loading = true;
+}
+
+void PathModel::endLoadSharedFileSystem()
+{
+    m_loading = false;
+    sync();
+    reset();
+}
+
+void PathModel::flush()
+{
+    // all directories shared during event loop iteration are one range
+    if (m_published_paths >= 0 && m_paths.size() > m_published_paths)
+    {
+        beginInsertRows(QModelIndex(), m_published_paths + filters_count, m_paths.size() + filters_count - 1);
+        m_published_paths = -1;
         endInsertRows();
     }
+
+    m_published_paths = -1;
 }
 
 int PathModel::node2row(const DirNode* node) const
@@ -24,9 +24,16 @@ public:
 public slots:
     void on_removeSharedDirectory(const DirNode*);
     void on_insertSharedDirectory(const DirNode*);
+    void beginLoadSharedFileSystem();
+    void endLoadSharedFileSystem();
+private slots:
+    void flush();
 private:
     QList<const DirNode*> m_paths;
+    int     m_published_paths;  // -1 when all paths were announced
+    bool    m_loading;
     int node2row(const DirNode*) const;
+    void sync();
 };
 
 #endif // __PATH_MODEL__
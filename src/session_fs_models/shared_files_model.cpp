@@ -1,6 +1,6 @@
 #include "shared_files_model.h"
 
-SFModel::SFModel(QObject *parent /*= 0*/) : FilesModel(Session::instance()->root(), parent)
+SFModel::SFModel(QObject *parent /*= 0*/) : FilesModel(Session::instance()->root(), parent), m_published_files(-1)
 {
     sync();
     connect(Session::instance(), SIGNAL(removeSharedFile(FileNode*)), this, SLOT(on_removeSharedFile(FileNode*)));
@@ -9,7 +9,7 @@ SFModel::SFModel(QObject *parent /*= 0*/) : FilesModel(Session::instance()->root
 
 int SFModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) const
 {
-    return m_files.size();
+    return (m_published_files < 0) ? m_files.size() : m_published_files;
 }
 
 QModelIndex SFModel::parent(const QModelIndex &index) const
@@ -40,8 +40,8 @@ QModelIndex SFModel::index(int row, int column,
 void SFModel::setFilter(BaseFilter* filter)
 {
     m_filter.reset(filter);
-    m_files.clear();
-    sync();
+    resync();
+    m_changed.clear();
     reset();
 }
 
@@ -61,31 +61,71 @@ int SFModel::node2row(const FileNode* node) const
 
 void SFModel::sync()
 {
-    foreach(FileNode* p, Session::instance()->files().values())
+    if (!m_filter.isNull()) m_files = m_filter->files();
+}
+
+void SFModel::publish()
+{
+    if (m_published_files >= 0 && m_files.size() > m_published_files)
+    {
+        beginInsertRows(QModelIndex(), m_published_files, m_files.size() - 1);
+        m_published_files = -1;
+        endInsertRows();
+    }
+
+    m_published_files = -1;
+    QList<int> rows;
+
+    if (!m_changed.isEmpty())
     {
-        if (!m_filter.isNull() && (m_filter->match(p->parent_path(), p->filename())))
-            m_files.append(p);
+        for (int row = 0; row < m_files.size(); ++row)
+        {
+            if (m_changed.contains(m_files.at(row))) rows << row;
+        }
+
+        m_changed.clear();
     }
+
+    emitChangedRows(QModelIndex(), rows);
+}
+
+void SFModel::resync()
+{
+    m_files.clear();
+    m_published_files = -1;
+    sync();
 }
 
 void SFModel::on_removeSharedFile(FileNode* node)
 {
+    m_changed.remove(node);
     int row = node2row(node);
 
     if (row != -1)
     {
+        if (m_published_files >= 0 && row >= m_published_files)
+        {
+            // file wasn't announced yet
+            m_files.removeAt(row);
+            return;
+        }
+
         beginRemoveRows(QModelIndex(), row, row);
         m_files.removeAt(row);
+        if (m_published_files >= 0) --m_published_files;
         endRemoveRows();
     }
 }
 
 void SFModel::on_insertSharedFile(FileNode* node)
 {
-    if (!m_filter.isNull() && (m_filter->match(node->parent_path(), node->filename())))
+    // model is synchronized after loading
+    if (m_loading) return;
+
+    if (!m_filter.isNull() && m_filter->match(node))
     {
-        beginInsertRows(QModelIndex(), m_files.size(), m_files.size());
+        if (m_published_files < 0) m_published_files = m_files.size();
         m_files.append(node);
-        endInsertRows();
+        scheduleFlush();
     }
 }
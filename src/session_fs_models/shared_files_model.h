@@ -18,8 +18,12 @@ public:
 public slots:
     void on_removeSharedFile(FileNode*);
     void on_insertSharedFile(FileNode*);
+protected:
+    virtual void publish();
+    virtual void resync();
 private:    
     QList<FileNode*>    m_files;
+    int                 m_published_files;  // -1 when all files were announced
     QScopedPointer<BaseFilter> m_filter;
     int node2row(const FileNode*) const;
     void sync();
@@ -70,6 +70,20 @@ int naturalCompare(const QString &s1, const QString &s2,  Qt::CaseSensitivity cs
 }
 
 
+// nodes keep precomputed keys, comparisons don't build model data
+static bool nameLessThan(const FileNode* l, const FileNode* r)
+{
+    const int res = QString::compare(l->sort_name(), r->sort_name());
+    if (res != 0) return res < 0;
+    return l->filename() < r->filename();
+}
+
+static int stateKey(const FileNode* p)
+{
+    if (!p->is_active()) return Qt::Unchecked;
+    return p->has_transfer() ? Qt::Checked : Qt::PartiallyChecked;
+}
+
 SessionFilesSort::SessionFilesSort(QObject* parent /* = 0*/) : QSortFilterProxyModel(parent)
 {
     setSortRole(BaseModel::SortRole);
@@ -77,11 +91,30 @@ SessionFilesSort::SessionFilesSort(QObject* parent /* = 0*/) : QSortFilterProxyM
 
 bool SessionFilesSort::lessThan(const QModelIndex& left, const QModelIndex& right) const
 {
-    if (left.column() == BaseModel::DC_NAME)
+    const FileNode* l = static_cast<const FileNode*>(left.internalPointer());
+    const FileNode* r = static_cast<const FileNode*>(right.internalPointer());
+    Q_ASSERT(l && r);
+
+    switch (left.column())
     {
-        return (naturalCompare(sourceModel()->data(left, Qt::DisplayRole).toString(),
-                               sourceModel()->data(right, Qt::DisplayRole).toString(),
-                               Qt::CaseSensitive) < 0);
+    case BaseModel::DC_STATUS:
+        return stateKey(l) < stateKey(r);
+    case BaseModel::DC_NAME:
+        return nameLessThan(l, r);
+    case BaseModel::DC_FSIZE:
+        return l->size_on_disk() < r->size_on_disk();
+    case BaseModel::DC_TYPE:
+        if (l->type() != r->type()) return l->type() < r->type();
+        return nameLessThan(l, r);
+    case BaseModel::DC_TIME:
+        return l->modified_time() < r->modified_time();
+    case BaseModel::DC_HASH:
+        if (l->has_transfer() != r->has_transfer()) return r->has_transfer();
+        return l->has_transfer() && l->m_hash < r->m_hash;
+    case BaseModel::DC_ERROR:
+        return !l->m_error && r->m_error;
+    default:
+        break;
     }
 
     return (QSortFilterProxyModel::lessThan(left, right));
@@ -89,14 +122,9 @@ bool SessionFilesSort::lessThan(const QModelIndex& left, const QModelIndex& righ
 
 bool SessionDirectoriesSort::lessThan(const QModelIndex& left, const QModelIndex& right) const
 {
-    if (left.column() == BaseModel::DC_NAME)
-    {
-        return (naturalCompare(sourceModel()->data(left, Qt::DisplayRole).toString(),
-                               sourceModel()->data(right, Qt::DisplayRole).toString(),
-                               Qt::CaseSensitive) < 0);
-    }
-
-    return (QSortFilterProxyModel::lessThan(left, right));
+    // directories model has name column only
+    return nameLessThan(static_cast<const FileNode*>(left.internalPointer()),
+                        static_cast<const FileNode*>(right.internalPointer()));
 }
 
 bool PathsSort::lessThan(const QModelIndex& left, const QModelIndex& right) const
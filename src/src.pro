@@ -106,6 +106,7 @@ HEADERS += misc.h \
            downloadthread.h \
            stacktrace.h \
            torrentpersistentdata.h \
+           torrentdatacache.h \
            filesystemwatcher.h \
            scannedfoldersmodel.h \
            qinisettings.h \
@@ -115,6 +116,7 @@ SOURCES += main.cpp \
            downloadthread.cpp \
            scannedfoldersmodel.cpp \
            misc.cpp \
+           torrentdatacache.cpp \
            smtp.cpp
 
 HEADERS +=  mainwindow.h\
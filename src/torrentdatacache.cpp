@@ -0,0 +1,264 @@
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+
+#include "torrentdatacache.h"
+#include "qinisettings.h"
+#include "misc.h"
+
+namespace
+{
+    const char* const section_keys[] = { "torrents", "torrents-tmp" };
+
+    // how transfer hash is stored in record key
+    enum KeyFormat
+    {
+        key_hex_lower = 0,
+        key_hex_upper = 1,
+        key_text = 2
+    };
+
+    QMutex instance_mutex;
+    TorrentDataCache* cache_instance = 0;
+
+    /**
+     * section byte, format byte and hash in binary form when it can be restored exactly
+     */
+    QByteArray encodeKey(int section, const QString& hash)
+    {
+        const QByteArray text = hash.toLatin1();
+        const QByteArray raw = QByteArray::fromHex(text);
+        QByteArray res;
+        res.append(char(section));
+
+        if (!raw.isEmpty() && raw.toHex() == text)
+            res.append(char(key_hex_lower)).append(raw);
+        else if (!raw.isEmpty() && raw.toHex().toUpper() == text)
+            res.append(char(key_hex_upper)).append(raw);
+        else
+            res.append(char(key_text)).append(hash.toUtf8());
+
+        return res;
+    }
+
+    bool decodeKey(const QByteArray& key, int& section, QString& hash)
+    {
+        if (key.size() < 2) return false;
+        section = key.at(0);
+        if (section != TorrentDataCache::Persistent && section != TorrentDataCache::Temp) return false;
+
+        const QByteArray data = key.mid(2);
+
+        switch (key.at(1))
+        {
+            case key_hex_lower: hash = QString::fromLatin1(data.toHex().constData()); break;
+            case key_hex_upper: hash = QString::fromLatin1(data.toHex().toUpper().constData()); break;
+            case key_text:      hash = QString::fromUtf8(data.constData(), data.size()); break;
+            default: return false;
+        }
+
+        return true;
+    }
+
+    QByteArray encodeValue(const QHash<QString, QVariant>& value)
+    {
+        QByteArray res;
+        QDataStream ds(&res, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_4_6);
+        ds << value;
+        return res;
+    }
+
+    bool decodeValue(const QByteArray& data, QHash<QString, QVariant>& value)
+    {
+        QDataStream ds(data);
+        ds.setVersion(QDataStream::Qt_4_6);
+        ds >> value;
+        return ds.status() == QDataStream::Ok;
+    }
+}
+
+TorrentDataCache* TorrentDataCache::instance()
+{
+    QMutexLocker locker(&instance_mutex);
+
+    if (!cache_instance)
+    {
+        cache_instance = new TorrentDataCache();
+
+        // write back timer must live in thread with event loop
+        if (QCoreApplication::instance())
+        {
+            cache_instance->moveToThread(QCoreApplication::instance()->thread());
+            qAddPostRoutine(&TorrentDataCache::drop);
+        }
+    }
+
+    return cache_instance;
+}
+
+void TorrentDataCache::drop()
+{
+    QMutexLocker locker(&instance_mutex);
+    delete cache_instance;
+    cache_instance = 0;
+}
+
+TorrentDataCache::TorrentDataCache() : m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    const QString location = misc::QDesktopServicesDataLocation();
+    QDir().mkpath(location);
+    QHash<QByteArray, QByteArray> records;
+    m_journal.open(QDir::cleanPath(location + QDir::separator() + "transfers.journal"), records);
+
+    for (QHash<QByteArray, QByteArray>::const_iterator itr = records.constBegin(); itr != records.constEnd(); ++itr)
+    {
+        int section;
+        QString hash;
+        QHash<QString, QVariant> value;
+
+        if (decodeKey(itr.key(), section, hash) && decodeValue(itr.value(), value))
+            m_data[section].insert(hash, value);
+        else
+            qDebug() << "skip bad transfer data record";
+    }
+
+    if (records.isEmpty()) migrate();
+}
+
+TorrentDataCache::~TorrentDataCache()
+{
+    flush();
+}
+
+void TorrentDataCache::migrate()
+{
+    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
+    int count = 0;
+
+    for (int s = Persistent; s <= Temp; ++s)
+    {
+        const QHash<QString, QVariant> all_data = settings.value(section_keys[s]).toHash();
+
+        for (QHash<QString, QVariant>::const_iterator itr = all_data.constBegin(); itr != all_data.constEnd(); ++itr)
+        {
+            const QHash<QString, QVariant> value = itr.value().toHash();
+            m_data[s].insert(itr.key(), value);
+            m_journal.put(encodeKey(s, itr.key()), encodeValue(value));
+            ++count;
+        }
+    }
+
+    // settings are cleaned only when records are on disk
+    if (count > 0 && m_journal.commit())
+    {
+        qDebug() << "moved " << count << " transfer data records from settings";
+        settings.remove(section_keys[Persistent]);
+        settings.remove(section_keys[Temp]);
+    }
+}
+
+bool TorrentDataCache::contains(Section s, const QString& hash) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data[s].contains(hash);
+}
+
+QStringList TorrentDataCache::hashes(Section s) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data[s].keys();
+}
+
+QVariant TorrentDataCache::value(Section s, const QString& hash, const QString& key, const QVariant& def /* = QVariant()*/) const
+{
+    QMutexLocker locker(&m_mutex);
+    Data::const_iterator itr = m_data[s].constFind(hash);
+    if (itr == m_data[s].constEnd()) return def;
+    return itr->value(key, def);
+}
+
+QHash<QString, QVariant> TorrentDataCache::entry(Section s, const QString& hash) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data[s].value(hash);
+}
+
+void TorrentDataCache::setValue(Section s, const QString& hash, const QString& key, const QVariant& value)
+{
+    QMutexLocker locker(&m_mutex);
+    m_data[s][hash][key] = value;
+    touch(s, hash);
+}
+
+void TorrentDataCache::removeValue(Section s, const QString& hash, const QString& key)
+{
+    QMutexLocker locker(&m_mutex);
+    m_data[s][hash].remove(key);
+    touch(s, hash);
+}
+
+void TorrentDataCache::removeEntry(Section s, const QString& hash)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_data[s].remove(hash)) touch(s, hash);
+}
+
+void TorrentDataCache::renameEntry(Section s, const QString& old_hash, const QString& new_hash)
+{
+    QMutexLocker locker(&m_mutex);
+    m_data[s][new_hash] = m_data[s].take(old_hash);
+    touch(s, old_hash);
+    touch(s, new_hash);
+}
+
+void TorrentDataCache::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_dirty[Persistent].isEmpty() && m_dirty[Temp].isEmpty()) return;
+
+    for (int s = Persistent; s <= Temp; ++s)
+    {
+        foreach (const QString& hash, m_dirty[s])
+        {
+            Data::const_iterator itr = m_data[s].constFind(hash);
+
+            if (itr == m_data[s].constEnd())
+                m_journal.remove(encodeKey(s, hash));
+            else
+                m_journal.put(encodeKey(s, hash), encodeValue(itr.value()));
+        }
+    }
+
+    // on failure records stay buffered in journal and go with next commit
+    const int count = m_dirty[Persistent].size() + m_dirty[Temp].size();
+    m_dirty[Persistent].clear();
+    m_dirty[Temp].clear();
+
+    if (m_journal.commit())
+        qDebug() << count << " transfer data records written";
+}
+
+void TorrentDataCache::touch(Section s, const QString& hash)
+{
+    m_dirty[s].insert(hash);
+
+    if (QThread::currentThread() == thread())
+        schedule();
+    else
+        QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+}
+
+void TorrentDataCache::schedule()
+{
+    // first change starts the timer, the rest are written together with it
+    if (!m_timer->isActive()) m_timer->start(write_delay);
+}
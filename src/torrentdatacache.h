@@ -0,0 +1,69 @@
+#ifndef __TORRENTDATACACHE_H__
+#define __TORRENTDATACACHE_H__
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
+
+#include "transport/resume_journal.h"
+
+class QTimer;
+
+/**
+ * process-wide copy of per-transfer data, one binary record per transfer in journal
+ * journal is read once, changed records are written back after short delay and on shutdown
+ * data of old versions is moved from resume settings on first run
+ * used by TorrentPersistentData and TorrentTempData, thread safe
+ */
+class TorrentDataCache : public QObject
+{
+    Q_OBJECT
+public:
+    enum Section
+    {
+        Persistent = 0, // "torrents"
+        Temp = 1        // "torrents-tmp"
+    };
+
+    static TorrentDataCache* instance();
+
+    /**
+      * write pending changes and destroy cache, next instance() call reads journal again
+     */
+    static void drop();
+
+    bool contains(Section s, const QString& hash) const;
+    QStringList hashes(Section s) const;
+    QVariant value(Section s, const QString& hash, const QString& key, const QVariant& def = QVariant()) const;
+    QHash<QString, QVariant> entry(Section s, const QString& hash) const;
+
+    void setValue(Section s, const QString& hash, const QString& key, const QVariant& value);
+    void removeValue(Section s, const QString& hash, const QString& key);
+    void removeEntry(Section s, const QString& hash);
+    void renameEntry(Section s, const QString& old_hash, const QString& new_hash);
+public slots:
+    /**
+      * write changed records to journal right now
+     */
+    void flush();
+private:
+    TorrentDataCache();
+    ~TorrentDataCache();
+    void touch(Section s, const QString& hash);
+    void migrate();
+    static const int write_delay = 5000; // ms
+
+    typedef QHash<QString, QHash<QString, QVariant> > Data;
+    Data            m_data[2];
+    QSet<QString>   m_dirty[2];     // changed or removed records
+    ResumeJournal   m_journal;
+    QTimer*         m_timer;
+    mutable QMutex  m_mutex;
+private slots:
+    void schedule();
+};
+
+#endif //__TORRENTDATACACHE_H__
@@ -40,127 +40,75 @@
 #include "misc.h"
 #include <vector>
 #include "qinisettings.h"
+#include "torrentdatacache.h"
 #include <QHash>
 
 class TorrentTempData {
 public:
   static bool hasTempData(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    return all_data.contains(hash);
+    return TorrentDataCache::instance()->contains(TorrentDataCache::Temp, hash);
   }
 
   static void deleteTempData(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    if (all_data.contains(hash)) {
-      all_data.remove(hash);
-      settings.setValue("torrents-tmp", all_data);
-    }
+    TorrentDataCache::instance()->removeEntry(TorrentDataCache::Temp, hash);
   }
 
   static void setFilesPriority(QString hash,  const std::vector<int> &pp) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
     std::vector<int>::const_iterator pp_it = pp.begin();
     QStringList pieces_priority;
     while(pp_it != pp.end()) {
       pieces_priority << QString::number(*pp_it);
       pp_it++;
     }
-    data["files_priority"] = pieces_priority;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "files_priority", pieces_priority);
   }
 
   static void setFilesPath(QString hash, const QStringList &path_list) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["files_path"] = path_list;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "files_path", path_list);
   }
 
   static void setSavePath(QString hash, QString save_path) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["save_path"] = save_path;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "save_path", save_path);
   }
 
   static void setLabel(QString hash, QString label) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
     qDebug("Saving label %s to tmp data", label.toLocal8Bit().data());
-    data["label"] = label;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "label", label);
   }
 
   static void setSequential(QString hash, bool sequential) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["sequential"] = sequential;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "sequential", sequential);
   }
 
   static bool isSequential(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("sequential", false).toBool();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "sequential", false).toBool();
   }
 
   static void setSeedingMode(QString hash,bool seed) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["seeding"] = seed;
-    all_data[hash] = data;
-    settings.setValue("torrents-tmp", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Temp, hash, "seeding", seed);
   }
 
   static bool isSeedingMode(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("seeding", false).toBool();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "seeding", false).toBool();
   }
 
   static QString getSavePath(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("save_path").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "save_path").toString();
   }
 
   static QStringList getFilesPath(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("files_path").toStringList();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "files_path").toStringList();
   }
 
   static QString getLabel(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    qDebug("Got label %s from tmp data", data.value("label", "").toString().toLocal8Bit().data());
-    return data.value("label", "").toString();
+    const QString label = TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "label", "").toString();
+    qDebug("Got label %s from tmp data", label.toLocal8Bit().data());
+    return label;
   }
 
   static void getFilesPriority(QString hash, std::vector<int> &fp) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents-tmp").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    const QList<int> list_var = misc::intListfromStringList(data.value("files_priority").toStringList());
+    const QList<int> list_var = misc::intListfromStringList(
+      TorrentDataCache::instance()->value(TorrentDataCache::Temp, hash, "files_priority").toStringList());
     foreach (const int &var, list_var) {
       fp.push_back(var);
     }
@@ -176,39 +124,25 @@ public:
 
 public:
   static bool isKnownTorrent(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    return all_data.contains(hash);
+    return TorrentDataCache::instance()->contains(TorrentDataCache::Persistent, hash);
   }
 
   static QStringList knownTorrents() {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    return all_data.keys();
+    return TorrentDataCache::instance()->hashes(TorrentDataCache::Persistent);
   }
 
   static void setRatioLimit(const QString &hash, qreal ratio) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["max_ratio"] = ratio;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "max_ratio", ratio);
   }
 
   static qreal getRatioLimit(const QString &hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("max_ratio", USE_GLOBAL_RATIO).toReal();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "max_ratio", USE_GLOBAL_RATIO).toReal();
   }
 
   static bool hasPerTorrentRatioLimit() {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant>::ConstIterator it;
-    for (it = all_data.constBegin(); it != all_data.constEnd(); it++) {
-      if (it.value().toHash().value("max_ratio", USE_GLOBAL_RATIO).toReal() >= 0) {
+    TorrentDataCache* cache = TorrentDataCache::instance();
+    foreach (const QString &hash, cache->hashes(TorrentDataCache::Persistent)) {
+      if (cache->value(TorrentDataCache::Persistent, hash, "max_ratio", USE_GLOBAL_RATIO).toReal() >= 0) {
         return true;
       }
     }
@@ -216,21 +150,14 @@ public:
   }
 
   static void setAddedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    if (!data.contains("add_date")) {
-      data["add_date"] = QDateTime::currentDateTime();
-      all_data[hash] = data;
-      settings.setValue("torrents", all_data);
+    TorrentDataCache* cache = TorrentDataCache::instance();
+    if (!cache->value(TorrentDataCache::Persistent, hash, "add_date").isValid()) {
+      cache->setValue(TorrentDataCache::Persistent, hash, "add_date", QDateTime::currentDateTime());
     }
   }
 
   static QDateTime getAddedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    QDateTime dt = data.value("add_date").toDateTime();
+    QDateTime dt = TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "add_date").toDateTime();
     if (!dt.isValid()) {
       setAddedDate(hash);
       dt = QDateTime::currentDateTime();
@@ -239,111 +166,70 @@ public:
   }
 
   static void setErrorState(QString hash, bool has_error) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["has_error"] = has_error;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "has_error", has_error);
   }
 
   static bool hasError(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("has_error", false).toBool();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "has_error", false).toBool();
   }
 
   static void setRootFolder(QString hash, QString root_folder) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["root_folder"] = root_folder;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "root_folder", root_folder);
   }
 
   static QString getRootFolder(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("root_folder").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "root_folder").toString();
   }
 
   static void setPreviousSavePath(QString hash, QString previous_path) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["previous_path"] = previous_path;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "previous_path", previous_path);
   }
 
   static QString getPreviousPath(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("previous_path").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "previous_path").toString();
   }
-  
+
   static void saveSeedDate(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
     if (h.is_seed())
-      data["seed_date"] = QDateTime::currentDateTime();
+      TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, h.hash(), "seed_date", QDateTime::currentDateTime());
     else
-      data.remove("seed_date");
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
+      TorrentDataCache::instance()->removeValue(TorrentDataCache::Persistent, h.hash(), "seed_date");
   }
 
   static QDateTime getSeedDate(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("seed_date").toDateTime();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "seed_date").toDateTime();
   }
 
   static void deletePersistentData(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    if (all_data.contains(hash)) {
-      all_data.remove(hash);
-      settings.setValue("torrents", all_data);
-    }
+    TorrentDataCache::instance()->removeEntry(TorrentDataCache::Persistent, hash);
   }
 
   static void saveTorrentPersistentData(const QTorrentHandle &h, QString save_path = QString::null, bool is_magnet = false) {
     Q_ASSERT(h.is_valid());
     qDebug("Saving persistent data for %s", qPrintable(h.hash()));
     // Save persistent data
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(h.hash()).toHash();
-    data["is_magnet"] = is_magnet;
+    TorrentDataCache* cache = TorrentDataCache::instance();
+    const QString hash = h.hash();
+    cache->setValue(TorrentDataCache::Persistent, hash, "is_magnet", is_magnet);
     if (is_magnet) {
-      data["magnet_uri"] = misc::toQString(make_magnet_uri(h));
+      cache->setValue(TorrentDataCache::Persistent, hash, "magnet_uri", misc::toQString(make_magnet_uri(h)));
     }
-    data["seed"] = h.is_seed();
-    data["priority"] = h.queue_position();
+    cache->setValue(TorrentDataCache::Persistent, hash, "seed", h.is_seed());
+    cache->setValue(TorrentDataCache::Persistent, hash, "priority", h.queue_position());
     if (save_path.isEmpty()) {
       qDebug("TorrentPersistantData: save path is %s", qPrintable(h.save_path()));
-      data["save_path"] = h.save_path();
+      cache->setValue(TorrentDataCache::Persistent, hash, "save_path", h.save_path());
     } else {
       qDebug("TorrentPersistantData: overriding save path is %s", qPrintable(save_path));
-      data["save_path"] = save_path; // Override torrent save path (e.g. because it is a temp dir)
+      cache->setValue(TorrentDataCache::Persistent, hash, "save_path", save_path); // Override torrent save path (e.g. because it is a temp dir)
     }
     // Label
-    data["label"] = TorrentTempData::getLabel(h.hash());
-    // Save data
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
-    qDebug("TorrentPersistentData: Saving save_path %s, hash: %s", qPrintable(h.save_path()), qPrintable(h.hash()));
+    cache->setValue(TorrentDataCache::Persistent, hash, "label", TorrentTempData::getLabel(hash));
+    qDebug("TorrentPersistentData: Saving save_path %s, hash: %s", qPrintable(h.save_path()), qPrintable(hash));
     // Set Added date
-    setAddedDate(h.hash());
+    setAddedDate(hash);
     // Finally, remove temp data
-    TorrentTempData::deleteTempData(h.hash());
+    TorrentTempData::deleteTempData(hash);
   }
 
   // Setters
@@ -351,53 +237,29 @@ public:
   static void saveSavePath(QString hash, QString save_path) {
     Q_ASSERT(!hash.isEmpty());
     qDebug("TorrentPersistentData::saveSavePath(%s)", qPrintable(save_path));
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["save_path"] = save_path;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "save_path", save_path);
     qDebug("TorrentPersistentData: Saving save_path: %s, hash: %s", qPrintable(save_path), qPrintable(hash));
   }
 
   static void saveLabel(QString hash, QString label) {
     Q_ASSERT(!hash.isEmpty());
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["label"] = label;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "label", label);
   }
 
   static void saveName(QString hash, QString name) {
     Q_ASSERT(!hash.isEmpty());
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    data["name"] = name;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "name", name);
   }
 
   static void savePriority(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
-    data["priority"] = h.queue_position();
-    all_data[h.hash()] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, h.hash(), "priority", h.queue_position());
   }
 
   static void saveSeedStatus(const QTorrentHandle &h) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[h.hash()].toHash();
-    bool was_seed = data.value("seed", false).toBool();
+    TorrentDataCache* cache = TorrentDataCache::instance();
+    bool was_seed = cache->value(TorrentDataCache::Persistent, h.hash(), "seed", false).toBool();
     if (was_seed != h.is_seed()) {
-      data["seed"] = !was_seed;
-      all_data[h.hash()] = data;
-      settings.setValue("torrents", all_data);
+      cache->setValue(TorrentDataCache::Persistent, h.hash(), "seed", !was_seed);
       if (!was_seed) {
         // Save completion date
         saveSeedDate(h);
@@ -406,73 +268,43 @@ public:
   }
 
   static void saveHash(const QString& oldHash, const QString& newHash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[oldHash].toHash();
-    all_data.remove(oldHash);
-    all_data[newHash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->renameEntry(TorrentDataCache::Persistent, oldHash, newHash);
   }
 
   static void saveMagnet(const QString& hash, bool isMagnet) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    QHash<QString, QVariant> data = all_data[hash].toHash();
-    data["is_magnet"] = isMagnet;
-    all_data[hash] = data;
-    settings.setValue("torrents", all_data);
+    TorrentDataCache::instance()->setValue(TorrentDataCache::Persistent, hash, "is_magnet", isMagnet);
   }
 
   // Getters
   static QString getSavePath(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
     //qDebug("TorrentPersistentData: getSavePath %s", data["save_path"].toString().toLocal8Bit().data());
-    return data.value("save_path").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "save_path").toString();
   }
 
   static QString getLabel(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("label", "").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "label", "").toString();
   }
 
   static QString getName(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("name", "").toString();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "name", "").toString();
   }
 
   static int getPriority(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("priority", -1).toInt();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "priority", -1).toInt();
   }
 
   static bool isSeed(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("seed", false).toBool();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "seed", false).toBool();
   }
 
   static bool isMagnet(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    return data.value("is_magnet", false).toBool();
+    return TorrentDataCache::instance()->value(TorrentDataCache::Persistent, hash, "is_magnet", false).toBool();
   }
 
   static QString getMagnetUri(QString hash) {
-    QIniSettings settings(QString::fromUtf8(COMPANY_NAME), QString::fromUtf8(PRODUCT_NAME "-resume"));
-    const QHash<QString, QVariant> all_data = settings.value("torrents").toHash();
-    const QHash<QString, QVariant> data = all_data.value(hash).toHash();
-    Q_ASSERT(data.value("is_magnet", false).toBool());
-    return data.value("magnet_uri").toString();
+    TorrentDataCache* cache = TorrentDataCache::instance();
+    Q_ASSERT(cache->value(TorrentDataCache::Persistent, hash, "is_magnet", false).toBool());
+    return cache->value(TorrentDataCache::Persistent, hash, "magnet_uri").toString();
   }
 
 };
@@ -0,0 +1,252 @@
+#ifndef __ALERT_DISPATCHER_H__
+#define __ALERT_DISPATCHER_H__
+
+#include <deque>
+#include <memory>
+#include <typeinfo>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QTime>
+#include <QtAlgorithms>
+
+const int ALERTS_BATCH_SIZE = 64;   // alerts dispatched between clock checks
+const int ALERTS_TIME_LIMIT = 100;  // milliseconds per alerts reading tick
+
+/**
+ * routes session alerts to handlers registered by exact alert type
+ * lookup is one hash access per alert instead of dynamic_cast chain
+ */
+template<typename AlertBase>
+class AlertDispatcher
+{
+public:
+    typedef boost::function<void (AlertBase*)> Handler;
+
+    /**
+      * register handler for alert type, derived alert types need own handlers
+     */
+    template<typename AlertType>
+    void add(const char* name, const boost::function<void (AlertType*)>& handler)
+    {
+        Slot slot;
+        slot.name = QString::fromLatin1(name);
+        slot.handler = boost::bind(&AlertDispatcher::template invoke<AlertType>, handler, _1);
+        slot.count = 0;
+        m_slots.push_back(slot);
+        m_by_name.insert(QByteArray(typeid(AlertType).name()), m_slots.size() - 1);
+        m_by_id.clear();
+    }
+
+    /**
+      * returns false when alert has no handler
+     */
+    bool dispatch(AlertBase* a)
+    {
+        const char* id = typeid(*a).name();
+        const int index = lookup(id);
+
+        if (index < 0)
+        {
+            ++m_unhandled[id];
+            return false;
+        }
+
+        call(index, a);
+        return true;
+    }
+
+    /**
+      * dispatch only when handler registered, misses are not counted
+     */
+    bool tryDispatch(AlertBase* a)
+    {
+        const int index = lookup(typeid(*a).name());
+        if (index < 0) return false;
+        call(index, a);
+        return true;
+    }
+
+    /**
+      * dispatch and delete alerts from queue head until queue is empty or time limit exceeded
+      * clock checked only between batches, rest of queue will be processed on next call
+      * negative time limit drains whole queue - used on shutdown
+      * returns true when queue was drained completely
+     */
+    bool drain(std::deque<AlertBase*>& alerts, int time_limit = ALERTS_TIME_LIMIT)
+    {
+        QTime timer;
+        timer.start();
+        int batch = 0;
+
+        while (!alerts.empty())
+        {
+            std::auto_ptr<AlertBase> a(alerts.front());
+            alerts.pop_front();
+            dispatch(a.get());
+
+            if (++batch == ALERTS_BATCH_SIZE)
+            {
+                batch = 0;
+                if (time_limit >= 0 && timer.elapsed() >= time_limit) return alerts.empty();
+            }
+        }
+
+        return true;
+    }
+
+    /**
+      * dispatched alerts count by type name, unhandled types reported by type_info name
+     */
+    QHash<QString, quint64> counters() const
+    {
+        QHash<QString, quint64> res;
+
+        for (typename std::vector<Slot>::const_iterator itr = m_slots.begin(); itr != m_slots.end(); ++itr)
+        {
+            if (itr->count) res[itr->name] += itr->count;
+        }
+
+        for (QHash<const char*, quint64>::const_iterator itr = m_unhandled.constBegin(); itr != m_unhandled.constEnd(); ++itr)
+        {
+            res[QString::fromLatin1(itr.key())] += itr.value();
+        }
+
+        return res;
+    }
+
+private:
+    int lookup(const char* id)
+    {
+        QHash<const char*, int>::const_iterator itr = m_by_id.constFind(id);
+        if (itr != m_by_id.constEnd()) return itr.value();
+
+        // type_info names are not guaranteed to be unique across shared libraries - resolve by string once
+        const int index = m_by_name.value(QByteArray(id), -1);
+        m_by_id.insert(id, index);
+        return index;
+    }
+
+    void call(int index, AlertBase* a)
+    {
+        Slot& slot = m_slots[index];
+        ++slot.count;
+        slot.handler(a);
+    }
+
+    struct Slot
+    {
+        QString name;
+        Handler handler;
+        quint64 count;
+    };
+
+    template<typename AlertType>
+    static void invoke(const boost::function<void (AlertType*)>& handler, AlertBase* a)
+    {
+        handler(static_cast<AlertType*>(a));
+    }
+
+    std::vector<Slot>           m_slots;
+    QHash<QByteArray, int>      m_by_name;      // type_info name -> slot
+    QHash<const char*, int>     m_by_id;        // type_info name pointer cache -> slot or -1
+    QHash<const char*, quint64> m_unhandled;
+};
+
+/**
+ * lock-free queue of alert batches, any thread publishes, one thread takes
+ * published batch is never touched by producer again
+ */
+template<typename AlertBase>
+class AlertQueue
+{
+public:
+    AlertQueue() : m_head(0) {}
+
+    ~AlertQueue()
+    {
+        std::deque<AlertBase*> rest;
+        take(rest);
+        qDeleteAll(rest.begin(), rest.end());
+    }
+
+    /**
+      * pop all alerts from session, run worker handlers on them and publish the rest as one batch
+      * returns true when batch was published
+     */
+    template<typename Session>
+    bool pump(Session* session, AlertDispatcher<AlertBase>& worker_handlers)
+    {
+        std::vector<AlertBase*> batch;
+        std::auto_ptr<AlertBase> a = session->pop_alert();
+
+        while (a.get())
+        {
+            if (!worker_handlers.tryDispatch(a.get()))
+                batch.push_back(a.release());
+
+            a = session->pop_alert();
+        }
+
+        if (batch.empty()) return false;
+        push(batch);
+        return true;
+    }
+
+    void push(std::vector<AlertBase*>& batch)
+    {
+        Node* node = new Node;
+        node->batch.swap(batch);
+        Node* head;
+
+        do
+        {
+            head = m_head;
+            node->next = head;
+        }
+        while (!m_head.testAndSetRelease(head, node));
+    }
+
+    /**
+      * append all published alerts to out in publishing order
+     */
+    void take(std::deque<AlertBase*>& out)
+    {
+        Node* node = m_head.fetchAndStoreAcquire(0);
+        Node* prev = 0;
+
+        // stack holds newest batch first
+        while (node)
+        {
+            Node* next = node->next;
+            node->next = prev;
+            prev = node;
+            node = next;
+        }
+
+        while (prev)
+        {
+            out.insert(out.end(), prev->batch.begin(), prev->batch.end());
+            Node* next = prev->next;
+            delete prev;
+            prev = next;
+        }
+    }
+
+private:
+    struct Node
+    {
+        std::vector<AlertBase*> batch;
+        Node* next;
+    };
+
+    QAtomicPointer<Node> m_head;
+};
+
+#endif //__ALERT_DISPATCHER_H__
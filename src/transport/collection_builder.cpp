@@ -0,0 +1,292 @@
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QTime>
+#include <QTimer>
+
+#include <libed2k/file.hpp>
+
+#include "collection_builder.h"
+#include "session.h"
+#include "misc.h"
+
+const int COLLECTIONS_TIME_SLICE = 50;  // milliseconds of GUI thread per processing step
+
+class CollectionBuilder::Worker : public QRunnable
+{
+public:
+    Worker(CollectionBuilder* builder, Job* job) : m_builder(builder), m_job(job) {}
+
+    void run()
+    {
+        QFile data(m_job->filepath);
+
+        if (data.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            QTextStream out(&data);
+
+            foreach(const QString& line, m_job->lines)
+            {
+                out << line << "\n";
+            }
+
+            data.close();
+            bool cancel = false;
+            m_job->result = libed2k::file2atp()(m_job->filepath.toUtf8().constData(), cancel);
+        }
+        else
+        {
+            m_job->result.second = libed2k::errors::make_error_code(libed2k::errors::file_unavaliable);
+        }
+
+        m_builder->finished(m_job);
+    }
+private:
+    CollectionBuilder*  m_builder;
+    Job*                m_job;
+};
+
+CollectionBuilder::CollectionBuilder(QObject* parent /* = 0*/) : QObject(parent)
+{
+    // collections are small, one thread keeps them off GUI and out of shared files hashing queue
+    m_pool.setMaxThreadCount(1);
+}
+
+CollectionBuilder::~CollectionBuilder()
+{
+    cancel();
+}
+
+void CollectionBuilder::markDirty(const DirNode* dir)
+{
+    m_dirty.insert(dir->filepath());
+}
+
+void CollectionBuilder::forget(const DirNode* dir)
+{
+    const QString path = dir->filepath();
+    m_dirty.remove(path);
+    m_built.remove(path);
+    m_running.remove(path);     // result will be dropped
+}
+
+void CollectionBuilder::cancel()
+{
+    m_dirty.clear();
+    m_running.clear();
+    m_pool.waitForDone();
+    deliver();
+}
+
+void CollectionBuilder::process()
+{
+    QMultiMap<int, DirNode*> queue;
+
+    foreach(const QString& path, m_dirty)
+    {
+        DirNode* dir = dynamic_cast<DirNode*>(Session::instance()->findNode(path));
+        if (dir && dir->is_active()) queue.insert(dir->files().size(), dir);
+    }
+
+    m_dirty.clear();
+    QTime timer;
+    timer.start();
+
+    for (QMultiMap<int, DirNode*>::const_iterator itr = queue.constBegin(); itr != queue.constEnd(); ++itr)
+    {
+        if (timer.elapsed() >= COLLECTIONS_TIME_SLICE)
+        {
+            // continue on next event loop iteration
+            for (; itr != queue.constEnd(); ++itr) markDirty(itr.value());
+            QTimer::singleShot(0, this, SLOT(process()));
+            break;
+        }
+
+        build(itr.value());
+    }
+}
+
+bool CollectionBuilder::build(DirNode* dir)
+{
+    QStringList lines;
+
+    foreach(const FileNode* p, dir->files())
+    {
+        if (!p->is_active()) continue;
+
+        // file will mark directory dirty again when its transfer is created
+        if (!p->has_transfer()) return false;
+
+        QString line = p->string();
+        Q_ASSERT(!line.isEmpty());
+        lines << line;
+    }
+
+    const QString path = dir->filepath();
+
+    if (lines.isEmpty())
+    {
+        // all files were excluded - old collection is obsolete
+        dir->deleteTransfer();
+        m_built.remove(path);
+        m_running.remove(path);
+        return true;
+    }
+
+    lines.sort();
+    const QString name = dir->collection_name();
+    const QByteArray digest = CollectionBuilder::digest(name, lines);
+
+    if (dir->has_transfer() && !m_built.contains(path))
+    {
+        const QByteArray stored = storedDigest(dir);
+        if (!stored.isEmpty()) m_built.insert(path, stored);
+    }
+
+    if (dir->has_transfer() && m_built.value(path) == digest) return true;
+    if (m_running.value(path) == digest) return true;
+
+    qDebug() << "collection " << name << " changed, rebuild " << lines.size() << " files";
+    Job* job = new Job;
+    job->dirpath = path;
+    job->filepath = collectionPath(dir, lines.size());
+    job->lines = lines;
+    job->digest = digest;
+    m_running.insert(path, digest);
+    m_reserved.insert(job->filepath);
+    m_pool.start(new Worker(this, job));
+    return true;
+}
+
+QString CollectionBuilder::collectionPath(const DirNode* dir, int lines)
+{
+    QDir cd(misc::ED2KCollectionLocation());
+    int iteration = 0;
+
+    for (;;)
+    {
+        QString filename = dir->collection_name() + (iteration?(QString("_") + QString::number(iteration)):QString()) + QString("-") + QString::number(lines) + QString(".emulecollection");
+        QFileInfo fi(cd.filePath(filename));
+
+        if (!fi.exists() && !m_reserved.contains(fi.absoluteFilePath()))
+            return fi.absoluteFilePath();
+
+        ++iteration;
+    }
+}
+
+QByteArray CollectionBuilder::storedDigest(const DirNode* dir) const
+{
+    const Transfer t = Session::instance()->getTransfer(dir->hash());
+    if (!t.is_valid()) return QByteArray();
+
+    const QString filepath = t.absolute_files_path().value(0);
+    const QString name = dir->collection_name();
+    const QString filename = QFileInfo(filepath).fileName();
+
+    // collection name is part of file name only, renamed directory needs new file
+    if (!filename.startsWith(name + QString("-")) && !filename.startsWith(name + QString("_")))
+        return QByteArray();
+
+    QFile data(filepath);
+    if (!data.open(QFile::ReadOnly)) return QByteArray();
+
+    QStringList lines;
+    QTextStream in(&data);
+
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine();
+        if (!line.isEmpty()) lines << line;
+    }
+
+    // files are written sorted, sorting again keeps digest stable for hand edited collections
+    lines.sort();
+    return digest(name, lines);
+}
+
+QByteArray CollectionBuilder::digest(const QString& name, const QStringList& lines)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(name.toUtf8());
+    foreach(const QString& line, lines) hash.addData(line.toUtf8());
+    return hash.result();
+}
+
+void CollectionBuilder::finished(Job* job)
+{
+    QMutexLocker locker(&m_mutex);
+    m_results.push_back(job);
+    if (m_results.size() == 1) QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+}
+
+void CollectionBuilder::deliver()
+{
+    std::deque<Job*> results;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_results);
+    }
+
+    for (std::deque<Job*>::iterator itr = results.begin(); itr != results.end(); ++itr)
+    {
+        QScopedPointer<Job> job(*itr);
+        m_reserved.remove(job->filepath);
+        DirNode* dir = NULL;
+
+        // directory was changed, unshared or deleted while collection was hashing
+        if (m_running.contains(job->dirpath) && m_running.value(job->dirpath) == job->digest)
+        {
+            m_running.remove(job->dirpath);
+            dir = dynamic_cast<DirNode*>(Session::instance()->findNode(job->dirpath));
+        }
+
+        if (!dir || !dir->is_active())
+        {
+            QFile::remove(job->filepath);
+            continue;
+        }
+
+        if (job->result.second)
+        {
+            qDebug() << "collection " << job->filepath << " hashing failed " << job->result.second.message().c_str();
+            dir->m_error = job->result.second;
+            QFile::remove(job->filepath);
+            continue;
+        }
+
+        // only name of collection was changed, content and transfer are the same
+        if (dir->has_transfer() && dir->m_hash == job->result.first.file_hash)
+        {
+            QFile::remove(job->filepath);
+            m_built.insert(job->dirpath, job->digest);
+            continue;
+        }
+
+        dir->deleteTransfer();
+
+        try
+        {
+            job->result.first.duplicate_is_error = true;
+            dir->set_hash(Session::instance()->get_ed2k_session()->addTransfer(job->result.first).hash());
+            dir->m_error = libed2k::errors::no_error;
+            m_built.insert(job->dirpath, job->digest);
+        }
+        catch(const libed2k::libed2k_exception& e)
+        {
+            dir->m_error = e.error();
+            QFile::remove(job->filepath);
+        }
+
+        Session::instance()->signal_changeNode(dir);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef __COLLECTION_BUILDER_H__
+#define __COLLECTION_BUILDER_H__
+
+#include <deque>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <libed2k/add_transfer_params.hpp>
+#include <libed2k/error_code.hpp>
+
+class DirNode;
+
+/**
+ * builds emule collections of shared directories
+ * collection content is generated from hashes kept by file nodes, file is written and hashed on worker thread
+ * dirty directories are processed smallest first, directory with unchanged collection content isn't rebuilt
+ */
+class CollectionBuilder : public QObject
+{
+    Q_OBJECT
+public:
+    CollectionBuilder(QObject* parent = 0);
+    ~CollectionBuilder();
+
+    /**
+      * directory files or name were changed, collection will be checked on next processing
+     */
+    void markDirty(const DirNode* dir);
+
+    /**
+      * directory was unshared or deleted, drop its queued and running builds
+     */
+    void forget(const DirNode* dir);
+
+    /**
+      * drop all queued builds and wait running ones
+     */
+    void cancel();
+public slots:
+    void process();
+private slots:
+    void deliver();
+private:
+    struct Job
+    {
+        QString     dirpath;
+        QString     filepath;
+        QStringList lines;
+        QByteArray  digest;
+        std::pair<libed2k::add_transfer_params, libed2k::error_code> result;
+    };
+
+    class Worker;
+    friend class Worker;
+
+    /**
+      * returns false when directory has files without hashes yet
+     */
+    bool build(DirNode* dir);
+    QString collectionPath(const DirNode* dir, int lines);
+
+    /**
+      * digest of collection file directory already has, empty when it can't be read
+      * digests aren't stored, after restart they are restored from collection files
+     */
+    QByteArray storedDigest(const DirNode* dir) const;
+    static QByteArray digest(const QString& name, const QStringList& lines);
+    void finished(Job* job);
+
+    QSet<QString>               m_dirty;    // directory paths
+    QHash<QString, QByteArray>  m_built;    // directory path -> digest of its current collection
+    QHash<QString, QByteArray>  m_running;  // directory path -> digest of collection being hashed
+    QSet<QString>               m_reserved; // collection files of running builds
+    QThreadPool                 m_pool;
+    QMutex                      m_mutex;
+    std::deque<Job*>            m_results;
+};
+
+#endif //__COLLECTION_BUILDER_H__
@@ -0,0 +1,162 @@
+#include <QDebug>
+#include <QFile>
+
+#include "dir_watcher.h"
+
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+#include <QVarLengthArray>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+const uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+DirWatcher::DirWatcher(QObject* parent /* = 0*/) : QObject(parent), m_notifier(NULL)
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_fd < 0)
+    {
+        qDebug() << "inotify isn't available, errno " << errno;
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+}
+
+DirWatcher::~DirWatcher()
+{
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+void DirWatcher::watch(const QString& dirpath)
+{
+    if (m_fd < 0 || m_watches.contains(dirpath)) return;
+
+    const int wd = inotify_add_watch(m_fd, QFile::encodeName(dirpath).constData(), WATCH_MASK);
+
+    if (wd < 0)
+    {
+        // most likely max_user_watches limit, directory will be checked by periodic rescan only
+        qDebug() << "unable to watch " << dirpath << " errno " << errno;
+        return;
+    }
+
+    m_paths.insert(wd, dirpath);
+    m_watches.insert(dirpath, wd);
+}
+
+void DirWatcher::unwatch(const QString& dirpath)
+{
+    QHash<QString, int>::iterator itr = m_watches.find(dirpath);
+    if (itr == m_watches.end()) return;
+
+    inotify_rm_watch(m_fd, itr.value());
+    m_paths.remove(itr.value());
+    m_watches.erase(itr);
+}
+
+bool DirWatcher::watched(const QString& dirpath) const
+{
+    return m_watches.contains(dirpath);
+}
+
+void DirWatcher::readEvents()
+{
+    QVarLengthArray<char, 4096> buffer(4096);
+
+    for (;;)
+    {
+        const ssize_t size = ::read(m_fd, buffer.data(), buffer.size());
+
+        if (size < 0)
+        {
+            if (errno == EINVAL)
+            {
+                // event name doesn't fit buffer
+                buffer.resize(buffer.size() * 2);
+                continue;
+            }
+
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < size; )
+        {
+            const inotify_event* e = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += sizeof(inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW)
+            {
+                qDebug() << "inotify queue overflow, rescan all watched directories";
+                emit rescanRequired(QString());
+                continue;
+            }
+
+            QHash<int, QString>::iterator itr = m_paths.find(e->wd);
+            if (itr == m_paths.end()) continue;
+
+            const QString dirpath = itr.value();
+
+            if (e->mask & IN_IGNORED)
+            {
+                // directory itself was removed, parent directory reports it
+                m_watches.remove(dirpath);
+                m_paths.erase(itr);
+                continue;
+            }
+
+            if (!e->len) continue;
+            const QString name = QFile::decodeName(e->name);
+
+            // files are reported when they are written completely, creation of directory is enough
+            if ((e->mask & IN_MOVED_TO) || (e->mask & IN_CLOSE_WRITE) ||
+                ((e->mask & IN_CREATE) && (e->mask & IN_ISDIR)))
+            {
+                emit entryAdded(dirpath, name);
+            }
+            else if ((e->mask & IN_DELETE) || (e->mask & IN_MOVED_FROM))
+            {
+                emit entryRemoved(dirpath, name);
+            }
+        }
+    }
+}
+
+#else
+
+#include <QFileSystemWatcher>
+
+DirWatcher::DirWatcher(QObject* parent /* = 0*/) : QObject(parent)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, SIGNAL(directoryChanged(const QString&)), this, SIGNAL(rescanRequired(const QString&)));
+}
+
+DirWatcher::~DirWatcher()
+{
+}
+
+void DirWatcher::watch(const QString& dirpath)
+{
+    if (!watched(dirpath)) m_watcher->addPath(dirpath);
+}
+
+void DirWatcher::unwatch(const QString& dirpath)
+{
+    m_watcher->removePath(dirpath);
+}
+
+bool DirWatcher::watched(const QString& dirpath) const
+{
+    return m_watcher->directories().contains(dirpath);
+}
+
+void DirWatcher::readEvents()
+{
+    // events come through QFileSystemWatcher
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __DIR_WATCHER_H__
+#define __DIR_WATCHER_H__
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+/**
+ * reports changes of entries in watched directories, not recursive
+ * inotify is used on Linux, other systems report changed directory and it must be re-scanned
+ */
+class DirWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    DirWatcher(QObject* parent = 0);
+    ~DirWatcher();
+
+    void watch(const QString& dirpath);
+    void unwatch(const QString& dirpath);
+    bool watched(const QString& dirpath) const;
+signals:
+    /**
+      * new directory was created or file was completely written or entry was moved in
+     */
+    void entryAdded(const QString& dirpath, const QString& name);
+
+    /**
+      * entry was deleted or moved out
+     */
+    void entryRemoved(const QString& dirpath, const QString& name);
+
+    /**
+      * changes of directory are unknown, empty path means all watched directories
+     */
+    void rescanRequired(const QString& dirpath);
+private slots:
+    void readEvents();
+private:
+#ifdef Q_OS_LINUX
+    int                     m_fd;
+    QSocketNotifier*        m_notifier;
+    QHash<int, QString>     m_paths;    // watch descriptor -> directory
+    QHash<QString, int>     m_watches;
+#else
+    QFileSystemWatcher*     m_watcher;
+#endif
+};
+
+#endif //__DIR_WATCHER_H__
@@ -0,0 +1,188 @@
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "fs_snapshot.h"
+#include "session_filesystem.h"
+
+namespace
+{
+    const quint32 snapshot_magic = 0x514D5353;  // QMSS
+    const quint32 snapshot_version = 1;
+
+    enum RecordTag
+    {
+        RT_END = 0,
+        RT_DIRECTORY = 1
+    };
+
+    enum FileFlags
+    {
+        FF_EXCLUDED = 0x01,
+        FF_HASH     = 0x02
+    };
+
+    const int hash_size = 16;
+}
+
+bool SnapshotWriter::open(const QString& filepath)
+{
+    m_path = filepath;
+    m_file.setFileName(filepath + ".tmp");
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "unable to create shared filesystem snapshot " << m_file.fileName();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_4_6);
+    m_stream << snapshot_magic << snapshot_version;
+    return true;
+}
+
+void SnapshotWriter::add(const DirNode* dir)
+{
+    QStringList dirs;
+
+    foreach(const DirNode* p, dir->m_dir_vector)
+    {
+        dirs << p->filename();
+    }
+
+    m_stream << quint8(RT_DIRECTORY) << dir->filepath() << dirs << quint32(dir->files().size());
+
+    foreach(const FileNode* p, dir->files())
+    {
+        // stat data is written as node knows it, snapshot never touches disk
+        quint8 flags = 0;
+        if (!p->is_active()) flags |= FF_EXCLUDED;
+        if (p->has_transfer()) flags |= FF_HASH;
+
+        m_stream << p->filename() << qint64(p->m_size) << quint32(p->m_mtime) << flags;
+
+        if (flags & FF_HASH)
+        {
+            const QByteArray hash = QByteArray::fromHex(p->hash().toLatin1());
+            Q_ASSERT(hash.size() == hash_size);
+            m_stream.writeRawData(hash.constData(), hash_size);
+        }
+    }
+}
+
+bool SnapshotWriter::commit()
+{
+    m_stream << quint8(RT_END);
+    bool ok = (m_stream.status() == QDataStream::Ok) && m_file.flush();
+#ifdef Q_OS_WIN
+    ok = ok && (_commit(m_file.handle()) == 0);
+#else
+    ok = ok && (fsync(m_file.handle()) == 0);
+#endif
+    m_file.close();
+
+    // QFile::rename doesn't overwrite, reader falls back to temporary file when we stop between these calls
+    if (!ok || (QFile::exists(m_path) && !QFile::remove(m_path)) || !QFile::rename(m_file.fileName(), m_path))
+    {
+        qDebug() << "unable to write shared filesystem snapshot " << m_path;
+        QFile::remove(m_file.fileName());
+        return false;
+    }
+
+    return true;
+}
+
+SnapshotReader::SnapshotReader() : m_data(NULL), m_completed(false)
+{
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    m_stream.setDevice(NULL);
+    m_buffer.close();
+    if (m_data) m_file.unmap(m_data);
+}
+
+bool SnapshotReader::open(const QString& filepath)
+{
+    m_file.setFileName(filepath);
+
+    // writer was interrupted after old snapshot removal
+    if (!m_file.exists() && QFile::exists(filepath + ".tmp"))
+        QFile::rename(filepath + ".tmp", filepath);
+
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() == 0) return false;
+
+    m_data = m_file.map(0, m_file.size());
+
+    if (m_data)
+    {
+        m_raw = QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), m_file.size());
+    }
+    else
+    {
+        qDebug() << "unable to map shared filesystem snapshot, read it";
+        m_raw = m_file.readAll();
+    }
+
+    m_buffer.setBuffer(&m_raw);
+    m_buffer.open(QIODevice::ReadOnly);
+    m_stream.setDevice(&m_buffer);
+    m_stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    m_stream >> magic >> version;
+
+    if (magic != snapshot_magic || version != snapshot_version)
+    {
+        qDebug() << "shared filesystem snapshot has unknown format " << magic << " version " << version;
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotReader::next(SnapshotDir& dir)
+{
+    quint8 tag = RT_END;
+    m_stream >> tag;
+
+    if (m_stream.status() != QDataStream::Ok || tag != RT_DIRECTORY)
+    {
+        m_completed = (m_stream.status() == QDataStream::Ok && tag == RT_END);
+        return false;
+    }
+
+    quint32 count = 0;
+    m_stream >> dir.path >> dir.dirs >> count;
+
+    // damaged count must not allocate huge vector
+    if (m_stream.status() != QDataStream::Ok || count > quint32(m_raw.size())) return false;
+
+    dir.files.resize(count);
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        SnapshotDir::File& f = dir.files[i];
+        quint32 mtime = 0;
+        quint8 flags = 0;
+        m_stream >> f.name >> f.size >> mtime >> flags;
+        f.mtime = mtime;
+        f.excluded = (flags & FF_EXCLUDED);
+        f.hash.clear();
+
+        if (flags & FF_HASH)
+        {
+            f.hash.resize(hash_size);
+            if (m_stream.readRawData(f.hash.data(), hash_size) != hash_size) return false;
+        }
+    }
+
+    return (m_stream.status() == QDataStream::Ok);
+}
@@ -0,0 +1,85 @@
+#ifndef __FS_SNAPSHOT_H__
+#define __FS_SNAPSHOT_H__
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class DirNode;
+
+/**
+ * shared directory as it was stored in snapshot
+ */
+struct SnapshotDir
+{
+    struct File
+    {
+        QString     name;
+        qint64      size;       // -1 when it wasn't known
+        uint        mtime;
+        bool        excluded;   // unshared by user
+        QByteArray  hash;       // binary md4, empty when file has no transfer
+    };
+
+    QString         path;
+    QStringList     dirs;       // subdirectories names
+    QVector<File>   files;
+};
+
+/**
+ * writes shared directories to temporary file and replaces snapshot on commit
+ */
+class SnapshotWriter
+{
+public:
+    bool open(const QString& filepath);
+    void add(const DirNode* dir);
+
+    /**
+      * sync data and atomically replace previous snapshot
+     */
+    bool commit();
+private:
+    QString     m_path;
+    QFile       m_file;
+    QDataStream m_stream;
+};
+
+/**
+ * reads snapshot from memory mapped file directory by directory
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    /**
+      * returns false when snapshot doesn't exist or has unknown format
+     */
+    bool open(const QString& filepath);
+
+    /**
+      * returns false on end of snapshot or when record is damaged
+     */
+    bool next(SnapshotDir& dir);
+
+    /**
+      * all records were read and end marker was found
+     */
+    bool completed() const { return m_completed; }
+private:
+    QFile       m_file;
+    uchar*      m_data;
+    QByteArray  m_raw;      // refers to mapped data
+    QBuffer     m_buffer;
+    QDataStream m_stream;
+    bool        m_completed;
+};
+
+#endif //__FS_SNAPSHOT_H__
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <QMutexLocker>
+
+#include "node_arena.h"
+
+const size_t ARENA_CHUNK_BLOCKS = 4096;
+
+NodeArena::NodeArena(size_t block_size) :
+    m_block(std::max(block_size, sizeof(void*))),
+    m_cursor(NULL),
+    m_end(NULL),
+    m_free(NULL),
+    m_live(0)
+{
+    // keep blocks pointer aligned
+    m_block = (m_block + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+}
+
+void* NodeArena::allocate()
+{
+    QMutexLocker locker(&m_mutex);
+    void* p;
+
+    if (m_free)
+    {
+        p = m_free;
+        m_free = *static_cast<void**>(m_free);
+    }
+    else
+    {
+        if (m_cursor == m_end)
+        {
+            m_chunks.push_back(new char[m_block * ARENA_CHUNK_BLOCKS]);
+            m_cursor = m_chunks.back();
+            m_end = m_cursor + m_block * ARENA_CHUNK_BLOCKS;
+        }
+
+        p = m_cursor;
+        m_cursor += m_block;
+    }
+
+    ++m_live;
+    return p;
+}
+
+void NodeArena::release(void* p)
+{
+    if (!p) return;
+    QMutexLocker locker(&m_mutex);
+    *static_cast<void**>(p) = m_free;
+    m_free = p;
+    --m_live;
+}
+
+size_t NodeArena::reserved() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_chunks.size() * m_block * ARENA_CHUNK_BLOCKS;
+}
+
+size_t NodeArena::live() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_live;
+}
+
+NameTable& NameTable::instance()
+{
+    // never destroyed - names may be released by nodes after static destructors
+    static NameTable* table = new NameTable;
+    return *table;
+}
+
+QString NameTable::intern(const QString& name)
+{
+    NameTable& t = instance();
+    QMutexLocker locker(&t.m_mutex);
+    QSet<QString>::const_iterator itr = t.m_names.constFind(name);
+    if (itr != t.m_names.constEnd()) return *itr;
+
+    if (t.m_names.size() >= t.m_purge_limit)
+    {
+        locker.unlock();
+        purge();
+        locker.relock();
+    }
+
+    t.m_names.insert(name);
+    return name;
+}
+
+void NameTable::purge()
+{
+    NameTable& t = instance();
+    QMutexLocker locker(&t.m_mutex);
+    QSet<QString>::iterator itr = t.m_names.begin();
+
+    while (itr != t.m_names.end())
+    {
+        // table holds the only reference
+        if (itr->isDetached())
+            itr = t.m_names.erase(itr);
+        else
+            ++itr;
+    }
+
+    t.m_purge_limit = qMax(4096, t.m_names.size() * 2);
+}
+
+size_t NameTable::bytes()
+{
+    NameTable& t = instance();
+    QMutexLocker locker(&t.m_mutex);
+    size_t res = 0;
+
+    foreach(const QString& name, t.m_names)
+    {
+        res += name.capacity() * sizeof(QChar);
+    }
+
+    return res;
+}
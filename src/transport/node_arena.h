@@ -0,0 +1,62 @@
+#ifndef __NODE_ARENA_H__
+#define __NODE_ARENA_H__
+
+#include <cstddef>
+#include <vector>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+/**
+ * fixed size blocks carved from large chunks, released blocks are reused
+ * shared tree nodes are allocated here to avoid per node malloc overhead and fragmentation
+ * chunks are never returned to system
+ */
+class NodeArena
+{
+public:
+    explicit NodeArena(size_t block_size);
+
+    void* allocate();
+    void release(void* p);
+
+    size_t reserved() const;    // bytes in chunks
+    size_t live() const;        // allocated blocks
+private:
+    size_t              m_block;
+    std::vector<char*>  m_chunks;
+    char*               m_cursor;   // free space in last chunk
+    char*               m_end;
+    void*               m_free;     // list of released blocks
+    size_t              m_live;
+    mutable QMutex      m_mutex;
+};
+
+/**
+ * one copy of equal file names in shared tree
+ * names are implicitly shared, so node name refers to the table entry
+ */
+class NameTable
+{
+public:
+    static QString intern(const QString& name);
+
+    /**
+      * drop names which are not referenced by nodes anymore
+     */
+    static void purge();
+
+    /**
+      * characters memory of stored names
+     */
+    static size_t bytes();
+private:
+    static NameTable& instance();
+    NameTable() : m_purge_limit(4096) {}
+
+    QSet<QString>   m_names;
+    int             m_purge_limit;  // table size to purge next time
+    QMutex          m_mutex;
+};
+
+#endif //__NODE_ARENA_H__
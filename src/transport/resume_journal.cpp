@@ -0,0 +1,339 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "resume_journal.h"
+
+namespace
+{
+    const char journal_magic[] = { 'Q', 'M', 'R', 'J' };
+    const quint32 journal_version = 1;
+    const qint64 header_size = sizeof(journal_magic) + sizeof(quint32);
+    const qint64 compaction_min_garbage = 1024*1024;   // don't rewrite small journals
+    const int max_key_size = 0xFF;                      // key length is stored in one byte
+
+    // op + key length + value size + crc
+    const qint64 record_overhead = sizeof(quint8) + sizeof(quint8) + sizeof(quint32) + sizeof(quint16);
+
+    bool syncFile(QFile& file)
+    {
+        if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return fsync(file.handle()) == 0;
+#endif
+    }
+
+    QByteArray header()
+    {
+        QByteArray res(journal_magic, sizeof(journal_magic));
+        uchar version[sizeof(quint32)];
+        qToBigEndian(journal_version, version);
+        res.append(reinterpret_cast<const char*>(version), sizeof(version));
+        return res;
+    }
+}
+
+ResumeJournal::ResumeJournal() : m_live(0)
+{
+}
+
+ResumeJournal::~ResumeJournal()
+{
+    commit();
+    close();
+}
+
+bool ResumeJournal::open(const QString& filepath, QHash<QByteArray, QByteArray>& records)
+{
+    QMutexLocker locker(&m_mutex);
+    m_path = filepath;
+    m_index.clear();
+    m_live = 0;
+
+    // compaction was interrupted - before rename old journal is intact, after removing it only new one is left
+    const QString tmp_path = m_path + ".tmp";
+    if (QFile::exists(tmp_path))
+    {
+        if (QFile::exists(m_path)) QFile::remove(tmp_path);
+        else QFile::rename(tmp_path, m_path);
+    }
+
+    m_file.setFileName(m_path);
+
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        qDebug() << "unable to open resume journal " << m_path << " " << m_file.errorString();
+        return false;
+    }
+
+    const QByteArray data = m_file.readAll();
+
+    if (data.size() < header_size || !data.startsWith(header()))
+    {
+        if (!data.isEmpty())
+        {
+            qDebug() << "resume journal " << m_path << " has unknown format, move it aside";
+            m_file.close();
+            QFile::remove(m_path + ".broken");
+            QFile::rename(m_path, m_path + ".broken");
+            m_file.setFileName(m_path);
+            if (!m_file.open(QIODevice::ReadWrite)) return false;
+        }
+
+        m_file.resize(0);
+        m_file.write(header());
+        return syncFile(m_file);
+    }
+
+    const uchar* base = reinterpret_cast<const uchar*>(data.constData());
+    const qint64 size = data.size();
+    qint64 pos = header_size;
+
+    while (pos < size)
+    {
+        const qint64 start = pos;
+        if (size - pos < record_overhead) break;
+
+        const quint8 op = base[pos++];
+        const quint8 key_size = base[pos++];
+        if (size - pos < key_size + qint64(sizeof(quint32))) break;
+
+        const QByteArray key = data.mid(pos, key_size);
+        pos += key_size;
+        const quint32 value_size = qFromBigEndian<quint32>(base + pos);
+        pos += sizeof(quint32);
+        if (size - pos < qint64(value_size) + qint64(sizeof(quint16))) break;
+
+        const qint64 value_pos = pos;
+        pos += value_size;
+        const quint16 crc = qFromBigEndian<quint16>(base + pos);
+        pos += sizeof(quint16);
+
+        if (crc != qChecksum(data.constData() + start, pos - start - sizeof(quint16)) ||
+            (op != op_put && op != op_remove))
+        {
+            pos = start;
+            break;
+        }
+
+        QHash<QByteArray, Slot>::iterator itr = m_index.find(key);
+
+        if (itr != m_index.end())
+        {
+            m_live -= itr->size;
+            m_index.erase(itr);
+        }
+
+        if (op == op_put)
+        {
+            Slot slot = { start, pos - start };
+            m_index.insert(key, slot);
+            m_live += slot.size;
+            records.insert(key, data.mid(value_pos, value_size));
+        }
+        else
+        {
+            records.remove(key);
+        }
+    }
+
+    if (pos < size)
+    {
+        qDebug() << "resume journal " << m_path << " has torn tail at " << pos << ", cut " << (size - pos) << " bytes";
+        m_file.resize(pos);
+    }
+
+    qDebug() << "resume journal " << m_path << " loaded " << m_index.size() << " records";
+    return true;
+}
+
+void ResumeJournal::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_file.close();
+}
+
+void ResumeJournal::put(const QByteArray& key, const QByteArray& value)
+{
+    enqueue(op_put, key, value);
+}
+
+void ResumeJournal::remove(const QByteArray& key)
+{
+    enqueue(op_remove, key, QByteArray());
+}
+
+void ResumeJournal::enqueue(Operation op, const QByteArray& key, const QByteArray& value)
+{
+    if (key.size() > max_key_size)
+    {
+        qDebug() << "resume journal key is too long, record rejected " << key.size();
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    Pending p;
+    p.key = key;
+    p.op = op;
+    p.offset = m_buffer.size();
+    appendRecord(m_buffer, op, key, value);
+    p.size = m_buffer.size() - p.offset;
+    m_pending.push_back(p);
+}
+
+bool ResumeJournal::commit()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.empty()) return true;
+    if (!m_file.isOpen()) return false;
+
+    const qint64 base = m_file.size();
+
+    if (!m_file.seek(base) || m_file.write(m_buffer) != m_buffer.size() || !syncFile(m_file))
+    {
+        qDebug() << "unable to write resume journal " << m_path << " " << m_file.errorString();
+        m_file.resize(base);
+        return false;
+    }
+
+    for (std::vector<Pending>::const_iterator itr = m_pending.begin(); itr != m_pending.end(); ++itr)
+    {
+        QHash<QByteArray, Slot>::iterator slot = m_index.find(itr->key);
+
+        if (slot != m_index.end())
+        {
+            m_live -= slot->size;
+            m_index.erase(slot);
+        }
+
+        if (itr->op == op_put)
+        {
+            Slot s = { base + itr->offset, itr->size };
+            m_index.insert(itr->key, s);
+            m_live += s.size;
+        }
+    }
+
+    m_buffer.clear();
+    m_pending.clear();
+
+    if (needCompaction()) compactLocked();
+    return true;
+}
+
+bool ResumeJournal::compact()
+{
+    QMutexLocker locker(&m_mutex);
+    return compactLocked();
+}
+
+bool ResumeJournal::needCompaction() const
+{
+    const qint64 garbage = m_file.size() - header_size - m_live;
+    return garbage >= compaction_min_garbage && garbage > m_live;
+}
+
+bool ResumeJournal::compactLocked()
+{
+    if (!m_file.isOpen()) return false;
+
+    const QString tmp_path = m_path + ".tmp";
+
+    // previous rename failed and live journal is still the temporary file - finish rename first,
+    // compacted file must never be created on top of the live one
+    if (m_file.fileName() != m_path)
+    {
+        m_file.close();
+        const bool renamed = QFile::rename(tmp_path, m_path);
+        if (renamed) m_file.setFileName(m_path);
+
+        if (!m_file.open(QIODevice::ReadWrite))
+        {
+            qDebug() << "unable to reopen resume journal " << m_file.fileName();
+            return false;
+        }
+
+        if (!renamed)
+        {
+            qDebug() << "resume journal is still under temporary name, compaction skipped";
+            return false;
+        }
+    }
+
+    QFile out(tmp_path);
+
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "unable to create compacted resume journal " << tmp_path;
+        return false;
+    }
+
+    QHash<QByteArray, Slot> index;
+    bool ok = out.write(header()) == header_size;
+
+    for (QHash<QByteArray, Slot>::const_iterator itr = m_index.constBegin(); ok && itr != m_index.constEnd(); ++itr)
+    {
+        Slot slot = { out.pos(), itr->size };
+        ok = m_file.seek(itr->offset) && out.write(m_file.read(itr->size)) == itr->size;
+        index.insert(itr.key(), slot);
+    }
+
+    ok = ok && syncFile(out);
+    out.close();
+
+    if (!ok)
+    {
+        qDebug() << "resume journal compaction failed " << out.errorString();
+        QFile::remove(tmp_path);
+        return false;
+    }
+
+    qDebug() << "resume journal compacted from " << m_file.size() << " to " << (header_size + m_live) << " bytes";
+    m_file.close();
+
+    // QFile::rename doesn't overwrite, open() finishes rename when we stop between these calls
+    if (!QFile::remove(m_path))
+    {
+        qDebug() << "unable to replace resume journal " << m_path;
+        QFile::remove(tmp_path);
+        m_file.open(QIODevice::ReadWrite);
+        return false;
+    }
+
+    // old journal is gone, keep working with compacted one under temporary name until next start
+    m_file.setFileName(QFile::rename(tmp_path, m_path) ? m_path : tmp_path);
+
+    if (!m_file.open(QIODevice::ReadWrite))
+    {
+        qDebug() << "unable to reopen resume journal " << m_file.fileName();
+        return false;
+    }
+
+    m_index = index;
+    return true;
+}
+
+void ResumeJournal::appendRecord(QByteArray& out, Operation op, const QByteArray& key, const QByteArray& value)
+{
+    Q_ASSERT(key.size() <= max_key_size);
+    const int start = out.size();
+    uchar size[sizeof(quint32)];
+    uchar crc[sizeof(quint16)];
+
+    out.append(char(op));
+    out.append(char(key.size()));
+    out.append(key);
+    qToBigEndian<quint32>(value.size(), size);
+    out.append(reinterpret_cast<const char*>(size), sizeof(size));
+    out.append(value);
+    qToBigEndian<quint16>(qChecksum(out.constData() + start, out.size() - start), crc);
+    out.append(reinterpret_cast<const char*>(crc), sizeof(crc));
+}
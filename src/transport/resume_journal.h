@@ -0,0 +1,81 @@
+#ifndef __RESUME_JOURNAL_H__
+#define __RESUME_JOURNAL_H__
+
+#include <vector>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * append-only store of transfer records keyed by transfer hash, key is up to 255 bytes - longer keys are rejected
+ * every record is appended to one file, last record for key wins, removal is written as tombstone
+ * file is rewritten with live records only when dead records take most of it
+ * all methods are thread safe - records come from session worker, removals from GUI thread
+ */
+class ResumeJournal
+{
+public:
+    ResumeJournal();
+    ~ResumeJournal();
+
+    /**
+      * open or create journal and read all live records with one pass over file
+      * torn tail after crash is cut off
+     */
+    bool open(const QString& filepath, QHash<QByteArray, QByteArray>& records);
+    void close();
+
+    /**
+      * buffer record, nothing is written until commit
+     */
+    void put(const QByteArray& key, const QByteArray& value);
+    void remove(const QByteArray& key);
+
+    /**
+      * append buffered records with one flush and fsync, compact journal when garbage exceeds threshold
+      * buffer is kept on failure and will be written by next commit
+     */
+    bool commit();
+
+    /**
+      * rewrite journal with live records only
+     */
+    bool compact();
+private:
+    enum Operation
+    {
+        op_put = 1,
+        op_remove = 2
+    };
+
+    struct Slot
+    {
+        qint64 offset;  // record start in file
+        qint64 size;    // whole record size
+    };
+
+    struct Pending
+    {
+        QByteArray key;
+        Operation op;
+        qint64 offset;  // record start in buffer
+        qint64 size;
+    };
+
+    static void appendRecord(QByteArray& out, Operation op, const QByteArray& key, const QByteArray& value);
+    void enqueue(Operation op, const QByteArray& key, const QByteArray& value);
+    bool compactLocked();
+    bool needCompaction() const;
+
+    QString                 m_path;
+    QFile                   m_file;
+    QByteArray              m_buffer;   // records are waiting commit
+    std::vector<Pending>    m_pending;
+    QHash<QByteArray, Slot> m_index;    // live records in file
+    qint64                  m_live;     // live records bytes
+    mutable QMutex          m_mutex;
+};
+
+#endif //__RESUME_JOURNAL_H__
@@ -9,6 +9,8 @@
 #endif
 
 #include "transport/session.h"
+#include "transport/node_arena.h"
+#include "transport/fs_snapshot.h"
 #include "torrentpersistentdata.h"
 
 using namespace libtorrent;
@@ -83,7 +85,9 @@ void Session::drop()
 }
 
 Session::~Session()
-{ 
+{
+    // sessions read alerts by themselves on destruction
+    haltWorker();
 }
 
 Session::Session() : m_root(NULL, QFileInfo(), true), m_delay(10000)
@@ -130,11 +134,28 @@ Session::Session() : m_root(NULL, QFileInfo(), true), m_delay(10000)
     m_alerts_reading.reset(new QTimer(this));
     m_periodic_resume.reset(new QTimer(this));
     connect(m_alerts_reading.data(), SIGNAL(timeout()), SLOT(readAlerts()));
+    connect(m_alerts_reading.data(), SIGNAL(timeout()), SLOT(refreshSnapshot()));
     connect(m_periodic_resume.data(), SIGNAL(timeout()), SLOT(saveTempFastResumeData()));
 
     m_alerts_reading->start(1000);
     m_periodic_resume->start(270000);   // 3 min
 
+    // shared directories are updated by change notifications, full rescan is consistency check only
+    m_watcher.reset(new DirWatcher(this));
+    connect(m_watcher.data(), SIGNAL(entryAdded(const QString&, const QString&)),
+            SLOT(on_entryAdded(const QString&, const QString&)));
+    connect(m_watcher.data(), SIGNAL(entryRemoved(const QString&, const QString&)),
+            SLOT(on_entryRemoved(const QString&, const QString&)));
+    connect(m_watcher.data(), SIGNAL(rescanRequired(const QString&)),
+            SLOT(on_rescanRequired(const QString&)));
+    m_collections.reset(new CollectionBuilder(this));
+    m_share_job.reset(new ShareJob(this));
+    connect(m_share_job.data(), SIGNAL(progress(int, int, int)), SIGNAL(shareProgress(int, int, int)));
+    connect(m_share_job.data(), SIGNAL(finished()), SIGNAL(shareFinished()));
+    m_consistency_check.reset(new QTimer(this));
+    connect(m_consistency_check.data(), SIGNAL(timeout()), SLOT(checkSharedDirectories()));
+    m_consistency_check->start(3600000);    // 1 hour
+
     // libed2k signals
     connect(&m_edSession, SIGNAL(addedTransfer(Transfer)), this, SIGNAL(addedTransfer(Transfer)));
     connect(&m_edSession, SIGNAL(pausedTransfer(Transfer)), this, SIGNAL(pausedTransfer(Transfer)));
@@ -154,6 +175,13 @@ Session::Session() : m_root(NULL, QFileInfo(), true), m_delay(10000)
     connect(&m_edSession, SIGNAL(savePathChanged(Transfer)), this, SIGNAL(savePathChanged(Transfer)));
     connect(&m_edSession, SIGNAL(fastResumeDataLoadCompleted()), this, SLOT(on_ED2KResumeDataLoaded()));
 
+    // ed2k transfer events are forwarded as is, index their files separately
+    connect(&m_edSession, SIGNAL(addedTransfer(Transfer)), this, SLOT(indexTransfer(Transfer)));
+    connect(&m_edSession, SIGNAL(finishedTransfer(Transfer)), this, SLOT(indexTransfer(Transfer)));
+    connect(&m_edSession, SIGNAL(savePathChanged(Transfer)), this, SLOT(indexTransfer(Transfer)));
+    connect(&m_edSession, SIGNAL(deletedTransfer(QString)), this, SLOT(unindexTransfer(QString)));
+    connect(&m_btSession, SIGNAL(deletedTorrent(QString)), this, SLOT(unindexTransfer(QString)));
+
     m_speedMonitor.reset(new TorrentSpeedMonitor(this));
     m_speedMonitor->start();
 }
@@ -180,6 +208,11 @@ void Session::start()
     if (!started())
     {
         for_each(std::mem_fun(&SessionBase::start));
+
+        // alerts are drained out of GUI thread from now
+        m_worker.reset(new SessionWorker(m_sessions, this));
+        connect(m_worker.data(), SIGNAL(alertsReady()), SLOT(on_alertsReady()), Qt::QueuedConnection);
+        m_worker->start();
     }
 }
 
@@ -187,10 +220,20 @@ void Session::stop()
 {
     if (started())
     {
+        haltWorker();
         for_each(std::mem_fun(&SessionBase::stop));
     }
 }
 
+void Session::haltWorker()
+{
+    if (m_worker)
+    {
+        m_worker->halt();
+        m_worker.reset();
+    }
+}
+
 bool Session::started() const
 {
     return (*m_sessions.begin())->started();
@@ -234,6 +277,28 @@ qlonglong Session::getETA(const QString& hash) const {
     return m_speedMonitor->getETA(hash);
 }
 
+qreal Session::getRealRatio(const QString& hash) const {
+    return getSnapshotEntry(hash).ratio();
+}
+
+TransferSnapshot Session::getSnapshot() const
+{
+    QMutexLocker locker(&m_snapshot_mutex);
+    return m_snapshot;
+}
+
+TransferSnapshotEntry Session::getSnapshotEntry(const QString& hash) const
+{
+    {
+        QMutexLocker locker(&m_snapshot_mutex);
+        QHash<QString, TransferSnapshotEntry>::const_iterator itr = m_snapshot.entries().find(hash);
+        if (itr != m_snapshot.entries().end()) return itr.value();
+    }
+
+    // transfer was added after last tick
+    return TransferSnapshotEntry::fetch(getTransfer(hash), false);
+}
+
 qreal Session::getGlobalMaxRatio() const { return m_btSession.getGlobalMaxRatio(); }
 qreal Session::getMaxRatioPerTransfer(const QString& hash, bool* use_global) const {
     return delegate(hash)->getMaxRatioPerTransfer(hash, use_global);
@@ -247,6 +312,22 @@ QStringList Session::getPeerBanMessages() const { return m_btSession.getPeerBanM
 SessionStatus Session::getSessionStatus() const {
     return m_edSession.getSessionStatus() + m_btSession.getSessionStatus();
 }
+QHash<QString, quint64> Session::getAlertCounters() const
+{
+    QHash<QString, quint64> res;
+    QHash<QString, quint64> counters = m_btSession.alertCounters();
+
+    for (QHash<QString, quint64>::const_iterator itr = counters.constBegin(); itr != counters.constEnd(); ++itr)
+        res.insert("bt/" + itr.key(), itr.value());
+
+    counters = m_edSession.alertCounters();
+
+    for (QHash<QString, quint64>::const_iterator itr = counters.constBegin(); itr != counters.constEnd(); ++itr)
+        res.insert("ed2k/" + itr.key(), itr.value());
+
+    return res;
+}
+
 QTorrentHandle Session::addTorrent(const QString& path, bool fromScanDir/* = false*/,
                                    QString from_url /*= QString()*/, bool resumed/* = false*/) {
     return m_btSession.addTorrent(path, fromScanDir, from_url, resumed);
@@ -302,7 +383,12 @@ void Session::setUploadRateLimit(long rate)
 
 bool Session::hasActiveTransfers() const
 {
-	return (m_btSession.hasActiveTransfers() || m_edSession.hasActiveTransfers());
+    return getSnapshot().hasActiveTransfers();
+}
+
+float Session::progress() const
+{
+    return getSnapshot().progress();
 }
 
 bool Session::useTemporaryFolder() const { return m_btSession.useTemporaryFolder(); }
@@ -334,6 +420,16 @@ bool Session::playMedia(Transfer t, int fileIndex)
     if (t.is_valid() && t.has_metadata() &&
         misc::isPreviewable(misc::file_extension(t.filename_at(fileIndex))))
     {
+        Preferences pref;
+
+        // local HTTP server streams incomplete file, player doesn't wait for boundary pieces
+        if (pref.runHttpServer() && !t.is_seed())
+        {
+            // connection switches download mode while it streams and restores it after
+            return QDesktopServices::openUrl(
+                QUrl(QString("http://127.0.0.1:%1/%2?file=%3").arg(pref.httpPort()).arg(t.hash()).arg(fileIndex)));
+        }
+
         TransferBitfield pieces = t.pieces();
         const std::vector<int> extremity_pieces = t.file_extremity_pieces_at(fileIndex);
 
@@ -406,11 +502,18 @@ void Session::addTransferFromFile(const QString& filename)
     }
 }
 
-void Session::on_addedTorrent(const QTorrentHandle& h) { emit addedTransfer(Transfer(h)); }
+void Session::on_addedTorrent(const QTorrentHandle& h)
+{
+    m_transfer_paths.update(Transfer(h));
+    emit addedTransfer(Transfer(h));
+}
+
 void Session::on_pausedTorrent(const QTorrentHandle& h) { emit pausedTransfer(Transfer(h)); }
 
 void Session::on_finishedTorrent(const QTorrentHandle& h)
 {    
+    // files must be completed in index before sharing
+    m_transfer_paths.update(Transfer(h));
     QSet<QString> roots = misc::torrentRoots(h);
 
     foreach(const QString& str, roots)
@@ -421,7 +524,11 @@ void Session::on_finishedTorrent(const QTorrentHandle& h)
     emit finishedTransfer(Transfer(h));
 }
 
-void Session::on_metadataReceived(const QTorrentHandle& h) { emit metadataReceived(Transfer(h)); }
+void Session::on_metadataReceived(const QTorrentHandle& h)
+{
+    m_transfer_paths.update(Transfer(h));
+    emit metadataReceived(Transfer(h));
+}
 
 void Session::on_torrentAboutToBeRemoved(const QTorrentHandle& h, bool del_files)
 {
@@ -450,6 +557,7 @@ void Session::on_torrentAboutToBeRemoved(const QTorrentHandle& h, bool del_files
         }
     }
 
+    m_transfer_paths.remove(h.hash());
     emit transferAboutToBeRemoved(Transfer(h), del_files);
 }
 
@@ -466,6 +574,7 @@ void Session::on_transferAboutToBeRemoved(const Transfer& t, bool del_files)
         Q_ASSERT(node);
         emit removeSharedFile(node);
         m_files.erase(itr);
+        m_type_index[node->type()].remove(node);
 
         if (del_files)
         {
@@ -484,6 +593,8 @@ void Session::on_transferAboutToBeRemoved(const Transfer& t, bool del_files)
         m_h2f_dict.remove(t.hash());
     }
 
+    m_transfer_paths.remove(t.hash());
+
     emit transferAboutToBeRemoved(t, del_files);
 
 }
@@ -494,7 +605,11 @@ void Session::on_torrentFinishedChecking(const QTorrentHandle& h) {
 void Session::on_trackerAuthenticationRequired(const QTorrentHandle& h) {
     emit trackerAuthenticationRequired(Transfer(h));
 }
-void Session::on_savePathChanged(const QTorrentHandle& h) { emit savePathChanged(Transfer(h)); }
+void Session::on_savePathChanged(const QTorrentHandle& h)
+{
+    m_transfer_paths.update(Transfer(h));
+    emit savePathChanged(Transfer(h));
+}
 
 void Session::saveTempFastResumeData()
 {
@@ -506,11 +621,35 @@ void Session::readAlerts()
     for_each(std::mem_fun(&SessionBase::readAlerts));
 }
 
+void Session::drainAlerts()
+{
+    for_each(std::mem_fun(&SessionBase::drainAlerts));
+}
+
+void Session::on_alertsReady()
+{
+    if (m_worker) m_worker->acknowledge();
+    readAlerts();
+}
+
+void Session::refreshSnapshot()
+{
+    // collect statuses outside of lock - it is the expensive part
+    TransferSnapshot snapshot(getTransfers(), getActiveTransfers(), m_snapshot.tick() + 1);
+    QMutexLocker locker(&m_snapshot_mutex);
+    m_snapshot = snapshot;
+}
+
 void Session::saveFastResumeData()
 {
     m_periodic_resume->stop();
     m_alerts_reading->stop();
+    m_consistency_check->stop();
+    haltWorker();
+    drainAlerts();  // dispatch everything drained by worker, nothing must be left behind
     m_delay.cancel();
+    m_collections->cancel();
+    m_share_job->cancel();
     for (std::set<DirNode*>::const_iterator itr = m_dirs.begin(); itr != m_dirs.end(); ++itr)
     {
         const DirNode* p = *itr;
@@ -543,19 +682,17 @@ void Session::on_ED2KResumeDataLoaded()
     }
 
 
-    // remove extra files - incompleted
-    QList<QDir> il = Session::instance()->incompleteFiles();
-
     // after load transfers completed we must execute share on all shared directories for catch new files
     foreach(DirNode* pdn, m_shared_dirs)
     {
         qDebug() << "share2 on " << pdn->filename();
-        pdn->reshare(il);
+        pdn->reshare();
     }
 
     // cleanup helpers
     m_h2f_dict.clear();
     m_shared_dirs.clear();
+    reportTreeMemory();
     emit endLoadSharedFileSystem();
 }
 
@@ -579,6 +716,16 @@ void Session::on_registerNode(Transfer t)
     }
 }
 
+void Session::indexTransfer(Transfer t)
+{
+    m_transfer_paths.update(t);
+}
+
+void Session::unindexTransfer(QString hash)
+{
+    m_transfer_paths.remove(hash);
+}
+
 void Session::on_transferParametersReady(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec)
 {
     qDebug() << Q_FUNC_INFO;
@@ -601,26 +748,98 @@ void Session::on_transferParametersReady(const libed2k::add_transfer_params& atp
     }
 }
 
+void Session::on_entryAdded(const QString& dirpath, const QString& name)
+{
+    DirNode* dir = sharedDirectory(dirpath);
+    if (!dir) return;
+
+    dir->add_entry(name);
+}
+
+void Session::on_entryRemoved(const QString& dirpath, const QString& name)
+{
+    DirNode* dir = sharedDirectory(dirpath);
+    if (!dir) return;
+
+    dir->remove_entry(name);
+}
+
+void Session::on_rescanRequired(const QString& dirpath)
+{
+    if (dirpath.isEmpty())
+    {
+        checkSharedDirectories();
+        return;
+    }
+
+    DirNode* dir = sharedDirectory(dirpath);
+    if (!dir) return;
+
+    dir->rescan();
+}
+
+void Session::checkSharedDirectories()
+{
+    qDebug() << "check shared directories: " << m_dirs.size();
+    // rescan can remove nested shared directories
+    std::vector<DirNode*> dirs(m_dirs.begin(), m_dirs.end());
+
+    for (std::vector<DirNode*>::const_iterator itr = dirs.begin(); itr != dirs.end(); ++itr)
+    {
+        if (m_dirs.count(*itr)) (*itr)->rescan();
+    }
+
+    NameTable::purge();
+    reportTreeMemory();
+}
+
+DirNode* Session::sharedDirectory(const QString& dirpath)
+{
+    DirNode* dir = dynamic_cast<DirNode*>(findNode(dirpath));
+    return (dir && m_dirs.count(dir)) ? dir : NULL;
+}
+
 void Session::removeDirectory(DirNode* dir)
 {
+    m_watcher->unwatch(dir->filepath());
+    m_collections->forget(dir);
     emit removeSharedDirectory(dir);
     m_dirs.erase(dir);    
-    m_delay.execute(boost::bind(&Session::prepare_collections, Session::instance()));
 }
 
 void Session::addDirectory(DirNode* dir)
 {
     m_dirs.insert(dir);    
+    m_watcher->watch(dir->filepath());
     emit insertSharedDirectory(dir);
-    m_delay.execute(boost::bind(&Session::prepare_collections, Session::instance()));
+    collectionChanged(dir);
 }
 
 void Session::registerNode(FileNode* node)
 {
+    // same content under other path replaces previous node - drop it from indexes too
+    FileNode* prev = m_files.value(node->hash(), NULL);
+    if (prev && prev != node)
+    {
+        emit removeSharedFile(prev);
+        m_type_index[prev->type()].remove(prev);
+    }
+
     m_files.insert(node->hash(), node);
+    m_type_index[node->type()].insert(node);
     emit insertSharedFile(node);
 }
 
+QList<FileNode*> Session::filesOfType(int type) const
+{
+    return m_type_index.value(type).toList();
+}
+
+bool Session::isRegistered(const FileNode* node) const
+{
+    return node->has_transfer() && m_files.value(node->hash()) == node;
+}
+
 #ifdef Q_OS_WIN32
 static QString qt_GetLongPathName(const QString &strShortPath)
 {
@@ -656,8 +875,42 @@ static QString qt_GetLongPathName(const QString &strShortPath)
 }
 #endif
 
-FileNode* Session::node(const QString& filepath, const QHash<QString, QString>* pdict/* = NULL*/)
+FileNode* Session::findNode(const QString& filepath) const
+{
+    DirNode* dir = m_dir_index.value(filepath);
+    if (dir) return dir;
+
+    const int slash = filepath.lastIndexOf(QLatin1Char('/'));
+    if (slash < 0 || slash == filepath.size() - 1) return NULL;
+
+    // raw data strings refer to filepath - lookups don't copy path components
+    dir = m_dir_index.value(QString::fromRawData(filepath.unicode(), slash));
+
+    // root directories keep trailing slash - "/" and "C:/"
+    if (!dir) dir = m_dir_index.value(QString::fromRawData(filepath.unicode(), slash + 1));
+    if (!dir) return NULL;
+
+    const QString name = QString::fromRawData(filepath.unicode() + slash + 1, filepath.size() - slash - 1);
+    FileNode* p = dir->m_file_children.value(name);
+    return p ? p : dir->m_dir_children.value(name);
+}
+
+void Session::indexDirectory(DirNode* dir)
 {
+    m_dir_index.insert(dir->path(), dir);
+}
+
+void Session::unindexDirectory(DirNode* dir)
+{
+    QHash<QString, DirNode*>::iterator itr = m_dir_index.find(dir->path());
+    if (itr != m_dir_index.end() && itr.value() == dir) m_dir_index.erase(itr);
+}
+
+FileNode* Session::node(const QString& filepath, const QHash<QString, QString>* pdict/* = NULL*/, bool populate /* = true*/)
+{
+    FileNode* found = findNode(filepath);
+    if (found) return found;
+
     qDebug() << "node: " << filepath;
     if (filepath.isEmpty() || filepath == tr("My Computer") ||
             filepath == tr("Computer") || filepath.startsWith(QLatin1Char(':')))
@@ -735,11 +988,8 @@ FileNode* Session::node(const QString& filepath, const QHash<QString, QString>*
                 return (&m_root);
             }
 
-            // generate node with fake info and next request real info
             node = new DirNode(parent, info);
-            node->m_filename = element;            
-            QFileInfo node_info(node->filepath());
-            node->m_info = node_info;
+            node->set_filename(element);
             parent->add_node(node);
         }
 
@@ -771,7 +1021,7 @@ FileNode* Session::node(const QString& filepath, const QHash<QString, QString>*
         else if (info.isDir())
         {
             p = new DirNode(parent, info);
-            ((DirNode*)p)->populate(false, pdict);
+            if (populate) ((DirNode*)p)->populate(false, pdict);
             parent->add_node(p);
         }
     }
@@ -781,20 +1031,24 @@ FileNode* Session::node(const QString& filepath, const QHash<QString, QString>*
 
 void Session::prepare_collections()
 {
-    int i = 10; // limit collections sharing at moment to avoid gui hang up
-    for (std::set<DirNode*>::iterator itr = m_dirs.begin(); itr != m_dirs.end(); ++itr)
-    {
-        DirNode* p = *itr;
+    m_collections->process();
+}
 
-        if (p->is_active() && !p->has_transfer())
-        {
-            p->build_collection();
-            --i;
-        }
+void Session::collectionChanged(DirNode* dir)
+{
+    m_collections->markDirty(dir);
+    m_delay.execute(boost::bind(&Session::prepare_collections, Session::instance()));
+}
 
-        if (i == 0)
-            break;
-    }
+void Session::reportTreeMemory()
+{
+    const TreeMemory mem = TreeMemory::collect(m_root);
+    const qint64 count = qMax<qint64>(1, mem.files + mem.dirs);
+
+    qDebug() << "shared tree memory: files " << mem.files << " dirs " << mem.dirs
+             << " nodes " << mem.nodes << " names " << mem.names << " indexes " << mem.indexes
+             << " metadata " << mem.metadata << " bytes per node " << mem.total() / count
+             << " without metadata " << (mem.total() - mem.metadata) / count;
 }
 
 // simple compare operator for our pairs
@@ -803,69 +1057,101 @@ bool operator<(const QVector<QString>& v1, const QVector<QString>& v2)
     return v1.size() < v2.size();
 }
 
+static bool pathLessThan(const DirNode* d1, const DirNode* d2)
+{
+    return d1->path() < d2->path();
+}
+
+static QString snapshotFilepath()
+{
+    return QDir(misc::QDesktopServicesDataLocation()).absoluteFilePath("shared.snapshot");
+}
+
 void Session::saveFileSystem()
 {
     qDebug() << "saveFileSystem: " << m_dirs.size();
-    Preferences pref;
-    pref.beginGroup("SharedDirectories");
-    pref.beginWriteArray("ShareDirs");
+    SnapshotWriter writer;
+    if (!writer.open(snapshotFilepath())) return;
 
-    int dir_indx = 0;
+    // parents go before nested shared directories
+    QList<const DirNode*> dirs;
     for (std::set<DirNode*>::const_iterator itr = m_dirs.begin(); itr != m_dirs.end(); ++itr)
     {
-        const DirNode* p = *itr;
+        dirs << *itr;
+    }
+
+    qSort(dirs.begin(), dirs.end(), pathLessThan);
+
+    foreach(const DirNode* p, dirs)
+    {
         qDebug() << "save shared directory: " << p->filepath();
+        writer.add(p);
+    }
 
-        pref.setArrayIndex(dir_indx);
-        pref.setValue("Path", p->filepath());
-        QStringList efiles = p->exclude_files();
+    if (writer.commit())
+    {
+        // settings arrays aren't needed anymore when snapshot was written
+        Preferences pref;
+        pref.remove("SharedDirectories");
+    }
+}
 
-        pref.beginWriteArray("ExcludeFiles", efiles.size());
-        if (!efiles.isEmpty())
-        {
-            int file_indx = 0;            
+void Session::loadFileSystem()
+{
+    qDebug() << "load file system";
+    Preferences pref;
+    m_incoming = pref.getSavePath();
 
-            foreach(const QString& efile, efiles)
-            {
-                pref.setArrayIndex(file_indx);
-                pref.setValue("FileName", efile);
-                ++file_indx;
-            }            
-        }
+    if (loadFileSystemSnapshot())
+    {
+        // snapshot trusts stat data of previous run, check directories changed while we were stopped
+        QTimer::singleShot(60000, this, SLOT(checkSharedDirectories()));   // 1 minute
+    }
+    else
+    {
+        loadLegacyFileSystem();
+    }
+}
 
-        pref.endArray();
-        // transfer links
-        pref.beginWriteArray("TransferLinks");
-        int nf_index = 0;
-        foreach(FileNode* pnf, p->files())
+bool Session::loadFileSystemSnapshot()
+{
+    SnapshotReader reader;
+    if (!reader.open(snapshotFilepath())) return false;
+
+    SnapshotDir record;
+    int count = 0;
+
+    while (reader.next(record))
+    {
+        FileNode* p = node(record.path, NULL, false);
+
+        if (p == &m_root || !p->is_dir())
         {
-            if (pnf->has_transfer())
-            {
-                pref.setArrayIndex(nf_index);
-                QString lstr = pnf->hash() +  pnf->filename();
-                pref.setValue("TFLink", lstr);
-                qDebug() << "save link: " << lstr;
-                ++nf_index;
-            }
+            qDebug() << "shared directory " << record.path << " is not exists";
+            continue;
         }
 
-        pref.endArray();
+        DirNode* dir_node = static_cast<DirNode*>(p);
+        dir_node->restore(record);
+        m_shared_dirs.push_back(dir_node);
+        ++count;
+    }
 
-        ++dir_indx;
+    if (!reader.completed())
+    {
+        // restored directories are valid, rest will be shared by user again
+        qDebug() << "shared filesystem snapshot is damaged, restored " << count << " directories";
     }
 
-    pref.endArray();
-    pref.endGroup();
+    qDebug() << "restored shared directories from snapshot: " << count;
+    return true;
 }
 
-void Session::loadFileSystem()
+void Session::loadLegacyFileSystem()
 {
-    qDebug() << "load file system";    
     Preferences pref;
     typedef QPair<QString, QVector<QString> > SD;
     QVector<SD> vf;
-    m_incoming = pref.getSavePath();
-
     pref.beginGroup("SharedDirectories");
     int dcount = pref.beginReadArray("ShareDirs");
     vf.resize(dcount);
@@ -942,6 +1228,7 @@ void Session::loadFileSystem()
 void Session::dropDirectoryTransfers()
 {
     m_delay.cancel();
+    m_collections->cancel();
 
     for (std::set<DirNode*>::const_iterator itr = m_dirs.begin(); itr != m_dirs.end(); ++itr)
     {
@@ -950,7 +1237,7 @@ void Session::dropDirectoryTransfers()
 
         if (p->has_transfer())
         {
-            deleteTransfer(p->m_hash, true);
+            deleteTransfer(p->hash(), true);
         }
     }
 }
@@ -958,13 +1245,27 @@ void Session::dropDirectoryTransfers()
 void Session::share(const QString& filepath, bool recursive)
 {
     FileNode* p = node(filepath);
-    if (p != &m_root) p->share(recursive);
+    if (p == &m_root) return;
+
+    p->share(recursive);
 }
 
 void Session::unshare(const QString& filepath, bool recursive)
 {
     FileNode* p = node(filepath);
-    if (p != &m_root) p->unshare(recursive);
+    if (p == &m_root) return;
+
+    p->unshare(recursive);
+}
+
+void Session::shareTree(const DirNode* dir, bool share)
+{
+    m_share_job->start(dir, share);
+}
+
+void Session::cancelShareTree()
+{
+    m_share_job->cancel();
 }
 
 void Session::addToProgress(const QString& filepath, FileNode* node)
@@ -3,13 +3,21 @@
 #define __SESSION_H__
 
 #include <QScopedPointer>
+#include <QMutex>
+#include <QSet>
 
 #include "delay.h"
 #include "transport/transfer.h"
+#include "transport/transfer_snapshot.h"
 #include "qtlibtorrent/qbtsession.h"
 #include "qtlibed2k/qed2ksession.h"
 #include "torrentspeedmonitor.h"
 #include "session_filesystem.h"
+#include "dir_watcher.h"
+#include "transfer_path_index.h"
+#include "collection_builder.h"
+#include "share_job.h"
+#include "session_worker.h"
 
 
 /**
@@ -36,11 +44,24 @@ public:
     std::vector<Transfer> getTransfers() const;
     std::vector<Transfer> getActiveTransfers() const;
     qlonglong getETA(const QString& hash) const;
+    qreal getRealRatio(const QString& hash) const;
+
+    /**
+      * statuses of all transfers collected on last tick
+      * entry is fetched directly when transfer appeared after tick
+     */
+    TransferSnapshot getSnapshot() const;
+    TransferSnapshotEntry getSnapshotEntry(const QString& hash) const;
     qreal getGlobalMaxRatio() const;
     qreal getMaxRatioPerTransfer(const QString& hash, bool* use_global) const;
     QStringList getConsoleMessages() const;
     QStringList getPeerBanMessages() const;
     SessionStatus getSessionStatus() const;
+
+    /**
+      * dispatched alerts count by session and alert type, like "ed2k/peer_connected_alert"
+     */
+    QHash<QString, quint64> getAlertCounters() const;
     void changeLabelInSavePath(const Transfer& t, const QString& old_label, const QString& new_label);
     QTorrentHandle addTorrent(const QString& path, bool fromScanDir = false,
                               QString from_url = QString(), bool resumed = false);    
@@ -59,6 +80,7 @@ public:
     void setDownloadRateLimit(long rate);
     void setUploadRateLimit(long rate);
     bool hasActiveTransfers() const;
+    float progress() const;
 
     bool useTemporaryFolder() const;
     bool isDHTEnabled() const;
@@ -72,15 +94,53 @@ public:
 
     void saveFileSystem();
     void loadFileSystem();
+
+    /**
+      * restore shared directories from binary snapshot, false when snapshot is absent
+     */
+    bool loadFileSystemSnapshot();
+
+    /**
+      * shared directories from settings arrays of previous versions
+     */
+    void loadLegacyFileSystem();
     void dropDirectoryTransfers();
+    /**
+      * completed when returns, callers remove or use nodes right after it
+      * incremental sharing for user requests is shareTree
+     */
     void share(const QString& filepath, bool recursive);
     void unshare(const QString& filepath, bool recursive);
+
+    /**
+      * share or unshare directory with all subdirectories directory by directory
+      * progress is reported by shareProgress, job can be stopped by cancelShareTree
+     */
+    void shareTree(const DirNode* dir, bool share);
+    void cancelShareTree();
+    bool isSharingTree() const { return m_share_job->running(); }
     DirNode* root() { return &m_root; }
     std::set<DirNode*>& directories() { return m_dirs; }
     QHash<QString, FileNode*>& files() { return m_files; }
+
+    /**
+      * registered files of ed2k type by index, without classification of all files
+     */
+    QList<FileNode*> filesOfType(int type) const;
+    bool isRegistered(const FileNode* node) const;
     QHash<QString, FileNode*>& h2f_dict() { return m_h2f_dict; }
     void addToProgress(const QString& filepath, FileNode* node);
 
+    /**
+      * file belongs to transfer and isn't downloaded yet
+     */
+    bool isIncompleteFile(const QString& filepath) const { return m_transfer_paths.incomplete(filepath); }
+
+    /**
+      * hash of transfer which downloaded file, empty string for other files
+     */
+    QString completedTransfer(const QString& filepath) const { return m_transfer_paths.completed(filepath); }
+
     void loadSharedFileSystemNotify();
 public slots:
     void playPendingMedia();
@@ -117,6 +177,9 @@ signals:
 
     void beginLoadSharedFileSystem();
     void endLoadSharedFileSystem();
+
+    void shareProgress(int dirs, int files, int pending);
+    void shareFinished();
 public slots:
     void on_ED2KResumeDataLoaded();
 private slots:
@@ -131,11 +194,22 @@ private slots:
     void on_savePathChanged(const QTorrentHandle& h);
     void saveTempFastResumeData();
     void readAlerts();
+    void drainAlerts();
+    void on_alertsReady();
+    void refreshSnapshot();
     void saveFastResumeData();
 
     void on_registerNode(Transfer);
+    void indexTransfer(Transfer t);
+    void unindexTransfer(QString hash);
     void on_transferParametersReady(const libed2k::add_transfer_params&, const libed2k::error_code&);
 
+    // shared directories changes
+    void on_entryAdded(const QString& dirpath, const QString& name);
+    void on_entryRemoved(const QString& dirpath, const QString& name);
+    void on_rescanRequired(const QString& dirpath);
+    void checkSharedDirectories();
+
 private:
     Session();
     SessionBase* delegate(const QString& hash) const;
@@ -147,11 +221,22 @@ private:
         std::for_each(m_sessions.begin(), m_sessions.end(), f);
     }
 
+    /**
+      * shared directory by path, NULL when directory isn't shared
+     */
+    DirNode* sharedDirectory(const QString& dirpath);
     void addDirectory(DirNode* dir);
     void removeDirectory(DirNode* dir);
     void setDirectLink(const QString& hash, DirNode* node);
     void registerNode(FileNode*);
-    FileNode* node(const QString& filepath, const QHash<QString, QString>* pdict = NULL);
+    FileNode* node(const QString& filepath, const QHash<QString, QString>* pdict = NULL, bool populate = true);
+
+    /**
+      * lookup of existing node by exact path through directories index, NULL when not found
+     */
+    FileNode* findNode(const QString& filepath) const;
+    void indexDirectory(DirNode* dir);
+    void unindexDirectory(DirNode* dir);
 
     // emitters
     void signal_beginRemoveNode(const FileNode* node) { emit beginRemoveNode(node);}
@@ -161,6 +246,17 @@ private:
     void signal_changeNode(const FileNode* node) { emit changeNode(node);}
     void prepare_collections();
 
+    /**
+      * collection of directory must be checked, builds run after changes settle
+     */
+    void collectionChanged(DirNode* dir);
+
+    /**
+      * log memory taken by shared filesystem tree
+     */
+    void reportTreeMemory();
+    void haltWorker();
+
     static Session* m_instance;
 
     QBtSession m_btSession;
@@ -170,20 +266,32 @@ private:
     QScopedPointer<TorrentSpeedMonitor> m_speedMonitor;
     QScopedPointer<QTimer>  m_periodic_resume;
     QScopedPointer<QTimer>  m_alerts_reading;
+    QScopedPointer<SessionWorker> m_worker;
+    QScopedPointer<DirWatcher> m_watcher;
+    QScopedPointer<CollectionBuilder> m_collections;
+    QScopedPointer<ShareJob> m_share_job;
+    QScopedPointer<QTimer>  m_consistency_check;
+
+    TransferSnapshot    m_snapshot;
+    mutable QMutex      m_snapshot_mutex;   // snapshot is read from speed monitor thread
 
     std::set<QPair<QString, int> > m_pending_medias;
 
+    QHash<QString, DirNode*>    m_dir_index;    // all tree directories by path, must outlive root
     DirNode m_root;
     Delay                       m_delay;
     QHash<QString, FileNode*>   m_files;    // all registered files in ed2k filesystem
+    QHash<int, QSet<FileNode*> > m_type_index; // registered files by ed2k type
     std::set<DirNode*>          m_dirs;     // shared directories
     QString                     m_incoming; // incoming filepath
     QHash<QString, FileNode*>   m_h2f_dict;     // transfer hash to file dictionary - load helper
     QList<DirNode*>             m_shared_dirs;  // shared directories - load helper
     QHash<QString, FileNode*>   m_progress_files;   // files which transfer parameters in progress
+    TransferPathIndex           m_transfer_paths;   // incomplete and completed files of transfers
 
     friend class DirNode;
     friend class FileNode;
+    friend class CollectionBuilder;
 };
 
 #endif
@@ -89,6 +89,7 @@ public:
     virtual void configureSession() = 0;
     virtual void enableIPFilter(const QString &filter_path, bool force=false) = 0;
     virtual void readAlerts() = 0;
+    virtual void drainAlerts() = 0;   //!< dispatch all pending alerts, no time limit
     virtual void saveTempFastResumeData() = 0;
     virtual void saveFastResumeData() = 0;
     virtual QPair<Transfer,ErrorCode> addLink(QString strLink, bool resumed = false) = 0;
@@ -106,6 +107,12 @@ public:
     virtual QList<QDir> files() const;
     virtual QList<QDir> incompleteFiles() const;
 
+    /**
+      * called on session worker thread - drain library alerts into queue for readAlerts
+      * returns true when new alerts are waiting for readAlerts
+     */
+    virtual bool pumpAlerts() { return false; }
+
 public slots:
     virtual void pauseTransfer(const QString& hash);
     virtual void resumeTransfer(const QString& hash);
@@ -223,6 +230,8 @@ public:
     void enableIPFilter(const QString &filter_path, bool force=false) {
         DEFER2(enableIPFilter, filter_path, force); }
     void readAlerts() { DEFER0(readAlerts); }
+    void drainAlerts() { DEFER0(drainAlerts); }
+    bool pumpAlerts() { FORWARD_RETURN(pumpAlerts(), false); }
     void saveTempFastResumeData() { DEFER0(saveTempFastResumeData); }
     void saveFastResumeData() { DEFER0(saveFastResumeData); }
     QPair<Transfer,ErrorCode> addLink(QString strLink, bool resumed = false) {
@@ -1,11 +1,14 @@
 #include <QDirIterator>
+#include <QSet>
 #include <QFileSystemModel>
-#include <QTextStream>
 #include <algorithm>
 
 #include "session_filesystem.h"
 #include "session.h"
 #include "preferences.h"
+#include "node_arena.h"
+#include "fs_snapshot.h"
+#include "share_job.h"
 
 #include <libed2k/md4_hash.hpp>
 #include <libed2k/file.hpp>
@@ -25,14 +28,82 @@ QString translateDriveName(const QFileInfo &drive)
     return driveName;
 }
 
+static NodeArena& fileArena()
+{
+    // never destroyed - session root releases nodes on exit
+    static NodeArena* arena = new NodeArena(sizeof(FileNode));
+    return *arena;
+}
+
+static NodeArena& dirArena()
+{
+    static NodeArena* arena = new NodeArena(sizeof(DirNode));
+    return *arena;
+}
+
+TreeMemory::TreeMemory() : files(0), dirs(0), nodes(0), names(0), indexes(0), metadata(0)
+{
+}
+
+TreeMemory TreeMemory::collect(const DirNode& root)
+{
+    TreeMemory mem;
+    root.memory_usage(mem);
+    mem.nodes = fileArena().reserved() + dirArena().reserved();
+    mem.names = NameTable::bytes();
+    return mem;
+}
+
+NodeCounters::NodeCounters() :
+    files(0),
+    active_files(0),
+    transfer_files(0),
+    error_files(0),
+    dirs(0),
+    active_dirs(0),
+    populated_dirs(0),
+    shared_bytes(0)
+{
+}
+
+NodeCounters& NodeCounters::operator+=(const NodeCounters& c)
+{
+    files           += c.files;
+    active_files    += c.active_files;
+    transfer_files  += c.transfer_files;
+    error_files     += c.error_files;
+    dirs            += c.dirs;
+    active_dirs     += c.active_dirs;
+    populated_dirs  += c.populated_dirs;
+    shared_bytes    += c.shared_bytes;
+    return *this;
+}
+
+NodeCounters& NodeCounters::operator-=(const NodeCounters& c)
+{
+    files           -= c.files;
+    active_files    -= c.active_files;
+    transfer_files  -= c.transfer_files;
+    error_files     -= c.error_files;
+    dirs            -= c.dirs;
+    active_dirs     -= c.active_dirs;
+    populated_dirs  -= c.populated_dirs;
+    shared_bytes    -= c.shared_bytes;
+    return *this;
+}
+
 FileNode::FileNode(DirNode* parent, const QFileInfo& info) :
     m_parent(parent),
+    m_atp(NULL),
+    m_filename(NameTable::intern(info.fileName())),
+    m_size(-1),
+    m_mtime(0),
     m_active(false),
-    m_info(info),
-    m_atp(NULL)
+    m_has_hash(false),
+    m_unshared_by_user(false),
+    m_counted(0),
+    m_type(unknown_type)
 {
-    m_filename = m_info.fileName();
-    m_unshared_by_user = false;
 }
 
 FileNode::~FileNode()
@@ -40,12 +111,233 @@ FileNode::~FileNode()
     delete m_atp;
 }
 
+void* FileNode::operator new(size_t size)
+{
+    if (size == sizeof(FileNode)) return fileArena().allocate();
+    if (size == sizeof(DirNode)) return dirArena().allocate();
+    return ::operator new(size);
+}
+
+void FileNode::operator delete(void* p, size_t size)
+{
+    if (size == sizeof(FileNode))
+        fileArena().release(p);
+    else if (size == sizeof(DirNode))
+        dirArena().release(p);
+    else
+        ::operator delete(p);
+}
+
+QString FileNode::hash() const
+{
+    return m_has_hash ? misc::toQString(m_hash) : QString();
+}
+
+void FileNode::set_hash(const QString& hash)
+{
+    m_has_hash = !hash.isEmpty();
+    if (m_has_hash) m_hash = libed2k::md4_hash::fromString(hash.toStdString());
+}
+
+void FileNode::set_filename(const QString& filename)
+{
+    m_filename = NameTable::intern(filename);
+    m_sort_name.clear();
+    m_type = unknown_type;
+    if (is_dir()) static_cast<DirNode*>(this)->reset_path();
+}
+
+/**
+ * case folded name without spaces, digit runs are replaced by length and digits without leading zeros
+ * plain compare of keys gives natural order
+ */
+static QString naturalKey(const QString& name)
+{
+    QString res;
+    res.reserve(name.size());
+    int i = 0;
+
+    while (i < name.size())
+    {
+        const QChar c = name.at(i);
+
+        if (c.isSpace())
+        {
+            ++i;
+        }
+        else if (c.isDigit())
+        {
+            int end = i;
+            while (end < name.size() && name.at(end).isDigit()) ++end;
+            while (i + 1 < end && name.at(i).digitValue() == 0) ++i;
+            res += QChar(ushort(1));
+            res += QChar(ushort(end - i));
+            res += name.mid(i, end - i);
+            i = end;
+        }
+        else
+        {
+            res += c.toCaseFolded();
+            ++i;
+        }
+    }
+
+    return (res == name) ? name : res;
+}
+
+const QString& FileNode::sort_name() const
+{
+    if (m_sort_name.isNull()) m_sort_name = naturalKey(m_filename);
+    return m_sort_name;
+}
+
+int FileNode::type() const
+{
+    if (m_type == unknown_type)
+        m_type = libed2k::GetED2KFileTypeID(m_filename.toLower().toStdString());
+    return m_type;
+}
+
+qint64 FileNode::size_on_disk() const
+{
+    if (m_size < 0) stat();
+    return m_size;
+}
+
+QDateTime FileNode::last_modified() const
+{
+    if (m_size < 0) stat();
+    return QDateTime::fromTime_t(m_mtime);
+}
+
+uint FileNode::modified_time() const
+{
+    if (m_size < 0) stat();
+    return m_mtime;
+}
+
+quint8 FileNode::state_flags() const
+{
+    quint8 res = m_counted & CF_ATTACHED;
+    if (m_active) res |= CF_ACTIVE;
+
+    if (is_dir())
+    {
+        if (static_cast<const DirNode*>(this)->is_populated()) res |= CF_POPULATED;
+    }
+    else
+    {
+        if (has_transfer()) res |= CF_TRANSFER;
+        if (m_error) res |= CF_ERROR;
+    }
+
+    return res;
+}
+
+NodeCounters FileNode::counted() const
+{
+    NodeCounters c;
+
+    if (is_dir())
+    {
+        c = static_cast<const DirNode*>(this)->m_counters;
+        ++c.dirs;
+        if (m_counted & CF_ACTIVE) ++c.active_dirs;
+        if (m_counted & CF_POPULATED) ++c.populated_dirs;
+    }
+    else
+    {
+        ++c.files;
+        if (m_counted & CF_ACTIVE) ++c.active_files;
+        if (m_counted & CF_ERROR) ++c.error_files;
+
+        if (m_counted & CF_TRANSFER)
+        {
+            ++c.transfer_files;
+            if (m_atp) c.shared_bytes = m_atp->file_size;
+        }
+    }
+
+    return c;
+}
+
+void FileNode::propagate(const NodeCounters& delta, bool add) const
+{
+    const FileNode* p = this;
+
+    // detached subtree is counted when it is attached
+    while ((p->m_counted & CF_ATTACHED) && p->m_parent)
+    {
+        if (add)
+            p->m_parent->m_counters += delta;
+        else
+            p->m_parent->m_counters -= delta;
+
+        p = p->m_parent;
+    }
+}
+
+void FileNode::recount()
+{
+    const quint8 flags = state_flags();
+    if (flags == m_counted) return;
+
+    propagate(counted(), false);
+    m_counted = flags;
+    propagate(counted(), true);
+}
+
+void FileNode::uncount()
+{
+    propagate(counted(), false);
+    m_counted &= CF_ATTACHED;
+    propagate(counted(), true);
+}
+
+void FileNode::stat() const
+{
+    const QFileInfo fi = info();
+    m_size = fi.size();
+    m_mtime = fi.lastModified().toTime_t();
+}
+
+void FileNode::refresh()
+{
+    const qint64 size = m_size;
+    const uint mtime = m_mtime;
+    stat();
+
+    if (size >= 0)
+    {
+        if (size == m_size && mtime == m_mtime) return;
+    }
+    else if (!has_metadata() || m_atp->file_size == m_size)
+    {
+        // stamp wasn't cached, completed download or restored node has parameters of same file
+        return;
+    }
+
+    qDebug() << indention() << "file changed: " << filename();
+    const bool active = m_active;
+
+    // removes transfer synchronously or cancels hashing
+    if (active) unshare(false);
+
+    // parameters describe old content
+    uncount();
+    delete m_atp;
+    m_atp = NULL;
+    recount();
+
+    if (active) share(false);
+}
+
 void FileNode::create_transfer()
 {
     try
     {
         m_atp->duplicate_is_error = true;
-        m_hash = Session::instance()->get_ed2k_session()->postTransfer(*m_atp);
+        set_hash(Session::instance()->get_ed2k_session()->postTransfer(*m_atp));
         Session::instance()->registerNode(this);
         m_parent->drop_transfer_by_file();
         m_error = libed2k::errors::no_error;
@@ -55,6 +347,8 @@ void FileNode::create_transfer()
         m_error = e.error();
         m_active = false;
     }
+
+    recount();
 }
 
 void FileNode::share(bool recursive, bool share_files/* = true*/)
@@ -74,6 +368,7 @@ void FileNode::share(bool recursive, bool share_files/* = true*/)
         Session::instance()->get_ed2k_session()->makeTransferParametersAsync(filepath());
     }
 
+    recount();
     Session::instance()->signal_changeNode(this);
 }
 
@@ -86,22 +381,23 @@ void FileNode::unshare(bool recursive)
 
     if (has_transfer())
     {
-        QString hash = m_hash;
-        Session::instance()->get_ed2k_session()->deleteTransfer(hash, false);
+        Session::instance()->get_ed2k_session()->deleteTransfer(hash(), false);
     }
     else
     {
         Session::instance()->get_ed2k_session()->cancelTransferParameters(filepath());
     }
 
+    recount();
     m_parent->drop_transfer_by_file();
     Session::instance()->signal_changeNode(this);
 }
 
 void FileNode::on_transfer_finished(Transfer t)
 {
+    uncount();  // transfer parameters can be replaced
     m_active = true;
-    m_hash = t.hash();
+    set_hash(t.hash());
     m_error = libed2k::errors::no_error;
     m_parent->drop_transfer_by_file();
 
@@ -111,6 +407,7 @@ void FileNode::on_transfer_finished(Transfer t)
         m_atp->seed_mode = true; // libed2k will not check file data
     }
 
+    recount();
     Session::instance()->registerNode(this);
     Session::instance()->signal_changeNode(this);
 }
@@ -118,13 +415,15 @@ void FileNode::on_transfer_finished(Transfer t)
 void FileNode::on_transfer_deleted()
 {
     m_active = false;
-    m_hash.clear();
+    clear_hash();
+    recount();
     m_parent->drop_transfer_by_file();
     Session::instance()->signal_changeNode(this);
 }
 
 bool FileNode::on_metadata_completed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec)
 {            
+    uncount();  // transfer parameters will be replaced
     m_error = ec;
 
     if (!ec)
@@ -148,8 +447,7 @@ bool FileNode::on_metadata_completed(const libed2k::add_transfer_params& atp, co
 
         if (has_transfer())
         {
-            QString hash = m_hash;
-            Session::instance()->deleteTransfer(hash, false);
+            Session::instance()->deleteTransfer(hash(), false);
         }
     }
 
@@ -157,6 +455,7 @@ bool FileNode::on_metadata_completed(const libed2k::add_transfer_params& atp, co
     if (ec == libed2k::errors::make_error_code(libed2k::errors::file_params_making_was_cancelled))
         m_error = libed2k::errors::no_error;
 
+    recount();
     Session::instance()->signal_changeNode(this);
     return (!m_error);
 }
@@ -178,31 +477,23 @@ QString correct_path(QString fullPath)
 
 QString FileNode::filepath() const
 {
-    QStringList path;
-    const DirNode* parent = m_parent;
-    path << m_filename;
-
-    while(parent && !parent->is_root())
-    {
-        path.prepend(parent->filename());
-        parent = parent->m_parent;
-    }
-
-    return correct_path(QDir::fromNativeSeparators(path.join(QDir::separator())));
+    if (is_dir()) return static_cast<const DirNode*>(this)->path();
+    return join_path(m_parent, m_filename);
 }
 
 QString FileNode::parent_path() const
 {
-    QStringList path;
-    const DirNode* parent = m_parent;
+    return (m_parent ? m_parent->path() : QString());
+}
 
-    while(parent && !parent->is_root())
-    {
-        path.prepend(parent->filename());
-        parent = parent->m_parent;
-    }
+QString FileNode::join_path(const DirNode* parent, const QString& filename)
+{
+    if (!parent || parent->is_root())
+        return correct_path(QDir::fromNativeSeparators(filename));
 
-    return correct_path(QDir::fromNativeSeparators(path.join(QDir::separator())));
+    const QString& base = parent->path();
+    if (base.endsWith(QLatin1Char('/'))) return base + filename;
+    return base + QLatin1Char('/') + filename;
 }
 
 int FileNode::level() const
@@ -238,35 +529,39 @@ QString FileNode::string() const
     }
     else if (has_transfer())  //TODO - must be removed
     {
-        res = QString("# empty line ") + m_hash;
+        res = QString("# empty line ") + hash();
     }
 
     return (res);
 }
 
-QString FileNode::toHtml(const QString& address, int port) const
-{
-    QString res;
-
-    if (has_transfer() && misc::isPreviewable(filename().section(".",-1)))
-        res = "<li class=\"marked\">" + QString("<a href=\"http://%1:%2/%3\">").arg(address).arg(port).arg(hash()) +
-                filename() +
-                "</a></li>\n";
-
-    return res;
-}
-
 DirNode::DirNode(DirNode* parent, const QFileInfo& info, bool root /*= false*/) :
     FileNode(parent, info),
     m_populated(false),
     m_root(root)
 {
+    reset_path();
 }
 
 DirNode::~DirNode()
 {
     foreach(FileNode* p, m_file_children.values()) { delete p; }
     foreach(DirNode* p, m_dir_children.values()) { delete p; }
+    if (!m_root) Session::instance()->unindexDirectory(this);
+}
+
+void DirNode::reset_path()
+{
+    if (!m_root) Session::instance()->unindexDirectory(this);
+    m_path = m_root ? QString() : join_path(m_parent, m_filename);
+
+    foreach(DirNode* p, m_dir_children)
+    {
+        p->reset_path();
+    }
+
+    if (!m_root && m_parent && m_parent->m_dir_children.value(m_filename) == this)
+        Session::instance()->indexDirectory(this);
 }
 
 void DirNode::share(bool recursive, bool share_files /* = true*/)
@@ -274,6 +569,7 @@ void DirNode::share(bool recursive, bool share_files /* = true*/)
     if (!m_active)
     {        
         m_active = true;
+        recount();
         Session::instance()->addDirectory(this);
 
         // execute without check current state
@@ -308,14 +604,14 @@ void DirNode::share(bool recursive, bool share_files /* = true*/)
     Session::instance()->signal_changeNode(this);
 }
 
-void DirNode::reshare(QList<QDir>& ex)
+void DirNode::reshare()
 {
     QList<FileNode*> forErase;
     foreach(FileNode* p, m_file_children.values())
     {
         if (!p->is_active() && !p->m_unshared_by_user)
         {
-            if (ex.contains(p->filepath()))
+            if (Session::instance()->isIncompleteFile(p->filepath()))
             {
                 qDebug() << "erase partial file: " << p->filepath();
                 forErase.push_back(p);
@@ -343,6 +639,7 @@ void DirNode::unshare(bool recursive)
     if (m_active)
     {
         m_active = false;
+        recount();
         Session::instance()->removeDirectory(this);
 
         deleteTransfer();
@@ -377,59 +674,23 @@ void DirNode::deleteTransfer()
 {
     if (has_transfer())
     {
-        Session::instance()->get_ed2k_session()->deleteTransfer(m_hash, true);
-        m_hash.clear();
+        Session::instance()->get_ed2k_session()->deleteTransfer(hash(), true);
+        clear_hash();
     }
 }
 
 bool DirNode::contains_active_children() const
 {
-    bool active = m_active;
-
-    if (!active)
-    {
-        foreach(const FileNode* node, m_file_children)
-        {
-            active = node->contains_active_children();
-            if (active) break;
-        }
-
-        if (!active)
-        {
-            foreach(const DirNode* node, m_dir_children)
-            {
-                active = node->contains_active_children();
-                if (active) break;
-            }
-        }
-    }
-
-    return active;
+    return m_active || m_counters.active_files || m_counters.active_dirs;
 }
 
 bool DirNode::all_active_children() const
 {
-    bool active = m_active;
-
-    if (active)
-    {
-        foreach(const FileNode* node, m_file_children)
-        {
-            active = node->all_active_children();
-            if (!active) break;
-        }
-
-        if (active)
-        {
-            foreach(const DirNode* node, m_dir_children)
-            {
-                active = (node->is_populated() && node->all_active_children());
-                if (!active) break;
-            }
-        }
-    }
-
-    return active;
+    // every file is shared and every subdirectory is populated and shared
+    return m_active &&
+        m_counters.active_files == m_counters.files &&
+        m_counters.active_dirs == m_counters.dirs &&
+        m_counters.populated_dirs == m_counters.dirs;
 }
 
 void DirNode::on_transfer_deleted()
@@ -447,7 +708,8 @@ bool DirNode::on_metadata_completed(const libed2k::add_transfer_params& atp, con
 
 void DirNode::update_state()
 {
-    if (m_active) deleteTransfer();
+    // collection name depends on shared parents
+    if (m_active) Session::instance()->collectionChanged(this);
 
     foreach(DirNode* node, m_dir_children)
     {
@@ -457,7 +719,7 @@ void DirNode::update_state()
 
 void DirNode::drop_transfer_by_file()
 {
-    if (m_active) deleteTransfer();
+    if (m_active) Session::instance()->collectionChanged(this);
 
     const DirNode* parent = this;
     while(parent && !parent->is_root())
@@ -468,98 +730,6 @@ void DirNode::drop_transfer_by_file()
 
 }
 
-void DirNode::build_collection()
-{
-    // collection would hash, but hasn't transfer yet
-    bool pending = false;
-
-    int files_count = 0;
-    // check children
-    foreach(const FileNode* p, m_file_children.values())
-    {
-        if (p->is_active())
-        {
-            ++files_count;
-
-            if (!p->has_transfer())
-            {
-                pending = true;
-                break;
-            }
-        }
-    }
-
-    if (!pending && (files_count > 0))
-    {
-        qDebug() << "collection " << filename() << " ready";
-        QStringList lines;
-
-        foreach(const FileNode* p, m_file_children.values())
-        {
-            if (p->is_active())
-            {
-                QString line = p->string();
-                Q_ASSERT(!line.isEmpty());
-                lines << line;
-            }
-        }
-
-        int iteration = 0;
-        // generate unique filename
-        QDir cd(misc::ED2KCollectionLocation());
-        QString collection_filepath;
-
-        while(collection_filepath.isEmpty())
-        {
-            QString filename = collection_name() + (iteration?(QString("_") + QString::number(iteration)):QString()) + QString("-") + QString::number(lines.count()) + QString(".emulecollection");
-            QFileInfo fi(cd.filePath(filename));
-
-            if (fi.exists())
-            {
-                ++iteration;
-            }
-            else
-            {
-                collection_filepath = fi.absoluteFilePath();
-            }
-        }
-
-        qDebug() << "collection filepath " << collection_filepath;
-
-        QFile data(collection_filepath);
-
-        if (data.open(QFile::WriteOnly | QFile::Truncate))
-        {
-             QTextStream out(&data);
-
-             foreach(const QString& line, lines)
-             {
-                 out << line << "\n";
-             }
-
-             data.close();
-
-             // hash file and add node
-             std::pair<libed2k::add_transfer_params, libed2k::error_code> res_pair = Session::instance()->get_ed2k_session()->makeTransferParameters(collection_filepath);
-
-             if (!res_pair.second)
-             {               
-                try
-                {
-                    res_pair.first.duplicate_is_error = true;
-                    m_hash = Session::instance()->get_ed2k_session()->addTransfer(res_pair.first).hash();
-                    m_error = libed2k::errors::no_error;
-                }
-                catch(const libed2k::libed2k_exception& e)
-                {
-                    m_error = e.error();
-                    m_active = false;
-                }
-             }
-        }
-    }
-}
-
 QString DirNode::collection_name() const
 {
     QString res;
@@ -599,6 +769,7 @@ void DirNode::add_node(FileNode* node)
     {
         m_dir_children.insert(node->filename(), static_cast<DirNode*>(node));
         m_dir_vector.push_back(static_cast<DirNode*>(node));
+        Session::instance()->indexDirectory(static_cast<DirNode*>(node));
     }
     else
     {
@@ -606,17 +777,23 @@ void DirNode::add_node(FileNode* node)
         m_file_vector.push_back(node);
     }
 
+    node->m_counted = CF_ATTACHED;
+    node->m_counted = node->state_flags();
+    node->propagate(node->counted(), true);
+
     if (m_populated) Session::instance()->signal_endInsertNode();
 }
 
 void DirNode::delete_node(const FileNode* node)
 {
     if (m_populated) Session::instance()->signal_beginRemoveNode(node);
+    node->propagate(node->counted(), false);
 
     if (node->is_dir())
     {
         m_dir_vector.erase(std::remove(m_dir_vector.begin(), m_dir_vector.end(), node), m_dir_vector.end());
         Session::instance()->removeDirectory((DirNode*)node);
+        Session::instance()->m_share_job->drop(static_cast<const DirNode*>(node)->path());
         m_dir_children.take(node->filename());
     }
     else
@@ -666,7 +843,7 @@ void DirNode::populate(bool force /* = false*/, const QHash<QString, QString>* p
             if (!m_dir_children.contains(translateDriveName(fi)))
             {
                 DirNode* p = new DirNode(this, fi);
-                p->m_filename = translateDriveName(fi);
+                p->set_filename(translateDriveName(fi));
                 add_node(p);
             }
         }
@@ -687,8 +864,6 @@ void DirNode::populate(bool force /* = false*/, const QHash<QString, QString>* p
 
         QString itPath = QDir::fromNativeSeparators(path);
         QDirIterator dirIt(itPath, QDir::NoDotAndDotDot| QDir::AllEntries | QDir::System | QDir::Hidden);
-        QList<QDir> incompleteFiles = Session::instance()->incompleteFiles();
-
         while(dirIt.hasNext())
         {
             dirIt.next();
@@ -703,7 +878,7 @@ void DirNode::populate(bool force /* = false*/, const QHash<QString, QString>* p
             }
 
             if (fileInfo.isFile() && !m_file_children.contains(fileInfo.fileName()) &&
-                !incompleteFiles.contains(fileInfo.filePath()))
+                !Session::instance()->isIncompleteFile(fileInfo.filePath()))
             {
                 FileNode* pfn = new FileNode(this, fileInfo);
                 qDebug() << "search link for: " << fileInfo.fileName();
@@ -730,43 +905,131 @@ void DirNode::populate(bool force /* = false*/, const QHash<QString, QString>* p
     }
 
     m_populated = true;
+    recount();
 }
 
-QString DirNode::toHtml(const QString& address, int port) const
+void DirNode::restore(const SnapshotDir& snapshot)
 {
-    QString res;
-    QString previous_res;
+    if (!m_populated)
+    {
+        foreach(const QString& name, snapshot.dirs)
+        {
+            if (!m_dir_children.contains(name)) add_node(new DirNode(this, QFileInfo(name)));
+        }
 
-    foreach(const DirNode* pDir, m_dir_vector)
+        foreach(const SnapshotDir::File& f, snapshot.files)
+        {
+            if (m_file_children.contains(f.name)) continue;
+
+            FileNode* pfn = new FileNode(this, QFileInfo(f.name));
+            pfn->m_size = f.size;
+            pfn->m_mtime = f.mtime;
+            pfn->m_unshared_by_user = f.excluded;
+
+            if (!f.hash.isEmpty())
+            {
+                const libed2k::md4_hash hash = libed2k::md4_hash::fromString(f.hash.toHex().constData());
+                Session::instance()->h2f_dict().insert(misc::toQString(hash), pfn);
+            }
+
+            add_node(pfn);
+        }
+
+        m_populated = true;
+        recount();
+    }
+
+    if (!m_active)
     {
-         QString local_res = pDir->toHtml(address, port);
+        m_active = true;
+        recount();
+        Session::instance()->addDirectory(this);
 
-         if (!local_res.isEmpty())
-         {
-             previous_res += "<li>" + local_res + "</li>\n";
-         }
+        foreach(DirNode* p, m_dir_children.values())
+        {
+            p->update_state();
+        }
     }
+}
 
-    QString node_res;
+void DirNode::add_entry(const QString& name)
+{
+    if (!m_populated || m_dir_children.contains(name)) return;
 
-    foreach(const FileNode* pFile, m_file_vector)
+    if (FileNode* p = m_file_children.value(name))
     {
-        node_res += pFile->toHtml(address, port);
+        p->refresh();
+        return;
     }
 
-    if (!previous_res.isEmpty() || !node_res.isEmpty())
+    QFileInfo fileInfo(QDir(filepath()), name);
+
+    if (fileInfo.isDir())
+    {
+        add_node(new DirNode(this, fileInfo));
+    }
+    else if (fileInfo.isFile() && !Session::instance()->isIncompleteFile(fileInfo.filePath()))
     {
-        if (!is_active() && node_res.isEmpty())
+        // completed ed2k transfer registers its node by itself, don't hash file again
+        if (Session::instance()->completedTransfer(fileInfo.filePath()).size() == 32) return;
+
+        qDebug() << indention() << "new file: " << name;
+        FileNode* p = new FileNode(this, fileInfo);
+        add_node(p);
+        if (m_active) p->share(false);
+    }
+}
+
+void DirNode::remove_entry(const QString& name)
+{
+    FileNode* p = m_file_children.value(name);
+    if (!p) p = m_dir_children.value(name);
+
+    // entry could be re-created before event was delivered
+    if (!p || QFileInfo(QDir(filepath()), name).exists()) return;
+
+    qDebug() << indention() << "entry removed: " << name;
+    p->unshare(true);
+    delete_node(p);
+}
+
+void DirNode::rescan()
+{
+    const QSet<QString> known = m_file_children.keys().toSet();
+    populate(true);
+
+    if (m_active)
+    {
+        foreach(FileNode* p, m_file_children)
         {
-            // do not output self on non-shared directories + when it doesn't contain any shared files
-            res = previous_res;
+            if (!known.contains(p->filename())) p->share(false);
         }
-        else
+    }
+}
+
+void DirNode::memory_usage(TreeMemory& mem) const
+{
+    // hash node with key and value, list slot
+    const qint64 child_index = 2 * sizeof(void*) + sizeof(uint) + sizeof(QString) + 2 * sizeof(void*);
+    mem.indexes += (m_file_children.size() + m_dir_children.size()) * child_index;
+    // cached path and its entry in session directories index
+    mem.indexes += m_path.capacity() * sizeof(QChar) + child_index;
+
+    foreach(const FileNode* p, m_file_vector)
+    {
+        ++mem.files;
+        if (p->m_sort_name.constData() != p->m_filename.constData()) mem.names += p->m_sort_name.capacity() * sizeof(QChar);
+
+        if (p->m_atp)
         {
-            //             self name
-            res = "<ul>" + QString("<li>" + filename() + "</li>") + previous_res + node_res + "</ul>";
+            mem.metadata += sizeof(libed2k::add_transfer_params) + p->m_atp->file_path.capacity() +
+                p->m_atp->piece_hashses.capacity() * sizeof(libed2k::md4_hash);
         }
     }
 
-    return res;
+    foreach(const DirNode* p, m_dir_vector)
+    {
+        ++mem.dirs;
+        p->memory_usage(mem);
+    }
 }
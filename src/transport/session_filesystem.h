@@ -12,13 +12,56 @@
 #include <QDir>
 #include <QTimer>
 #include <QDebug>
-#include <QIcon>
 
 #include <libed2k/add_transfer_params.hpp>
 #include <libed2k/error_code.hpp>
+#include <libed2k/md4_hash.hpp>
 
 class DirNode;
 class Transfer;
+struct SnapshotDir;
+
+/**
+ * approximate memory taken by shared filesystem tree
+ */
+struct TreeMemory
+{
+    TreeMemory();
+
+    /**
+      * walk tree and add arenas and names usage
+     */
+    static TreeMemory collect(const DirNode& root);
+
+    qint64 files;
+    qint64 dirs;
+    qint64 nodes;       // arena chunks
+    qint64 names;       // interned names
+    qint64 indexes;     // children containers
+    qint64 metadata;    // transfer parameters of hashed files
+
+    qint64 total() const { return nodes + names + indexes + metadata; }
+};
+
+/**
+ * aggregated state of directory subtree, directory itself isn't counted
+ */
+struct NodeCounters
+{
+    NodeCounters();
+
+    int files;
+    int active_files;
+    int transfer_files;
+    int error_files;
+    int dirs;
+    int active_dirs;
+    int populated_dirs;
+    qint64 shared_bytes;    // size of files with transfers
+
+    NodeCounters& operator+=(const NodeCounters& c);
+    NodeCounters& operator-=(const NodeCounters& c);
+};
 
 class FileNode
 {
@@ -27,10 +70,14 @@ public:
     FileNode(DirNode* parent, const QFileInfo& info);
     virtual ~FileNode();
 
+    // nodes live in arena
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+
     virtual void share(bool recursive, bool share_files = true);
     virtual void unshare(bool recursive);
     virtual bool has_metadata() const { return m_atp != NULL; }
-    virtual bool has_transfer() const { return !m_hash.isEmpty(); }
+    virtual bool has_transfer() const { return m_has_hash; }
 
     // signal handlers
     virtual void on_transfer_finished(Transfer t);
@@ -38,6 +85,9 @@ public:
     virtual bool on_metadata_completed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec);
 
     virtual QString collection_name() const { return QString(""); }
+    /**
+      * directories cache full path, file path is parent path plus name
+     */
     QString filepath() const;
     QString parent_path() const;
     virtual bool is_dir() const { return false; }
@@ -46,30 +96,88 @@ public:
     virtual bool is_active() const { return m_active; }
     virtual bool contains_active_children() const { return m_active; }
     virtual bool all_active_children() const { return m_active; }
-    QString hash() const { return m_hash; }
+    QString hash() const;
+    void set_hash(const QString& hash);
+    void clear_hash() { m_has_hash = false; }
     int level() const;
     QString indention() const;
 
     QString string() const;
     QString filename() const { return m_filename; }
+    void set_filename(const QString& filename);
     void create_transfer();
-    virtual qint64 size_on_disk() const { return m_info.size(); }
+
+    /**
+      * file was written in place, shared file with changed size or modification time is hashed again
+     */
+    void refresh();
+
+    /**
+      * reflect current node state in counters of ancestors, call after state change
+     */
+    void recount();
+
+    /**
+      * remove node from counters of ancestors, call before transfer parameters change
+     */
+    void uncount();
+
+    /**
+      * stat data is read from disk on first request and cached in node
+     */
+    virtual qint64 size_on_disk() const;
+    QDateTime last_modified() const;
+    uint modified_time() const;
+
+    /**
+      * sort and filter keys, computed on first request
+      * sort name is case folded with numbers comparable as numbers, type is libed2k::EED2KFileType
+     */
+    const QString& sort_name() const;
+    int type() const;
+
     /**
-      * generate <ul><li></li></ul> node representation
-      * when node shared and has transfer associated
+      * node doesn't keep file info, it is read from disk on every call
      */
-    QString toHtml(const QString& address, int port) const;
+    QFileInfo info() const { return QFileInfo(filepath()); }
 
     DirNode*    m_parent;
-    bool        m_active;
-    QFileInfo   m_info;
     libed2k::add_transfer_params* m_atp;
     libed2k::error_code  m_error;
-    QIcon       m_icon;
-    QString     m_displayType;
-    QString     m_hash;
-    QString     m_filename;
+    QString     m_filename;         // interned
+    mutable QString m_sort_name;    // shares data with filename when equal
+    libed2k::md4_hash m_hash;       // valid when m_has_hash
+    mutable qint64  m_size;         // -1 until stat
+    mutable uint    m_mtime;
+    bool        m_active;
+    bool        m_has_hash;
     bool        m_unshared_by_user; // load helper only!
+
+    enum CountedFlags
+    {
+        CF_ATTACHED     = 0x01, // node is in parent's children, ancestors count it
+        CF_ACTIVE       = 0x02,
+        CF_TRANSFER     = 0x04,
+        CF_ERROR        = 0x08,
+        CF_POPULATED    = 0x10
+    };
+
+    quint8      m_counted;          // state reflected in ancestors counters
+    mutable quint8  m_type;         // file type, unknown_type until first request
+
+    enum { unknown_type = 0xff };
+protected:
+    static QString join_path(const DirNode* parent, const QString& filename);
+
+    /**
+      * contribution of node to ancestors counters by counted flags, includes subtree for directory
+     */
+    NodeCounters counted() const;
+    quint8 state_flags() const;
+    void propagate(const NodeCounters& delta, bool add) const;
+    friend class DirNode;
+private:
+    void stat() const;
 };
 
 class DirNode : public FileNode
@@ -81,11 +189,16 @@ public:
     virtual bool is_dir() const { return true; }
     virtual bool is_root() const { return m_root; }
     virtual int children() const { return m_file_children.count(); }
+
+    /**
+      * counters of whole subtree, updated incrementally
+     */
+    const NodeCounters& counters() const { return m_counters; }
     virtual bool contains_active_children() const;
     virtual bool all_active_children() const;
 
     virtual void share(bool recursive, bool share_files = true);
-    void reshare(QList<QDir>&); // after-load helper - simple share all files again
+    void reshare(); // after-load helper - simple share all files again, incomplete files are erased
     virtual void unshare(bool recursive);
     void deleteTransfer();
 
@@ -94,6 +207,12 @@ public:
     virtual bool on_metadata_completed(const libed2k::add_transfer_params& atp, const libed2k::error_code& ec);
 
     QString collection_name() const;
+    const QString& path() const { return m_path; }
+
+    /**
+      * rebuild cached path of directory and its subdirectories after rename
+     */
+    void reset_path();
     FileNode* child(const QString& filename);
     void add_node(FileNode* node);
     void delete_node(const FileNode* node);
@@ -108,24 +227,41 @@ public:
 
     bool is_populated() const { return m_populated; }
 
+    /**
+      * fill directory from snapshot without disk access and mark it shared
+      * files are left unshared until reshare after transfers were loaded
+     */
+    void restore(const SnapshotDir& snapshot);
+
+    /**
+      * apply entry change reported by directory watcher without scanning whole directory
+      * new files in shared directory are shared immediately
+     */
+    void add_entry(const QString& name);
+    void remove_entry(const QString& name);
+
+    /**
+      * populate again and share files appeared since last scan
+      * consistency check for watched directory
+     */
+    void rescan();
+
     /**
       * call when collection share/unshare to inform children
      */
     void update_state();
 
     /**
-      * will call by file when file change state to unshare
-      * if directory was active - checks it status
+      * will call by file when file change state
+      * if directory was active - its collection will be checked by collection builder
      */
     void drop_transfer_by_file();
 
+
     /**
-      * prepare collection file and add transfer based on it
+      * add memory of subtree to report, arenas and names are accounted by TreeMemory::collect
      */
-    void build_collection();
-
-    // like FileNode + recursive call
-    QString toHtml(const QString& address, int port) const;
+    void memory_usage(TreeMemory& mem) const;
 
     bool                        m_populated;
     bool                        m_root;
@@ -133,7 +269,8 @@ public:
     QHash<QString, DirNode*>    m_dir_children;
     QList<FileNode*>            m_file_vector;
     QList<DirNode*>             m_dir_vector;
-    QHash<QString, QString>     m_f2h_dict; // this uses for get transfer hash by name on load stage
+    QString                     m_path;     // full path, empty for root
+    NodeCounters                m_counters;
 };
 
 
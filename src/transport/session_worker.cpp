@@ -0,0 +1,51 @@
+#include <QMutexLocker>
+
+#include "session_worker.h"
+#include "session_base.h"
+
+SessionWorker::SessionWorker(const std::vector<SessionBase*>& sessions, QObject* parent /* = 0*/) :
+    QThread(parent), m_sessions(sessions), m_abort(false), m_notified(0)
+{
+}
+
+SessionWorker::~SessionWorker()
+{
+    halt();
+}
+
+void SessionWorker::halt()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_abort = true;
+        m_abortCond.wakeOne();
+    }
+
+    wait();
+}
+
+void SessionWorker::acknowledge()
+{
+    m_notified.fetchAndStoreOrdered(0);
+}
+
+void SessionWorker::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_abort)
+    {
+        bool ready = false;
+
+        for (std::vector<SessionBase*>::iterator itr = m_sessions.begin(); itr != m_sessions.end(); ++itr)
+        {
+            ready = (*itr)->pumpAlerts() || ready;
+        }
+
+        // one notification until reader takes the batches
+        if (ready && m_notified.testAndSetOrdered(0, 1))
+            emit alertsReady();
+
+        m_abortCond.wait(&m_mutex, pump_interval);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef __SESSION_WORKER_H__
+#define __SESSION_WORKER_H__
+
+#include <vector>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+class SessionBase;
+
+/**
+ * drains alerts of all sessions out of GUI thread
+ * disk bound alerts are handled here, the rest published as batches for SessionBase::readAlerts
+ */
+class SessionWorker : public QThread
+{
+    Q_OBJECT
+public:
+    SessionWorker(const std::vector<SessionBase*>& sessions, QObject* parent = 0);
+    ~SessionWorker();
+
+    /**
+      * stop thread and wait it, sessions can use alerts directly after this call
+     */
+    void halt();
+
+    /**
+      * reader confirms published batches were taken, enables next alertsReady notification
+     */
+    void acknowledge();
+protected:
+    void run();
+signals:
+    void alertsReady();
+private:
+    static const int pump_interval = 100; // ms
+    std::vector<SessionBase*>   m_sessions;
+    bool                        m_abort;
+    QMutex                      m_mutex;
+    QWaitCondition              m_abortCond;
+    QAtomicInt                  m_notified;
+};
+
+#endif //__SESSION_WORKER_H__
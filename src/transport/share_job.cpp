@@ -0,0 +1,125 @@
+#include <QDebug>
+#include <QTime>
+#include <QTimer>
+
+#include "share_job.h"
+#include "session.h"
+
+const int SHARE_TIME_SLICE = 50;    // milliseconds of GUI thread per processing step
+
+namespace
+{
+    int activeFiles(const DirNode* dir)
+    {
+        int res = 0;
+
+        foreach(const FileNode* p, dir->files())
+        {
+            if (p->is_active()) ++res;
+        }
+
+        return res;
+    }
+
+    bool inside(const QString& path, const QString& dirpath)
+    {
+        if (!path.startsWith(dirpath)) return false;
+        return path.size() == dirpath.size() || dirpath.endsWith(QLatin1Char('/')) ||
+            path.at(dirpath.size()) == QLatin1Char('/');
+    }
+}
+
+ShareJob::ShareJob(QObject* parent /* = 0*/) : QObject(parent), m_scheduled(false), m_dirs(0), m_files(0)
+{
+}
+
+void ShareJob::start(const DirNode* dir, bool share)
+{
+    const QString dirpath = dir->path();
+    qDebug() << (share ? "share" : "unshare") << " tree " << dirpath;
+
+    // later request wins over queued work of same subtree
+    drop(dirpath);
+    m_queue.push_back(Item(dirpath, share));
+
+    if (!m_scheduled)
+    {
+        m_scheduled = true;
+        QTimer::singleShot(0, this, SLOT(process()));
+    }
+}
+
+void ShareJob::drop(const QString& dirpath)
+{
+    std::deque<Item> queue;
+
+    for (std::deque<Item>::const_iterator itr = m_queue.begin(); itr != m_queue.end(); ++itr)
+    {
+        if (!inside(itr->path, dirpath)) queue.push_back(*itr);
+    }
+
+    m_queue.swap(queue);
+}
+
+void ShareJob::cancel()
+{
+    if (m_queue.empty()) return;
+    qDebug() << "cancel share job, directories left " << m_queue.size();
+    m_queue.clear();
+    emit progress(m_dirs, m_files, 0);
+    m_dirs = 0;
+    m_files = 0;
+    emit finished();
+}
+
+void ShareJob::process()
+{
+    m_scheduled = false;
+    if (m_queue.empty()) return;
+
+    QTime timer;
+    timer.start();
+
+    while (!m_queue.empty() && timer.elapsed() < SHARE_TIME_SLICE)
+    {
+        const Item item = m_queue.front();
+        m_queue.pop_front();
+
+        // directory was removed or renamed after it was queued
+        DirNode* dir = dynamic_cast<DirNode*>(Session::instance()->findNode(item.path));
+        if (!dir) continue;
+
+        if (item.share)
+        {
+            const int active = activeFiles(dir);
+            dir->share(false);  // scans directory
+            m_files += activeFiles(dir) - active;
+        }
+        else
+        {
+            dir->unshare(false);
+        }
+
+        ++m_dirs;
+
+        foreach(const DirNode* p, dir->m_dir_vector)
+        {
+            m_queue.push_back(Item(p->path(), item.share));
+        }
+    }
+
+    emit progress(m_dirs, m_files, m_queue.size());
+
+    if (m_queue.empty())
+    {
+        qDebug() << "share job finished, directories " << m_dirs << " files " << m_files;
+        m_dirs = 0;
+        m_files = 0;
+        emit finished();
+        return;
+    }
+
+    // continue on next event loop iteration
+    m_scheduled = true;
+    QTimer::singleShot(0, this, SLOT(process()));
+}
@@ -0,0 +1,57 @@
+#ifndef __SHARE_JOB_H__
+#define __SHARE_JOB_H__
+
+#include <deque>
+#include <QObject>
+#include <QString>
+
+class DirNode;
+
+/**
+ * shares or unshares directory subtrees one directory per step in time slices of GUI thread
+ * every processed directory is shared or unshared completely, tree can be saved at any moment
+ */
+class ShareJob : public QObject
+{
+    Q_OBJECT
+public:
+    ShareJob(QObject* parent = 0);
+
+    /**
+      * queue subtree of directory, queued work inside subtree is replaced
+     */
+    void start(const DirNode* dir, bool share);
+
+    /**
+      * forget queued work inside removed directory
+     */
+    void drop(const QString& dirpath);
+
+    /**
+      * drop queued directories, processed ones stay in their new state
+     */
+    void cancel();
+    bool running() const { return !m_queue.empty(); }
+signals:
+    /**
+      * directories processed and files sent to hashing since job start, directories waiting
+     */
+    void progress(int dirs, int files, int pending);
+    void finished();
+private slots:
+    void process();
+private:
+    struct Item
+    {
+        Item(const QString& p, bool s) : path(p), share(s) {}
+        QString path;
+        bool    share;
+    };
+
+    std::deque<Item>    m_queue;    // breadth first, paths because nodes can be removed meanwhile
+    bool    m_scheduled;
+    int     m_dirs;
+    int     m_files;
+};
+
+#endif //__SHARE_JOB_H__
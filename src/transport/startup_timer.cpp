@@ -0,0 +1,42 @@
+#include <QDebug>
+#include <QStringList>
+
+#include "startup_timer.h"
+
+StartupTimer::StartupTimer(const QString& name) : m_name(name)
+{
+}
+
+void StartupTimer::phase(const QString& name)
+{
+    if (m_current.isEmpty() && m_phases.isEmpty())
+        m_total.start();
+    else
+        close();
+
+    m_current = name;
+    m_phase.start();
+}
+
+void StartupTimer::finish(int transfers)
+{
+    if (m_current.isEmpty() && m_phases.isEmpty()) return;
+    close();
+
+    QStringList parts;
+
+    for (QList<QPair<QString, int> >::const_iterator itr = m_phases.begin(); itr != m_phases.end(); ++itr)
+        parts << QString("%1 %2 ms").arg(itr->first).arg(itr->second);
+
+    qDebug() << qPrintable(QString("%1 start up: %2, total %3 ms for %4 transfers")
+        .arg(m_name).arg(parts.join(", ")).arg(m_total.elapsed()).arg(transfers));
+
+    m_phases.clear();
+}
+
+void StartupTimer::close()
+{
+    if (m_current.isEmpty()) return;
+    m_phases << qMakePair(m_current, m_phase.elapsed());
+    m_current.clear();
+}
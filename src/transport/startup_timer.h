@@ -0,0 +1,36 @@
+#ifndef __STARTUP_TIMER_H__
+#define __STARTUP_TIMER_H__
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QTime>
+
+/**
+ * measures named phases of session start up and logs breakdown when finished
+ */
+class StartupTimer
+{
+public:
+    explicit StartupTimer(const QString& name);
+
+    /**
+      * close current phase and start new one, first call starts whole measurement
+     */
+    void phase(const QString& name);
+
+    /**
+      * close current phase and log all phases with total time
+     */
+    void finish(int transfers);
+private:
+    void close();
+
+    QString                     m_name;
+    QString                     m_current;
+    QTime                       m_total;
+    QTime                       m_phase;
+    QList<QPair<QString, int> > m_phases;   // phase name and milliseconds
+};
+
+#endif //__STARTUP_TIMER_H__
@@ -173,6 +173,9 @@ QString Transfer::filename_at(unsigned int index) const { return m_delegate->fil
 TransferSize Transfer::filesize_at(unsigned int index) const {
     return m_delegate->filesize_at(index); }
 
+TransferSize Transfer::file_offset_at(unsigned int index) const {
+    return m_delegate->file_offset_at(index); }
+
 std::vector<int> Transfer::file_extremity_pieces_at(unsigned int index) const {
     return m_delegate->file_extremity_pieces_at(index); }
 
@@ -247,4 +250,6 @@ void Transfer::super_seeding(bool ss) const { m_delegate->super_seeding(ss); }
 
 void Transfer::set_sequential_download(bool sd) const { m_delegate->set_sequential_download(sd); }
 
+void Transfer::set_piece_deadline(int index, int deadline) const { m_delegate->set_piece_deadline(index, deadline); }
+
 void Transfer::set_eager_mode(bool b) const { m_delegate->set_eager_mode(b); }
@@ -88,6 +88,7 @@ public:
     QString filepath_at(unsigned int index) const;
     QString filename_at(unsigned int index) const;
     TransferSize filesize_at(unsigned int index) const;
+    TransferSize file_offset_at(unsigned int index) const;
     std::vector<int> file_extremity_pieces_at(unsigned int index) const;
     QStringList url_seeds() const;
     QStringList absolute_files_path() const;
@@ -118,6 +119,11 @@ public:
     void queue_position_bottom() const;
     void super_seeding(bool ss) const;
     void set_sequential_download(bool sd) const;
+
+    /**
+      * piece is wanted in deadline milliseconds, used by streaming of incomplete files
+     */
+    void set_piece_deadline(int index, int deadline) const;
     void set_eager_mode(bool b) const;
 
 private:
@@ -341,6 +341,7 @@ public:
     virtual QString filepath_at(unsigned int index) const = 0;
     virtual QString filename_at(unsigned int index) const = 0;
     virtual TransferSize filesize_at(unsigned int index) const = 0;
+    virtual TransferSize file_offset_at(unsigned int index) const = 0;
     virtual std::vector<int> file_extremity_pieces_at(unsigned int index) const = 0;
     virtual QStringList url_seeds() const = 0;
     virtual QStringList absolute_files_path() const = 0;
@@ -371,6 +372,7 @@ public:
     virtual void queue_position_bottom() const = 0;
     virtual void super_seeding(bool ss) const = 0;
     virtual void set_sequential_download(bool sd) const = 0;
+    virtual void set_piece_deadline(int index, int deadline) const = 0;
     virtual void set_upload_mode(bool b) const = 0;
     virtual void set_eager_mode(bool b) const = 0;
 
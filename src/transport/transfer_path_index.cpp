@@ -0,0 +1,86 @@
+#include <QDir>
+
+#include "transfer_path_index.h"
+#include "transfer.h"
+
+void TransferPathIndex::update(const Transfer& t)
+{
+    QString hash;
+    QStringList files;
+    QList<QDir> incomplete;
+
+    try
+    {
+        if (!t.is_valid()) return;
+        hash = t.hash();
+        files = t.absolute_files_path();
+        incomplete = t.incompleteFiles();
+    }
+    catch(libtorrent::invalid_handle&) { return; }
+    catch(libed2k::libed2k_exception&) { return; }
+
+    remove(hash);
+    Entry& e = m_transfers[hash];
+
+    foreach(const QDir& dir, incomplete)
+    {
+        const QString k = key(dir.path());
+        e.incomplete << k;
+        m_incomplete.insert(k, hash);
+    }
+
+    foreach(const QString& filepath, files)
+    {
+        const QString k = key(filepath);
+        if (m_incomplete.contains(k)) continue;
+        e.completed << k;
+        m_completed.insert(k, hash);
+    }
+}
+
+void TransferPathIndex::remove(const QString& hash)
+{
+    QHash<QString, Entry>::iterator itr = m_transfers.find(hash);
+    if (itr == m_transfers.end()) return;
+
+    drop(m_incomplete, itr->incomplete, hash);
+    drop(m_completed, itr->completed, hash);
+    m_transfers.erase(itr);
+}
+
+void TransferPathIndex::clear()
+{
+    m_transfers.clear();
+    m_incomplete.clear();
+    m_completed.clear();
+}
+
+bool TransferPathIndex::incomplete(const QString& filepath) const
+{
+    return m_incomplete.contains(key(filepath));
+}
+
+QString TransferPathIndex::completed(const QString& filepath) const
+{
+    return m_completed.value(key(filepath));
+}
+
+QString TransferPathIndex::key(const QString& filepath)
+{
+    const QString res = QDir::cleanPath(QDir::fromNativeSeparators(filepath));
+#ifdef Q_OS_WIN
+    return res.toLower();
+#else
+    return res;
+#endif
+}
+
+void TransferPathIndex::drop(QHash<QString, QString>& index, const QStringList& paths, const QString& hash)
+{
+    foreach(const QString& k, paths)
+    {
+        // path could be taken by other transfer later
+        QHash<QString, QString>::iterator itr = index.find(k);
+        if (itr != index.end() && itr.value() == hash) index.erase(itr);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef __TRANSFER_PATH_INDEX_H__
+#define __TRANSFER_PATH_INDEX_H__
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class Transfer;
+
+/**
+ * files of session transfers by path, split to incomplete and completed
+ * maintained on transfer events, so filesystem scan doesn't enumerate transfers
+ */
+class TransferPathIndex
+{
+public:
+    /**
+      * re-index transfer files by current progress
+     */
+    void update(const Transfer& t);
+    void remove(const QString& hash);
+    void clear();
+
+    bool incomplete(const QString& filepath) const;
+
+    /**
+      * hash of transfer which completed file, empty string when file isn't transfer's one
+     */
+    QString completed(const QString& filepath) const;
+private:
+    static QString key(const QString& filepath);
+    void drop(QHash<QString, QString>& index, const QStringList& paths, const QString& hash);
+
+    struct Entry
+    {
+        QStringList incomplete;
+        QStringList completed;
+    };
+
+    QHash<QString, Entry>   m_transfers;    // transfer hash -> indexed keys
+    QHash<QString, QString> m_incomplete;   // path key -> transfer hash
+    QHash<QString, QString> m_completed;
+};
+
+#endif //__TRANSFER_PATH_INDEX_H__
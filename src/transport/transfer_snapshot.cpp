@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <QSet>
+
+#include "transfer_snapshot.h"
+#include "session_base.h"
+
+TransferSnapshotEntry::TransferSnapshotEntry() :
+    type(Transfer::UNDEFINED),
+    valid(false),
+    seed(false),
+    paused(false),
+    queued(false),
+    active(false),
+    has_metadata(false),
+    queue_position(0),
+    upload_limit(0),
+    download_limit(0),
+    actual_size(0)
+{
+}
+
+TransferSnapshotEntry TransferSnapshotEntry::fetch(const Transfer& t, bool active)
+{
+    TransferSnapshotEntry e;
+
+    try
+    {
+        if (!t.is_valid()) return e;
+
+        e.type           = t.type();
+        e.status         = t.status();
+        e.status.pieces  = TransferBitfield(); // nobody reads pieces from snapshot, don't copy them
+        e.seed           = t.is_seed();
+        e.paused         = t.is_paused();
+        e.queued         = t.is_queued();
+        e.active         = active;
+        e.has_metadata   = t.has_metadata();
+        e.queue_position = t.queue_position();
+        e.upload_limit   = t.upload_limit();
+        e.download_limit = t.download_limit();
+        e.actual_size    = t.actual_size();
+        e.valid          = true;
+    }
+    catch(libtorrent::invalid_handle&)
+    {
+        e = TransferSnapshotEntry();
+    }
+    catch(libed2k::libed2k_exception&)
+    {
+        e = TransferSnapshotEntry();
+    }
+
+    return e;
+}
+
+float TransferSnapshotEntry::progress() const
+{
+    if (!status.total_wanted)
+        return 0.;
+    if (status.total_wanted_done == status.total_wanted)
+        return 1.;
+    float progress = (float) status.total_wanted_done / (float) status.total_wanted;
+    return std::min<float>(progress, 1.);
+}
+
+qreal TransferSnapshotEntry::ratio() const
+{
+    if (!valid) return 0.;
+
+    TransferSize all_time_upload = status.all_time_upload;
+    TransferSize all_time_download = status.all_time_download;
+
+    if (all_time_download == 0 && seed)
+    {
+        // Purely seeded transfer
+        all_time_download = status.total_done;
+    }
+
+    if (all_time_download == 0)
+    {
+        if (all_time_upload == 0)
+            return 0;
+        return SessionBase::MAX_RATIO + 1;
+    }
+
+    qreal ratio = all_time_upload / (float) all_time_download;
+    Q_ASSERT(ratio >= 0.);
+    if (ratio > SessionBase::MAX_RATIO)
+        ratio = SessionBase::MAX_RATIO;
+    return ratio;
+}
+
+TransferSnapshot::TransferSnapshot() : m_progress(0), m_has_active(false), m_tick(0)
+{
+}
+
+TransferSnapshot::TransferSnapshot(const std::vector<Transfer>& transfers,
+                                   const std::vector<Transfer>& active_transfers, quint64 tick) :
+    m_progress(0), m_has_active(false), m_tick(tick)
+{
+    QSet<QString> active;
+
+    for (std::vector<Transfer>::const_iterator i = active_transfers.begin(); i != active_transfers.end(); ++i)
+    {
+        try
+        {
+            active.insert(i->hash());
+        }
+        catch(libtorrent::invalid_handle&) {}
+        catch(libed2k::libed2k_exception&) {}
+    }
+
+    m_entries.reserve(transfers.size());
+    bool has_progress = false;
+    float min_progress = 1;
+
+    for (std::vector<Transfer>::const_iterator i = transfers.begin(); i != transfers.end(); ++i)
+    {
+        QString hash;
+
+        try
+        {
+            hash = i->hash();
+        }
+        catch(libtorrent::invalid_handle&) { continue; }
+        catch(libed2k::libed2k_exception&) { continue; }
+
+        const TransferSnapshotEntry e = TransferSnapshotEntry::fetch(*i, active.contains(hash));
+        if (!e.valid) continue;
+
+        m_entries.insert(hash, e);
+        // ed2k session reports only its active transfers as downloading, bittorrent - all of them
+        m_has_active = m_has_active || (e.downloading() && (e.type != Transfer::ED2K || e.active));
+
+        if (e.active)
+        {
+            has_progress = true;
+            min_progress = std::min(min_progress, e.progress());
+        }
+    }
+
+    m_progress = has_progress ? min_progress : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef __TRANSFER_SNAPSHOT_H__
+#define __TRANSFER_SNAPSHOT_H__
+
+#include <vector>
+#include <QHash>
+
+#include "transport/transfer.h"
+
+/**
+ * transfer state captured at snapshot time
+ */
+struct TransferSnapshotEntry
+{
+    Transfer::Type  type;
+    TransferStatus  status;     // without pieces bitfield
+    bool valid;
+    bool seed;
+    bool paused;
+    bool queued;
+    bool active;                // transfer was reported by session as active
+    bool has_metadata;
+    int queue_position;
+    int upload_limit;
+    int download_limit;
+    TransferSize actual_size;
+
+    TransferSnapshotEntry();
+
+    /**
+      * collect state of one transfer, invalid entry on dead handle
+     */
+    static TransferSnapshotEntry fetch(const Transfer& t, bool active);
+
+    float progress() const;
+    qreal ratio() const;
+
+    /**
+      * transfer is downloading right now - not seed, not paused and not queued
+     */
+    bool downloading() const { return valid && !seed && !paused && !queued; }
+};
+
+/**
+ * statuses of all session transfers fetched once per tick
+ * table is implicitly shared, so copy is cheap and every consumer reads own copy
+ */
+class TransferSnapshot
+{
+public:
+    TransferSnapshot();
+    TransferSnapshot(const std::vector<Transfer>& transfers,
+                     const std::vector<Transfer>& active_transfers, quint64 tick);
+
+    bool contains(const QString& hash) const { return m_entries.contains(hash); }
+    TransferSnapshotEntry value(const QString& hash) const { return m_entries.value(hash); }
+    const QHash<QString, TransferSnapshotEntry>& entries() const { return m_entries; }
+
+    /**
+      * minimum progress over valid active transfers
+     */
+    float progress() const { return m_progress; }
+    bool hasActiveTransfers() const { return m_has_active; }
+    quint64 tick() const { return m_tick; }
+private:
+    QHash<QString, TransferSnapshotEntry> m_entries;
+    float   m_progress;
+    bool    m_has_active;
+    quint64 m_tick;
+};
+
+#endif //__TRANSFER_SNAPSHOT_H__
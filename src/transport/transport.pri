@@ -1,13 +1,34 @@
 INCLUDEPATH += $$PWD
 
 HEADERS += $$PWD/session_base.h \
+           $$PWD/alert_dispatcher.h \
+           $$PWD/collection_builder.h \
+           $$PWD/dir_watcher.h \
+           $$PWD/fs_snapshot.h \
+           $$PWD/node_arena.h \
            $$PWD/session.h \
+           $$PWD/resume_journal.h \
+           $$PWD/session_worker.h \
+           $$PWD/share_job.h \
+           $$PWD/startup_timer.h \
            $$PWD/transfer.h \
            $$PWD/transfer_base.h \
+           $$PWD/transfer_snapshot.h \
+           $$PWD/transfer_path_index.h \
            $$PWD/session_filesystem.h
 
 SOURCES += $$PWD/session_base.cpp \
            $$PWD/session.cpp \
+           $$PWD/collection_builder.cpp \
+           $$PWD/dir_watcher.cpp \
+           $$PWD/fs_snapshot.cpp \
+           $$PWD/node_arena.cpp \
+           $$PWD/resume_journal.cpp \
+           $$PWD/session_worker.cpp \
+           $$PWD/share_job.cpp \
+           $$PWD/startup_timer.cpp \
            $$PWD/transfer.cpp \
            $$PWD/transfer_base.cpp \
+           $$PWD/transfer_snapshot.cpp \
+           $$PWD/transfer_path_index.cpp \
            $$PWD/session_filesystem.cpp